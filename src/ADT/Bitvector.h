@@ -0,0 +1,149 @@
+#ifndef _DG_ADT_BITVECTOR_H_
+#define _DG_ADT_BITVECTOR_H_
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+/// ------------------------------------------------------------------
+// - Bitvector
+//
+//   A set of small numbers (e.g. dense numbers of blocks) stored
+//   as a vector of bits. The size is fixed when the vector is created
+//   (or resized), the set bits are iterated in increasing order
+//   and whole words of zeros are skipped.
+/// ------------------------------------------------------------------
+class Bitvector
+{
+    typedef uint64_t WordT;
+    enum : unsigned { WORD_BITS = 64 };
+
+    std::vector<WordT> words;
+    size_t bits;
+
+    static size_t wordsNum(size_t n)
+    {
+        return (n + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    static unsigned lowestBit(WordT w)
+    {
+        assert(w != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(w);
+#else
+        unsigned i = 0;
+        while (!(w & 1)) {
+            w >>= 1;
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+public:
+    Bitvector(size_t n = 0) : words(wordsNum(n), 0), bits(n) {}
+
+    size_t size() const { return bits; }
+
+    // change the number of bits, the new bits are not set
+    void resize(size_t n)
+    {
+        words.resize(wordsNum(n), 0);
+        // clear the bits that were cut off in the last word
+        if (n % WORD_BITS != 0)
+            words.back() &= (WordT(1) << (n % WORD_BITS)) - 1;
+        bits = n;
+    }
+
+    // set the bit, return true if it was not set before
+    bool set(size_t i)
+    {
+        assert(i < bits && "Out of range");
+        WordT mask = WordT(1) << (i % WORD_BITS);
+        WordT& w = words[i / WORD_BITS];
+        bool ret = !(w & mask);
+        w |= mask;
+        return ret;
+    }
+
+    bool test(size_t i) const
+    {
+        assert(i < bits && "Out of range");
+        return words[i / WORD_BITS] & (WordT(1) << (i % WORD_BITS));
+    }
+
+    void reset(size_t i)
+    {
+        assert(i < bits && "Out of range");
+        words[i / WORD_BITS] &= ~(WordT(1) << (i % WORD_BITS));
+    }
+
+    // reset all bits, the size stays the same
+    void clear()
+    {
+        for (WordT& w : words)
+            w = 0;
+    }
+
+    // set all the bits that are set in @oth (the vector grows if @oth
+    // is bigger), return true if any bit was not set before
+    bool merge(const Bitvector& oth)
+    {
+        if (oth.bits > bits)
+            resize(oth.bits);
+
+        bool changed = false;
+        for (size_t i = 0; i < oth.words.size(); ++i) {
+            changed |= (oth.words[i] & ~words[i]) != 0;
+            words[i] |= oth.words[i];
+        }
+
+        return changed;
+    }
+
+    // keep only the bits that are set also in @oth
+    void intersect(const Bitvector& oth)
+    {
+        for (size_t i = 0; i < words.size(); ++i)
+            words[i] &= i < oth.words.size() ? oth.words[i] : 0;
+    }
+
+    bool empty() const
+    {
+        for (WordT w : words)
+            if (w)
+                return false;
+
+        return true;
+    }
+
+    size_t count() const
+    {
+        size_t ret = 0;
+        for (WordT w : words) {
+            for (; w; w &= w - 1)
+                ++ret;
+        }
+
+        return ret;
+    }
+
+    // call @fn(i) for every set bit i in increasing order
+    template <typename FuncT>
+    void forEach(FuncT fn) const
+    {
+        for (size_t i = 0; i < words.size(); ++i) {
+            for (WordT w = words[i]; w; w &= w - 1)
+                fn(i * WORD_BITS + lowestBit(w));
+        }
+    }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_BITVECTOR_H_
@@ -1,9 +1,12 @@
 #ifndef _DG_CONTAINER_H_
 #define _DG_CONTAINER_H_
 
-#include <set>
 #include <cassert>
+#include <cstdint>
 #include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
 
 namespace dg {
 
@@ -12,85 +15,189 @@ namespace dg {
 //
 //   This is basically just a wrapper for real container, so that
 //   we have the container defined on one place for all edges.
-//   It may have more implementations depending on available features
+//
+//   Most of the containers keep just a few elements, so up to
+//   EXPECTED_ELEMENTS_NUM elements are stored inline (without any
+//   allocation) and searched linearly. When there are more elements,
+//   they are moved to an array on the heap and searched by binary search.
+//   The elements are kept sorted in both cases, so the iteration order
+//   is the same as with std::set. Unlike with std::set, inserting
+//   and erasing invalidates the iterators.
+//
+//   A container can be also frozen - its elements are moved to a storage
+//   that is shared with other containers (see DependenceGraph::freeze()).
+//   The container then only refers to the storage, until it is modified.
+//
+//   The inline elements share the memory with the pointer to the heap
+//   (or to the shared storage), so a container of pointers with four
+//   inline elements takes 40 bytes (std::set takes 48 bytes
+//   and allocates every element).
 /// ------------------------------------------------------------------
-template <typename ValueT, unsigned int EXPECTED_ELEMENTS_NUM = 8>
+template <typename ValueT, unsigned int EXPECTED_ELEMENTS_NUM = 4>
 class DGContainer
 {
 public:
-    // XXX use llvm ADTs when available, or BDDs?
-    typedef typename std::set<ValueT> ContainerT;
-    typedef typename ContainerT::iterator iterator;
-    typedef typename ContainerT::const_iterator const_iterator;
-    typedef typename ContainerT::size_type size_type;
+    typedef const ValueT *iterator;
+    typedef const ValueT *const_iterator;
+    typedef size_t size_type;
+
+    DGContainer() : num(0), cap(INLINE) {}
+
+    DGContainer(const DGContainer& oth) : num(0), cap(INLINE)
+    {
+        store(oth.begin(), oth.size());
+    }
+
+    DGContainer(DGContainer&& oth) : num(0), cap(INLINE)
+    {
+        take(oth);
+    }
+
+    DGContainer& operator=(const DGContainer& oth)
+    {
+        if (this != &oth)
+            store(oth.begin(), oth.size());
+
+        return *this;
+    }
+
+    DGContainer& operator=(DGContainer&& oth)
+    {
+        if (this != &oth) {
+            release();
+            take(oth);
+        }
+
+        return *this;
+    }
+
+    ~DGContainer()
+    {
+        release();
+    }
 
-    iterator begin() { return container.begin(); }
-    const_iterator begin() const { return container.begin(); }
-    iterator end() { return container.end(); }
-    const_iterator end() const { return container.end(); }
+    iterator begin() const { return data(); }
+    iterator end() const { return data() + num; }
 
     size_type size() const
     {
-        return container.size();
+        return num;
     }
 
     bool insert(ValueT n)
     {
-        return container.insert(n).second;
+        size_t idx = lowerBound(n) - data();
+        if (idx != num && !cmp(n, data()[idx]))
+            return false;
+
+        thaw();
+        if (cap == INLINE && num == EXPECTED_ELEMENTS_NUM)
+            grow(); // no more space inline, move the elements to the heap
+        else if (cap != INLINE && num == cap)
+            grow();
+
+        ValueT *d = mutableData();
+        std::move_backward(d + idx, d + num, d + num + 1);
+        d[idx] = n;
+        ++num;
+        return true;
+    }
+
+    // insert all elements of the range at once, the elements
+    // are sorted just once instead of shifting them on every insert.
+    // Return the number of inserted elements
+    template <typename IT>
+    size_t insert(IT first, IT last)
+    {
+        std::vector<ValueT> tmp(begin(), end());
+        tmp.insert(tmp.end(), first, last);
+        std::sort(tmp.begin(), tmp.end(), cmp);
+        tmp.erase(std::unique(tmp.begin(), tmp.end()), tmp.end());
+
+        size_t inserted = tmp.size() - num;
+        if (inserted == 0)
+            return 0;
+
+        store(tmp.data(), tmp.size());
+        return inserted;
     }
 
     bool contains(ValueT n) const
     {
-        return container.count(n) != 0;
+        const ValueT *pos = lowerBound(n);
+        return pos != end() && !cmp(n, *pos);
     }
 
     size_t erase(ValueT n)
     {
-        return container.erase(n);
+        size_t idx = lowerBound(n) - data();
+        if (idx == num || cmp(n, data()[idx]))
+            return 0;
+
+        thaw();
+        ValueT *d = mutableData();
+        std::move(d + idx + 1, d + num, d + idx);
+
+        --num;
+        return 1;
     }
 
     void clear()
     {
-        container.clear();
+        // release the memory
+        release();
+        num = 0;
     }
 
-    bool empty()
+    bool empty() const
     {
-        return container.empty();
+        return num == 0;
     }
 
     void swap(DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth)
     {
-        container.swap(oth.container);
+        DGContainer<ValueT, EXPECTED_ELEMENTS_NUM> tmp(std::move(oth));
+        oth = std::move(*this);
+        *this = std::move(tmp);
     }
 
     void intersect(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth)
     {
-        DGContainer<ValueT, EXPECTED_ELEMENTS_NUM> tmp;
+        thaw();
 
-        std::set_intersection(container.begin(), container.end(),
-                              oth.container.begin(),
-                              oth.container.end(),
-                              std::inserter(tmp.container,
-                                            tmp.container.begin()));
+        // keep the elements that are in both containers,
+        // the order stays sorted
+        ValueT *out = mutableData();
+        for (ValueT *in = out, *e = out + num; in != e; ++in) {
+            if (oth.contains(*in))
+                *out++ = *in;
+        }
 
-        // swap containers
-        container.swap(tmp.container);
+        num = out - mutableData();
     }
 
-    bool operator==(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth) const
+    // move the elements to the end of the storage. The storage
+    // must have enough capacity, so that it is not reallocated
+    // (and the frozen containers that refer to it stay valid)
+    void freeze(std::vector<ValueT>& storage)
     {
-        if (container.size() != oth.size())
-            return false;
+        assert(storage.capacity() - storage.size() >= num
+               && "The storage would be reallocated");
 
-        // the sets are ordered, so this will work
-        iterator snd = oth.container.begin();
-        for (iterator fst = container.begin(), efst = container.end();
-             fst != efst; ++fst, ++snd)
-            if (*fst != *snd)
-                return false;
+        size_t start = storage.size();
+        storage.insert(storage.end(), begin(), end());
 
-        return true;
+        release();
+        st.frozen = storage.data() + start;
+        cap = FROZEN;
+    }
+
+    bool isFrozen() const { return cap == FROZEN; }
+
+    bool operator==(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth) const
+    {
+        // the containers are sorted, so this will work
+        return num == oth.num && std::equal(begin(), end(), oth.begin());
     }
 
     bool operator!=(const DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth) const
@@ -99,7 +206,123 @@ public:
     }
 
 private:
-    ContainerT container;
+    // the values of cap that are not a capacity of the heap array
+    enum : uint32_t { INLINE = 0, FROZEN = ~0u };
+
+    uint32_t num;
+    // the capacity of the array on the heap, or INLINE or FROZEN
+    uint32_t cap;
+
+    union Storage {
+        Storage() {}
+
+        ValueT elems[EXPECTED_ELEMENTS_NUM];
+        // the elements on the heap
+        ValueT *heap;
+        // the elements if the container is frozen
+        const ValueT *frozen;
+    } st;
+
+    static bool cmp(const ValueT& a, const ValueT& b)
+    {
+        return std::less<ValueT>()(a, b);
+    }
+
+    const ValueT *data() const
+    {
+        if (cap == INLINE)
+            return st.elems;
+
+        return cap == FROZEN ? st.frozen : st.heap;
+    }
+
+    ValueT *mutableData()
+    {
+        assert(cap != FROZEN && "Modifying frozen container");
+        return cap == INLINE ? st.elems : st.heap;
+    }
+
+    // free the array on the heap, the elements are not valid then
+    void release()
+    {
+        if (cap != INLINE && cap != FROZEN)
+            delete[] st.heap;
+
+        cap = INLINE;
+    }
+
+    // take over the elements of @oth (this container must not
+    // own any memory), @oth is left empty. Only the used part
+    // of the storage is copied, the rest of it is not initialized
+    void take(DGContainer<ValueT, EXPECTED_ELEMENTS_NUM>& oth)
+    {
+        if (oth.cap == INLINE)
+            std::copy(oth.st.elems, oth.st.elems + oth.num, st.elems);
+        else if (oth.cap == FROZEN)
+            st.frozen = oth.st.frozen;
+        else
+            st.heap = oth.st.heap;
+
+        num = oth.num;
+        cap = oth.cap;
+
+        oth.num = 0;
+        oth.cap = INLINE;
+    }
+
+    // replace the elements with @n elements from @src
+    // (that must not be the storage of this container)
+    void store(const ValueT *src, size_t n)
+    {
+        release();
+        if (n <= EXPECTED_ELEMENTS_NUM) {
+            std::copy(src, src + n, st.elems);
+        } else {
+            ValueT *h = new ValueT[n];
+            std::copy(src, src + n, h);
+            st.heap = h;
+            cap = n;
+        }
+
+        num = n;
+    }
+
+    // move the elements to a bigger array on the heap
+    void grow()
+    {
+        size_t new_cap = 2 * std::max<size_t>(num, EXPECTED_ELEMENTS_NUM);
+        ValueT *h = new ValueT[new_cap];
+        std::copy(data(), data() + num, h);
+
+        release();
+        st.heap = h;
+        cap = new_cap;
+    }
+
+    // copy the elements back from the shared storage,
+    // so that we can modify them
+    void thaw()
+    {
+        if (cap != FROZEN)
+            return;
+
+        store(st.frozen, num);
+    }
+
+    // the first element that is not less than n
+    const ValueT *lowerBound(const ValueT& n) const
+    {
+        const ValueT *b = data();
+        const ValueT *e = b + num;
+
+        if (num > EXPECTED_ELEMENTS_NUM)
+            return std::lower_bound(b, e, n, cmp);
+
+        while (b != e && cmp(*b, n))
+            ++b;
+
+        return b;
+    }
 };
 
 // Edges are pointers to other nodes
@@ -0,0 +1,264 @@
+#ifndef _DG_DENSE_NODES_MAP_H_
+#define _DG_DENSE_NODES_MAP_H_
+
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+/// ------------------------------------------------------------------
+// - DenseNodesMap
+//
+//   A map for nodes (or blocks) of a dependence graph. The entries live
+//   in a vector in the order in which they were inserted (so a node gets
+//   the number of the instruction when the graph is built) and the index
+//   only maps keys to these numbers. Lookups do not chase pointers
+//   through a tree and the iteration is in the order of insertion,
+//   so it does not depend on the addresses of the keys.
+//
+//   The number of an entry is its index in the vector, so a caller that
+//   knows the number (e.g. it walks the instructions of the function
+//   in order) gets the entry by at() without going through the index.
+//
+//   It has the interface of std::map that the dependence graph uses.
+//   Erasing only marks the entry as erased, so the iterators stay valid
+//   when erasing (and also when inserting, since they are indices).
+//   The references to values are invalidated by insertion, though.
+//   The erased entries are dropped by compact(), which renumbers
+//   the entries and so invalidates the iterators and numbers.
+/// ------------------------------------------------------------------
+template <typename KeyT, typename ValueT,
+          typename IndexT = std::unordered_map<KeyT, unsigned>>
+class DenseNodesMap
+{
+public:
+    typedef KeyT key_type;
+    typedef ValueT mapped_type;
+    typedef std::pair<KeyT, ValueT> value_type;
+    typedef size_t size_type;
+
+private:
+    std::vector<value_type> entries;
+    // entries[i] was erased?
+    std::vector<bool> erased;
+    size_t erased_num = 0;
+    IndexT index;
+
+    template <typename ContT, typename EntryT>
+    class iterator_impl
+    {
+        ContT *cont;
+        size_t pos;
+
+        void skipErased()
+        {
+            while (pos < cont->entries.size() && cont->erased[pos])
+                ++pos;
+        }
+
+    public:
+        iterator_impl(ContT *c = nullptr, size_t p = 0)
+            : cont(c), pos(p)
+        {
+            if (cont)
+                skipErased();
+        }
+
+        // iterator -> const_iterator conversion
+        template <typename OthContT, typename OthEntryT>
+        iterator_impl(const iterator_impl<OthContT, OthEntryT>& oth)
+            : cont(oth.cont), pos(oth.pos) {}
+
+        iterator_impl& operator++()
+        {
+            ++pos;
+            skipErased();
+            return *this;
+        }
+
+        iterator_impl operator++(int)
+        {
+            iterator_impl tmp = *this;
+            operator++();
+            return tmp;
+        }
+
+        EntryT& operator*() const { return cont->entries[pos]; }
+        EntryT *operator->() const { return &cont->entries[pos]; }
+
+        bool operator==(const iterator_impl& oth) const
+        {
+            return cont == oth.cont && pos == oth.pos;
+        }
+
+        bool operator!=(const iterator_impl& oth) const
+        {
+            return !operator==(oth);
+        }
+
+        size_t getPosition() const { return pos; }
+
+        template <typename, typename> friend class iterator_impl;
+    };
+
+public:
+    typedef iterator_impl<DenseNodesMap, value_type> iterator;
+    typedef iterator_impl<const DenseNodesMap, const value_type> const_iterator;
+
+    iterator begin() { return iterator(this, 0); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    iterator end() { return iterator(this, entries.size()); }
+    const_iterator end() const { return const_iterator(this, entries.size()); }
+
+    size_type size() const { return index.size(); }
+    bool empty() const { return index.empty(); }
+
+    iterator find(const KeyT& k)
+    {
+        auto it = index.find(k);
+        if (it == index.end())
+            return end();
+
+        return iterator(this, it->second);
+    }
+
+    const_iterator find(const KeyT& k) const
+    {
+        auto it = index.find(k);
+        if (it == index.end())
+            return end();
+
+        return const_iterator(this, it->second);
+    }
+
+    size_type count(const KeyT& k) const
+    {
+        return index.count(k);
+    }
+
+    // get the entry with the given number, end() if there is none
+    iterator at(size_t num)
+    {
+        if (num >= entries.size() || erased[num])
+            return end();
+
+        return iterator(this, num);
+    }
+
+    const_iterator at(size_t num) const
+    {
+        if (num >= entries.size() || erased[num])
+            return end();
+
+        return const_iterator(this, num);
+    }
+
+    // the number of entries that the erased ones left behind
+    size_t getErasedNum() const { return erased_num; }
+
+    std::pair<iterator, bool> insert(const value_type& val)
+    {
+        return emplace(val.first, val.second);
+    }
+
+    std::pair<iterator, bool> emplace(const KeyT& k, const ValueT& v)
+    {
+        unsigned pos = entries.size();
+        auto ret = index.insert(std::make_pair(k, pos));
+        if (!ret.second)
+            return std::make_pair(iterator(this, ret.first->second), false);
+
+        entries.push_back(std::make_pair(k, v));
+        erased.push_back(false);
+
+        return std::make_pair(iterator(this, pos), true);
+    }
+
+    ValueT& operator[](const KeyT& k)
+    {
+        auto ret = emplace(k, ValueT());
+        return ret.first->second;
+    }
+
+    // return the iterator to the next entry, like std::map
+    iterator erase(iterator it)
+    {
+        size_t pos = it.getPosition();
+        assert(pos < entries.size() && !erased[pos] && "Invalid iterator");
+
+        index.erase(entries[pos].first);
+        markErased(pos);
+
+        return ++it;
+    }
+
+    size_type erase(const KeyT& k)
+    {
+        auto it = index.find(k);
+        if (it == index.end())
+            return 0;
+
+        markErased(it->second);
+        index.erase(it);
+        return 1;
+    }
+
+    // drop the erased entries and renumber the rest,
+    // keeping their order. Do not call it while iterating
+    void compact()
+    {
+        if (erased_num == 0)
+            return;
+
+        size_t n = 0;
+        for (size_t i = 0, e = entries.size(); i < e; ++i) {
+            if (erased[i])
+                continue;
+
+            if (n != i) {
+                entries[n] = entries[i];
+                index[entries[n].first] = n;
+            }
+
+            ++n;
+        }
+
+        entries.resize(n);
+        entries.shrink_to_fit();
+        erased.assign(n, false);
+        erased_num = 0;
+    }
+
+    void clear()
+    {
+        entries.clear();
+        erased.clear();
+        erased_num = 0;
+        index.clear();
+    }
+
+    void swap(DenseNodesMap& oth)
+    {
+        entries.swap(oth.entries);
+        erased.swap(oth.erased);
+        std::swap(erased_num, oth.erased_num);
+        index.swap(oth.index);
+    }
+
+private:
+    void markErased(size_t pos)
+    {
+        // the value may own something, do not keep it around
+        entries[pos].second = ValueT();
+        erased[pos] = true;
+        ++erased_num;
+    }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_DENSE_NODES_MAP_H_
@@ -1,6 +1,7 @@
 #ifndef _DG_ADT_QUEUE_H_
 #define _DG_ADT_QUEUE_H_
 
+#include <cstddef>
 #include <stack>
 #include <queue>
 #include <set>
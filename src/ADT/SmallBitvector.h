@@ -0,0 +1,135 @@
+#ifndef _DG_ADT_SMALL_BITVECTOR_H_
+#define _DG_ADT_SMALL_BITVECTOR_H_
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+/// ------------------------------------------------------------------
+// - SmallBitvector
+//
+//   A set of small numbers that grows on demand. The first 64 bits
+//   are stored inline, so the sets of up to 64 elements do not
+//   allocate any memory. The higher bits are stored in a vector
+//   that is allocated only when such a bit is set.
+/// ------------------------------------------------------------------
+class SmallBitvector
+{
+    typedef uint64_t WordT;
+    enum : unsigned { WORD_BITS = 64 };
+
+    // bits 0 - 63
+    WordT word;
+    // the words of bits 64 and more
+    std::vector<WordT> rest;
+
+    static WordT bit(size_t i)
+    {
+        return WordT(1) << (i % WORD_BITS);
+    }
+
+    static unsigned lowestBit(WordT w)
+    {
+        assert(w != 0);
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(w);
+#else
+        unsigned i = 0;
+        while (!(w & 1)) {
+            w >>= 1;
+            ++i;
+        }
+        return i;
+#endif
+    }
+
+public:
+    SmallBitvector() : word(0) {}
+
+    // set the bit, return true if it was not set before
+    bool set(size_t i)
+    {
+        WordT *w = &word;
+        if (i >= WORD_BITS) {
+            size_t idx = i / WORD_BITS - 1;
+            if (idx >= rest.size())
+                rest.resize(idx + 1, 0);
+            w = &rest[idx];
+        }
+
+        bool ret = !(*w & bit(i));
+        *w |= bit(i);
+        return ret;
+    }
+
+    bool test(size_t i) const
+    {
+        if (i < WORD_BITS)
+            return word & bit(i);
+
+        size_t idx = i / WORD_BITS - 1;
+        return idx < rest.size() && (rest[idx] & bit(i));
+    }
+
+    // set all the bits that are set in @oth,
+    // return true if any bit was not set before
+    bool merge(const SmallBitvector& oth)
+    {
+        bool changed = (oth.word & ~word) != 0;
+        word |= oth.word;
+
+        if (rest.size() < oth.rest.size())
+            rest.resize(oth.rest.size(), 0);
+        for (size_t i = 0; i < oth.rest.size(); ++i) {
+            changed |= (oth.rest[i] & ~rest[i]) != 0;
+            rest[i] |= oth.rest[i];
+        }
+
+        return changed;
+    }
+
+    bool empty() const
+    {
+        if (word)
+            return false;
+
+        for (WordT w : rest)
+            if (w)
+                return false;
+
+        return true;
+    }
+
+    size_t count() const
+    {
+        size_t ret = 0;
+        for (WordT w = word; w; w &= w - 1)
+            ++ret;
+        for (WordT w : rest) {
+            for (; w; w &= w - 1)
+                ++ret;
+        }
+
+        return ret;
+    }
+
+    // call @fn(i) for every set bit i in increasing order
+    template <typename FuncT>
+    void forEach(FuncT fn) const
+    {
+        for (WordT w = word; w; w &= w - 1)
+            fn(lowestBit(w));
+        for (size_t i = 0; i < rest.size(); ++i) {
+            for (WordT w = rest[i]; w; w &= w - 1)
+                fn((i + 1) * WORD_BITS + lowestBit(w));
+        }
+    }
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_SMALL_BITVECTOR_H_
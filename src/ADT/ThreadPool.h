@@ -0,0 +1,133 @@
+#ifndef _DG_ADT_THREAD_POOL_H_
+#define _DG_ADT_THREAD_POOL_H_
+
+#include <cassert>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace dg {
+namespace ADT {
+
+/// ------------------------------------------------------------------
+// - ThreadPool
+//
+//   A fixed set of worker threads that take tasks from a shared queue.
+//   The pool is meant for fork-join style work: push a batch of
+//   independent tasks and then wait() until all of them are done.
+//   With zero or one thread the tasks are run directly in push(),
+//   so the sequential code path does not pay for any synchronization.
+/// ------------------------------------------------------------------
+class ThreadPool
+{
+public:
+    typedef std::function<void()> TaskT;
+
+    ThreadPool(unsigned threads = 0)
+        : running(0), stop(false)
+    {
+        if (threads <= 1)
+            return;
+
+        workers.reserve(threads);
+        for (unsigned i = 0; i < threads; ++i)
+            workers.emplace_back(&ThreadPool::worker, this);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            stop = true;
+        }
+
+        task_available.notify_all();
+        for (std::thread& t : workers)
+            t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void push(TaskT task)
+    {
+        if (workers.empty()) {
+            task();
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            tasks.push(std::move(task));
+        }
+
+        task_available.notify_one();
+    }
+
+    // block until the queue is empty and no task is running
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        all_done.wait(lock, [this]{ return tasks.empty() && running == 0; });
+    }
+
+    // number of worker threads (0 when the tasks run in push())
+    size_t size() const { return workers.size(); }
+
+    // run @func(i) for every i in [0, num) and wait for the results
+    template <typename FuncT>
+    void parallelFor(size_t num, FuncT func)
+    {
+        for (size_t i = 0; i < num; ++i)
+            push([func, i]{ func(i); });
+
+        wait();
+    }
+
+private:
+    void worker()
+    {
+        while (true) {
+            TaskT task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                task_available.wait(lock, [this]{ return stop || !tasks.empty(); });
+                if (tasks.empty()) {
+                    assert(stop);
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop();
+                ++running;
+            }
+
+            task();
+
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                --running;
+                if (running == 0 && tasks.empty())
+                    all_done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<TaskT> tasks;
+
+    std::mutex mtx;
+    std::condition_variable task_available;
+    std::condition_variable all_done;
+
+    unsigned running;
+    bool stop;
+};
+
+} // namespace ADT
+} // namespace dg
+
+#endif // _DG_ADT_THREAD_POOL_H_
@@ -6,6 +6,8 @@
 
 #include <cassert>
 #include <list>
+#include <set>
+#include <vector>
 
 #include "ADT/DGContainer.h"
 #include "analysis/Analysis.h"
@@ -28,7 +30,7 @@ public:
     typedef typename NodeT::DependenceGraphType DependenceGraphT;
 
     struct BBlockEdge {
-        BBlockEdge(BBlock<NodeT>* t, uint8_t label = 0)
+        BBlockEdge(BBlock<NodeT>* t = nullptr, uint8_t label = 0)
             : target(t), label(label) {}
 
         BBlock<NodeT> *target;
@@ -54,7 +56,8 @@ public:
     };
 
     BBlock<NodeT>(NodeT *head = nullptr, DependenceGraphT *dg = nullptr)
-        : key(KeyT()), dg(dg), ipostdom(nullptr), slice_id(0)
+        : key(KeyT()), dg(dg), ipostdom(nullptr), slice_id(0),
+          mark_walk_id(0)
     {
         if (head) {
             append(head);
@@ -153,9 +156,9 @@ public:
             // and create new edges to all successors. The new edges
             // will have the same label as the found one
             DGContainer<BBlockEdge> new_edges;
-            for (auto I = pred->nextBBs.begin(),E = pred->nextBBs.end(); I != E;) {
-                auto cur = I++;
-                if (cur->target == this) {
+            DGContainer<BBlockEdge> old_edges;
+            for (const BBlockEdge& edge : pred->nextBBs) {
+                if (edge.target == this) {
                     // create edges that will go from the predecessor
                     // to every successor of this node
                     for (const BBlockEdge& succ : nextBBs) {
@@ -163,14 +166,18 @@ public:
                         // that would be incorrect. It can occur when we're isolatin a bblock
                         // with self-loop
                         if (succ.target != this)
-                            new_edges.insert(BBlockEdge(succ.target, cur->label));
+                            new_edges.insert(BBlockEdge(succ.target, edge.label));
                     }
 
-                    // remove the edge from predecessor
-                    pred->nextBBs.erase(*cur);
+                    old_edges.insert(edge);
                 }
             }
 
+            // remove the edges from predecessor (not while
+            // iterating over them, erasing invalidates the iterators)
+            for (const BBlockEdge& edge : old_edges)
+                pred->nextBBs.erase(edge);
+
             // add newly created edges to predecessor
             for (const BBlockEdge& edge : new_edges) {
                 assert(edge.target != this
@@ -324,6 +331,18 @@ public:
         return ret;
     }
 
+    // add the control dependencies on this block to all
+    // the blocks in the range at once
+    template <typename IT>
+    size_t addControlDependencies(IT first, IT last)
+    {
+        size_t ret = controlDeps.insert(first, last);
+        for (; first != last; ++first)
+            (*first)->revControlDeps.insert(this);
+
+        return ret;
+    }
+
     // get first node from bblock
     // or nullptr if the block is empty
     NodeT *getFirstNode() const
@@ -353,6 +372,12 @@ public:
         return postDomFrontiers.insert(BB);
     }
 
+    template <typename IT>
+    size_t addPostDomFrontiers(IT first, IT last)
+    {
+        return postDomFrontiers.insert(first, last);
+    }
+
     void setIPostDom(BBlock<NodeT> *BB)
     {
         assert(!ipostdom && "Already has the immedate post-dominator");
@@ -405,6 +430,31 @@ public:
 
     uint64_t getSlice() const { return slice_id; }
 
+    // the id of the last marking walk that got
+    // to this block (see analysis::WalkAndMark)
+    unsigned int getMarkWalk() const { return mark_walk_id; }
+    void setMarkWalk(unsigned int id) { mark_walk_id = id; }
+
+    // the number of edges that freezeEdges() moves to @blocks
+    size_t getBlockEdgesNum() const
+    {
+        return prevBBs.size() + controlDeps.size() + revControlDeps.size()
+                + postDomFrontiers.size() + postDominators.size();
+    }
+
+    // move the edges to the arrays that are shared by all blocks
+    // of the graph (see DependenceGraph::freeze())
+    void freezeEdges(std::vector<BBlockEdge>& succs,
+                     std::vector<BBlock<NodeT> *>& blocks)
+    {
+        nextBBs.freeze(succs);
+        prevBBs.freeze(blocks);
+        controlDeps.freeze(blocks);
+        revControlDeps.freeze(blocks);
+        postDomFrontiers.freeze(blocks);
+        postDominators.freeze(blocks);
+    }
+
     void deleteNodesOnDestruction(bool v = true) {
         delete_nodes_on_destr = v;
     }
@@ -437,6 +487,7 @@ private:
 
     // is this block in some slice?
     uint64_t slice_id;
+    unsigned int mark_walk_id;
 
     // delete nodes on destruction of the block
     bool delete_nodes_on_destr = false;
@@ -6,6 +6,8 @@
 #include <map>
 #include <cassert>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "BBlock.h"
 #include "ADT/DGContainer.h"
@@ -37,11 +39,11 @@ public:
     // type of this dependence graph - so that we can refer to it in the code
     typedef typename NodeT::DependenceGraphType DependenceGraphT;
 
-    typedef std::map<KeyT, NodeT *> ContainerType;
+    typedef typename NodeT::NodesContainerType ContainerType;
     typedef typename ContainerType::iterator iterator;
     typedef typename ContainerType::const_iterator const_iterator;
 #ifdef ENABLE_CFG
-    typedef std::map<KeyT, BBlock<NodeT> *> BBlocksMapT;
+    typedef typename NodeT::BBlocksContainerType BBlocksMapT;
 #endif
 
 private:
@@ -66,6 +68,10 @@ private:
 
     // is the graph in some slice?
     uint64_t slice_id;
+    // the last marking walk that got to the graph
+    unsigned int mark_walk_id;
+    // did the slicer prepare the graph already?
+    bool prepared;
 
 #ifdef ENABLE_CFG
     // blocks contained in this graph
@@ -80,6 +86,22 @@ private:
     BBlock<NodeT> *PDTreeRoot;
 #endif // ENABLE_CFG
 
+    // the edges of the frozen graph (see freeze()). For every kind
+    // of edges there is one array with the edges of all nodes
+    // (blocks), the nodes refer to their part of the array
+    struct FrozenEdges {
+        std::vector<NodeT *> control;
+        std::vector<NodeT *> rev_control;
+        std::vector<NodeT *> data;
+        std::vector<NodeT *> rev_data;
+#ifdef ENABLE_CFG
+        std::vector<typename BBlock<NodeT>::BBlockEdge> successors;
+        std::vector<BBlock<NodeT> *> blocks;
+#endif
+    };
+
+    std::unique_ptr<FrozenEdges> frozen;
+
 protected:
     // nodes contained in this dg. They are protected, so that
     // child classes can access them directly
@@ -91,7 +113,7 @@ protected:
 public:
     DependenceGraph<NodeT>()
         : entryNode(nullptr), exitNode(nullptr), formalParameters(nullptr),
-          refcount(1), slice_id(0)
+          refcount(1), slice_id(0), mark_walk_id(0), prepared(false)
 #ifdef ENABLE_CFG
         , entryBB(nullptr), exitBB(nullptr), PDTreeRoot(nullptr)
 #endif
@@ -397,6 +419,118 @@ public:
 
     uint64_t getSlice() const { return slice_id; }
 
+    // the id of the last marking walk that got
+    // to this graph (see analysis::WalkAndMark)
+    unsigned int getMarkWalk() const { return mark_walk_id; }
+    void setMarkWalk(unsigned int id) { mark_walk_id = id; }
+
+    // set when the slicer prepared the graph, so that
+    // it is prepared only once (see Slicer::prepareGraph())
+    bool isPrepared() const { return prepared; }
+    void setPrepared() { prepared = true; }
+
+    // Move the edges of the nodes (and blocks) of this graph to arrays
+    // that are shared by the whole graph, so that the edges are stored
+    // in the compressed sparse row form. Call it once the graph is built,
+    // the graph is then walked over few arrays instead of over the memory
+    // allocated by every node. The graph can be still modified, the node
+    // then copies its edges from the arrays again.
+    // The global nodes are not frozen, since they can outlive this graph.
+    void freeze()
+    {
+        std::set<NodeT *> seen;
+        std::vector<NodeT *> toFreeze;
+
+        auto addNode = [&seen, &toFreeze](NodeT *n) {
+            if (n && seen.insert(n).second)
+                toFreeze.push_back(n);
+        };
+
+        auto addParams = [&addNode](DGParameters<NodeT> *params) {
+            if (!params)
+                return;
+
+            for (auto& it : *params) {
+                addNode(it.second.in);
+                addNode(it.second.out);
+            }
+
+            for (auto I = params->global_begin(), E = params->global_end();
+                 I != E; ++I) {
+                addNode(I->second.in);
+                addNode(I->second.out);
+            }
+
+            if (DGParameter<NodeT> *va = params->getVarArg()) {
+                addNode(va->in);
+                addNode(va->out);
+            }
+        };
+
+        for (auto& it : nodes) {
+            addNode(it.second);
+            addParams(it.second->getParameters());
+        }
+
+        addParams(formalParameters);
+        if (exitNode && exitNode->getDG() == this)
+            addNode(exitNode);
+
+        // the new arrays are filled from the old ones
+        // if the graph has been frozen already
+        std::unique_ptr<FrozenEdges> fr(new FrozenEdges());
+
+        size_t cnum = 0, rcnum = 0, dnum = 0, rdnum = 0;
+        for (NodeT *n : toFreeze) {
+            cnum += n->getControlDependenciesNum();
+            rcnum += n->getRevControlDependenciesNum();
+            dnum += n->getDataDependenciesNum();
+            rdnum += n->getRevDataDependenciesNum();
+        }
+
+        fr->control.reserve(cnum);
+        fr->rev_control.reserve(rcnum);
+        fr->data.reserve(dnum);
+        fr->rev_data.reserve(rdnum);
+
+        for (NodeT *n : toFreeze)
+            n->freezeEdges(fr->control, fr->rev_control,
+                           fr->data, fr->rev_data);
+
+#ifdef ENABLE_CFG
+        std::set<BBlock<NodeT> *> seenBlocks;
+        std::vector<BBlock<NodeT> *> blocksToFreeze;
+
+        auto addBlock = [&seenBlocks, &blocksToFreeze](BBlock<NodeT> *B) {
+            if (B && seenBlocks.insert(B).second)
+                blocksToFreeze.push_back(B);
+        };
+
+        for (auto& it : _blocks)
+            addBlock(it.second);
+
+        addBlock(entryBB);
+        addBlock(exitBB);
+        addBlock(PDTreeRoot);
+
+        size_t snum = 0, bnum = 0;
+        for (BBlock<NodeT> *B : blocksToFreeze) {
+            snum += B->successorsNum();
+            bnum += B->getBlockEdgesNum();
+        }
+
+        fr->successors.reserve(snum);
+        fr->blocks.reserve(bnum);
+
+        for (BBlock<NodeT> *B : blocksToFreeze)
+            B->freezeEdges(fr->successors, fr->blocks);
+#endif // ENABLE_CFG
+
+        frozen = std::move(fr);
+    }
+
+    bool isFrozen() const { return frozen != nullptr; }
+
 #ifdef ENABLE_CFG
     // get blocks contained in this graph
     BBlocksMapT& getBlocks() { return _blocks; }
@@ -4,6 +4,9 @@
 #ifndef _NODE_H_
 #define _NODE_H_
 
+#include <map>
+#include <vector>
+
 #include "DGParameters.h"
 #include "ADT/DGContainer.h"
 #include "analysis/Analysis.h"
@@ -32,6 +35,13 @@ public:
     typedef KeyT KeyType;
     typedef DependenceGraphT DependenceGraphType;
 
+    // containers that the dependence graph uses for nodes and blocks.
+    // A concrete node can redefine them to change the storage
+    typedef std::map<KeyT, NodeT *> NodesContainerType;
+#ifdef ENABLE_CFG
+    typedef std::map<KeyT, BBlock<NodeT> *> BBlocksContainerType;
+#endif
+
     typedef typename ControlEdgesT::iterator control_iterator;
     typedef typename ControlEdgesT::const_iterator const_control_iterator;
     typedef typename DependenceEdgesT::iterator data_iterator;
@@ -231,6 +241,19 @@ public:
     unsigned int getDataDependenciesNum() const { return dataDepEdges.size(); }
     unsigned int getRevDataDependenciesNum() const { return revDataDepEdges.size(); }
 
+    // move the edges to the arrays that are shared by all nodes
+    // of the graph (see DependenceGraph::freeze())
+    void freezeEdges(std::vector<NodeT *>& control,
+                     std::vector<NodeT *>& rev_control,
+                     std::vector<NodeT *>& data,
+                     std::vector<NodeT *>& rev_data)
+    {
+        controlDepEdges.freeze(control);
+        revControlDepEdges.freeze(rev_control);
+        dataDepEdges.freeze(data);
+        revDataDepEdges.freeze(rev_data);
+    }
+
 #ifdef ENABLE_CFG
     BBlock<NodeT> *getBBlock() { return basicBlock; }
     const BBlock<NodeT> *getBBlock() const { return basicBlock; }
@@ -1,11 +1,15 @@
 #ifndef _DG_CE_NODE_H_
 #define _DG_CE_NODE_H_
 
-#include <list>
+#include <memory>
 #include <set>
+#include <utility>
+#include <vector>
 //#include <iostream>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <new>
 
 namespace dg {
 
@@ -18,6 +22,61 @@ enum CENodeType {
 };
 
 template <typename T> class CELabel;
+class CENode;
+
+/// ------------------------------------------------------------------
+// - CENodeArena
+//
+//   The nodes of control expressions are allocated in chunks
+//   of memory owned by the arena and they are all destroyed
+//   together with the arena. The nodes do not delete each other,
+//   so they can be shared and the nodes that are not used anymore
+//   (e.g. the labels of eliminated edges) are released with the rest.
+/// ------------------------------------------------------------------
+class CENodeArena {
+    enum : size_t { CHUNK_SIZE = 64 * 1024 };
+
+    std::vector<std::unique_ptr<char[]>> chunks;
+    // the used bytes of the last chunk
+    size_t used;
+    // the nodes in the order of creation
+    std::vector<CENode *> nodes;
+
+    void *allocate(size_t size)
+    {
+        // new char[] returns a memory aligned for any object
+        const size_t align = alignof(std::max_align_t);
+        size = (size + align - 1) / align * align;
+        assert(size <= CHUNK_SIZE && "Too big node");
+
+        if (chunks.empty() || used + size > CHUNK_SIZE) {
+            chunks.emplace_back(new char[CHUNK_SIZE]);
+            used = 0;
+        }
+
+        void *mem = chunks.back().get() + used;
+        used += size;
+        return mem;
+    }
+
+public:
+    CENodeArena() : used(0) {}
+    inline ~CENodeArena();
+
+    CENodeArena(const CENodeArena&) = delete;
+    CENodeArena& operator=(const CENodeArena&) = delete;
+
+    template <typename NodeT, typename... Args>
+    NodeT *create(Args&&... args)
+    {
+        NodeT *n = new (allocate(sizeof(NodeT))) NodeT(std::forward<Args>(args)...);
+        nodes.push_back(n);
+        return n;
+    }
+
+    // the number of created nodes
+    size_t size() const { return nodes.size(); }
+};
 
 class CENode {
     // to avoid RTTI
@@ -39,13 +98,31 @@ public:
     typedef std::set<CENode *, CECmp> VisitsSetT;
 
 protected:
-    CENode *parent;
-    std::list<CENode *> children;
+    // the nodes are shared (see CFA), so a node
+    // may be a child of more nodes
+    std::vector<CENode *> children;
 
     VisitsSetT alwaysVisits;
     VisitsSetT sometimesVisits;
+    // the labels that are visited on all the paths that stay
+    // in a loop of this node forever (if there is a loop)
+    VisitsSetT loopVisits;
+    bool hasLoop;
+    // the sets of a shared node are computed only once
+    bool setsComputed;
 
-    CENode(CENodeType t) : type(t), parent(nullptr) {}
+    CENode(CENodeType t) : type(t), hasLoop(false), setsComputed(false) {}
+
+    // return true if the sets were computed already,
+    // otherwise the caller computes them
+    bool checkSetsComputed()
+    {
+        if (setsComputed)
+            return true;
+
+        setsComputed = true;
+        return false;
+    }
 
     void pruneSometimesVisits()
     {
@@ -60,148 +137,48 @@ protected:
         diff.swap(sometimesVisits);
     }
 
-public:
-    class path_iterator {
-        CENode *node;
-
-        // iterator to the container that contains
-        // this node. The invariant is that *it == node
-        // or node == nullptr for end()
-        std::list<CENode *>::iterator it;
-
-        void iteratorReinit(CENode *nd)
-        {
-            if (nd && nd->parent) {
-                it = std::find(nd->parent->children.begin(),
-                               nd->parent->children.end(), nd);
-                node = nd;
-            } else
-                node = nullptr;
-        }
-
-        void moveUp()
-        {
-            assert(node->parent);
-
-            // shift the iterator to the parent node
-            iteratorReinit(node->parent);
-
-            // we're at the end of the expression
-            if (node == nullptr)
-                return;
-
-            if (node->isa(LOOP)) {
-                // when the node is loop, we want it in the path,
-                // since the loop is where the execution continues
-                node = *it;
-            } else if (node->parent && node->parent->isa(BRANCH)) {
-                // is the node's parent a BRANCH? In that case
-                // we must move up again
-                moveUp();
-            } else {
-                // try to shift the iterator one position
-                // to the right and check if we are not at
-                // the end
-                ++it;
-                if (node->parent->children.end() == it)
-                    // if we are again at the end, try it again
-                    moveUp();
-                else
-                    node = *it;
-            }
-        }
-
-    public:
-        path_iterator(CENode *nd)
-        {
-            iteratorReinit(nd);
-            // in the case that node was set to nullptr
-            // here, we reset it back to nd, so that
-            // we have valid begin() corresponding to 'this'
-            node = nd;
-        }
-
-        path_iterator()
-            : node(nullptr)
-        {
-        }
-
-        bool operator==(const path_iterator& oth) const
-        {
-            return node == oth.node;
-        }
-
-        bool operator!=(const path_iterator& oth) const
-        {
-            return node != oth.node;
-        }
-
-        path_iterator& operator++()
-        {
-            if (node->parent) {
-                // in SEQ and LOOPs we shift just to the right,
-                // but in BRANCH we shift _up_
-                if (node->parent->isa(BRANCH)) {
-                        moveUp();
-                } else {
-                    ++it;
-
-                    if (node->parent->children.end() == it)
-                        moveUp();
-                    else
-                        node = *it;
-                }
-            } else
-                node = nullptr;
-
-            return *this;
-        }
-
-        path_iterator operator++(int)
-        {
-            path_iterator tmp = *this;
-            operator++();
-            return tmp;
-        }
-
-        CENode *operator*()
-        {
-            return node;
-        }
-
-        CENode **operator->()
-        {
-            return &node;
-        }
-    };
-
-    path_iterator path_begin()
+    // the path may stay forever in a loop that visits @visits
+    void addLoopVisits(const VisitsSetT& visits)
     {
-        return path_iterator(this);
-    }
+        if (!hasLoop) {
+            loopVisits = visits;
+            hasLoop = true;
+            return;
+        }
 
-    path_iterator path_end()
-    {
-        return path_iterator();
+        VisitsSetT intersect;
+        std::set_intersection(loopVisits.begin(), loopVisits.end(),
+                              visits.begin(), visits.end(),
+                              std::inserter(intersect, intersect.end()),
+                              CECmp());
+        intersect.swap(loopVisits);
     }
 
-    virtual ~CENode()
+    // compute the sets of the sequence of the children
+    // into the given sets (used by sequences and loops)
+    void computeSeqSets(VisitsSetT& always, VisitsSetT& sometimes)
     {
-        for (CENode *n : children)
-            delete n;
-    }
+        for (CENode *chld : children) {
+            // the path may stay in a loop of the child,
+            // then it visits only what was before and the loop
+            if (chld->hasLoop) {
+                VisitsSetT visits = always;
+                visits.insert(chld->loopVisits.begin(), chld->loopVisits.end());
+                addLoopVisits(visits);
+            }
 
-    void setParent(CENode *p)
-    {
-        parent = p;
+            always.insert(chld->alwaysVisits.begin(), chld->alwaysVisits.end());
+            sometimes.insert(chld->sometimesVisits.begin(),
+                             chld->sometimesVisits.end());
+        }
     }
 
-    CENode *getParent() const
-    {
-        return parent;
-    }
+public:
+    // the children are not deleted, all the nodes
+    // are owned by the arena that created them
+    virtual ~CENode() {}
 
-    std::list<CENode *>& getChildren()
+    const std::vector<CENode *>& getChildren() const
     {
         return children;
     }
@@ -221,10 +198,20 @@ public:
         return sometimesVisits;
     }
 
+    // the path may stay in a loop of this node forever
+    bool mayLoop() const
+    {
+        return hasLoop;
+    }
+
+    const VisitsSetT& getLoopVisits() const
+    {
+        return loopVisits;
+    }
+
     void addChild(CENode *n)
     {
         children.push_back(n);
-        n->parent = this;
     }
 
     // type identification and casting
@@ -256,30 +243,6 @@ public:
         return type > CENodeType::LABEL;
     }
 
-    // recursively clone children
-    // from 'this' to 'n'
-    void cloneChildrenTo(CENode *n) const
-    {
-        std::list<CENode *> chlds;
-        for (CENode *chld : children) {
-            CENode *nch = chld->clone();
-            nch->parent = n;
-            chlds.push_back(nch);
-        }
-
-        n->children.swap(chlds);
-    }
-
-    virtual CENode *clone() const
-    {
-        // (we don't need it right now,
-        // but it should be done)
-        CENode *n = new CENode(*this);
-        n->parent = nullptr;
-        cloneChildrenTo(n);
-        return n;
-    }
-
     // compute alwaysVisits and sometimesVisits sets
     virtual void computeSets()
     {
@@ -299,10 +262,6 @@ public:
         // not very effective
         auto mkind = [&ind]{for (int i = 0; i < ind; ++i) { std::cout << " "; }};
 
-        // DEBUG: do a check
-        for (auto chld : children)
-            assert(chld->parent == this);
-
         mkind();
         //std::cout << "<" << this << ">";
         switch(type) {
@@ -360,101 +319,6 @@ public:
     }
 */
 
-    /*
-     * simplify the CENode and its children
-     * (recursively the whole subtree),
-     * for example, move subsequent sequences to this
-     * node, since it is the same (dot is the SEQ symbol):
-     *      .            .
-     *     / \         / | \
-     *    .   C  =    A  B  C
-     *   / \
-     *  A   B
-     */
-    void simplify()
-    {
-        // fist simplify the children
-        if (!children.empty())
-            for (CENode *chld : children)
-                chld->simplify();
-
-        // we'll create new container
-        // and then we swap the contents
-        std::list<CENode *> new_children;
-        for (auto I = children.begin(), E = children.end();
-             I != E; ++I) {
-            // if this node is a SEQ node
-            // and it has a child also SEQ,
-            // just merge the child SEQ into
-            // this node. Also, if this is a loop and
-            // it contains SEQ, we can make the SEQ
-            // just a children of the loop
-            if ((*I)->type == SEQ &&
-                (type == SEQ || type == LOOP)) {
-                    // we over-take the children,
-                    for (CENode *chld : (*I)->children) {
-                        new_children.push_back(chld);
-                        // set the new parent
-                        chld->parent = this;
-                    }
-                    // we over-took the children
-                    // so clear the container, so that we won't
-                    // delete the memory twice
-                    (*I)->children.clear();
-
-                    // now we can delete the memory
-                    delete *I;
-            } else if ((*I)->type == SEQ && (*I)->children.size() == 1) {
-                    // eliminate sequence when there is only one node in it
-
-                    CENode *chld = *((*I)->children.begin());
-                    new_children.push_back(chld);
-                    // set the new parent
-                    chld->parent = this;
-
-                    // we over-took the child
-                    // so clear the container, so that we won't
-                    // delete the memory twice
-                    (*I)->children.clear();
-
-                    // now we can delete the memory
-                    delete *I;
-            } else if (type == SEQ && (*I)->type == EPS) {
-                // skip epsilons in SEQuences
-                // (and since we drop the pointer,
-                // release the memory)
-                delete *I;
-                continue;
-            } else {
-                // no change? so just copy the child
-                assert((*I)->parent == this);
-                new_children.push_back(*I);
-            }
-        }
-
-        // put into children the newly computed children
-        children.swap(new_children);
-
-        // DEBUG, remove
-        for (CENode *nd : children)
-            assert(nd->parent == this);
-
-    }
-
-    // get the closest loop that is above this node
-    CENode *getParentLoop() const
-    {
-        return [](const CENode *nd) -> CENode * {
-            CENode *par = nd->getParent();
-            if (par) {
-                if (par->isa(LOOP))
-                    return par;
-                else
-                    return par->getParentLoop();
-            } else
-                return nullptr;
-        }(this);
-    }
 };
 
 template <typename T>
@@ -477,22 +341,12 @@ public:
             return this < n;
     }
 
-    virtual CENode *clone() const override
-    {
-        assert(!hasChildren() && "A label has children");
-
-        // this node do not have children,
-        // so a shallow copy is OK
-        CENode *n = new CELabel(*this);
-        n->setParent(nullptr);
-        return n;
-    }
-
     virtual void computeSets() override
     {
         assert(!hasChildren() && "A label has children, whata?");
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
+        if (checkSetsComputed())
+            return;
+
         // A label always just goes over itself.
         // We may skip this, but this way the computation
         // is easier.
@@ -518,18 +372,11 @@ class CESeq: public CESymbol {
 public:
     CESeq(): CESymbol(CENodeType::SEQ) {}
 
-    virtual CENode *clone() const override
-    {
-        CENode *n = new CESeq(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
-    }
-
     virtual void computeSets() override
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
+        if (checkSetsComputed())
+            return;
+
         assert(hasChildren() && "Sequence/loop has no children");
 
         // first recurse into children
@@ -538,14 +385,7 @@ public:
 
         // here we just make the union of children's
         // always and sometimes sets
-        for (CENode *chld : children) {
-            for (CENode *ch : chld->getAlwaysVisits())
-                alwaysVisits.insert(ch);
-
-            for (CENode *ch : chld->getSometimesVisits())
-                if (alwaysVisits.count(ch) == 0)
-                    sometimesVisits.insert(ch);
-        }
+        computeSeqSets(alwaysVisits, sometimesVisits);
 
         // delete the elements from sometimesVisits
         // that are in alwaysVisits. We tried to do it
@@ -559,18 +399,11 @@ class CEBranch: public CESymbol {
 public:
     CEBranch(): CESymbol(CENodeType::BRANCH) {}
 
-    virtual CENode *clone() const override
-    {
-        CENode *n = new CEBranch(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
-    }
-
     virtual void computeSets() override
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
+        if (checkSetsComputed())
+            return;
+
         assert(hasChildren() && "Branch has no children");
 
         // first recurse into children
@@ -607,6 +440,9 @@ public:
             for (CENode *ch : chld->getSometimesVisits())
                 if (getAlwaysVisits().count(ch) == 0)
                     getSometimesVisits().insert(ch);
+
+            if (chld->mayLoop())
+                addLoopVisits(chld->getLoopVisits());
         }
 
         pruneSometimesVisits();
@@ -617,38 +453,27 @@ class CELoop: public CESymbol {
 public:
     CELoop(): CESymbol(CENodeType::LOOP) {}
 
-    virtual CENode *clone() const override
-    {
-        CENode *n = new CELoop(*this);
-        n->setParent(nullptr);
-        cloneChildrenTo(n);
-        return n;
-    }
-
     virtual void computeSets() override
     {
-        assert(alwaysVisits.empty());
-        assert(sometimesVisits.empty());
+        if (checkSetsComputed())
+            return;
+
         assert(hasChildren() && "Branch has no children");
 
         // first recurse into children
         for (CENode *chld : children)
             chld->computeSets();
 
-        // while computing sets, we suppose the loop
-        // is always executed - the cases where it may
-        // not be executed are solved later when browsing
-        // the paths
-        for (CENode *chld : children) {
-            for (CENode *ch : chld->getAlwaysVisits())
-                alwaysVisits.insert(ch);
+        // the children are the body of the loop. The body
+        // may be iterated zero times, so nothing is always
+        // visited, or forever. Then the path visits at least
+        // what one iteration visits on all paths (repeating
+        // the same iteration), or it stays in a loop of the body
+        VisitsSetT body;
+        computeSeqSets(body, sometimesVisits);
+        addLoopVisits(body);
 
-            for (CENode *ch : chld->getSometimesVisits())
-                if (alwaysVisits.count(ch) == 0)
-                    sometimesVisits.insert(ch);
-        }
-
-        pruneSometimesVisits();
+        sometimesVisits.insert(body.begin(), body.end());
     }
 };
 
@@ -656,13 +481,10 @@ class CEEps: public CESymbol {
 public:
     CEEps(): CESymbol(CENodeType::EPS) {}
 
-    virtual CENode *clone() const override
+    // the empty path visits nothing
+    virtual void computeSets() override
     {
-        // we do not have children,
-        // make a shallow copy
-        CENode *n = new CEEps(*this);
-        n->setParent(nullptr);
-        return n;
+        checkSetsComputed();
     }
 
     /*
@@ -673,6 +495,14 @@ public:
     */
 };
 
+CENodeArena::~CENodeArena()
+{
+    // the nodes may refer to each other,
+    // but they do not touch each other when destroyed
+    for (CENode *n : nodes)
+        n->~CENode();
+}
+
 } // namespace dg
 
 #endif // _DG_CE_NODE_H_
@@ -1,9 +1,16 @@
 #ifndef _DG_CE_CFA_H_
 #define _DG_CE_CFA_H_
 
-#include <list>
-#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
 #include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 //#include <iostream>
 
 #include "CENode.h"
@@ -11,355 +18,418 @@
 
 namespace dg {
 
+template <typename T> class CFA;
+
 template <typename T>
 class CFANode {
     T label;
+    // the number of the node in its CFA
+    unsigned id;
+
+    // order the edges by the numbers of nodes,
+    // so that the elimination does not depend on addresses
+    struct IDCmp {
+        bool operator()(const CFANode<T> *a, const CFANode<T> *b) const
+        {
+            return a->id < b->id;
+        }
+    };
+
 public:
-    typedef std::pair<CFANode<T> *, CENode *> EdgeT;
+    // the labels of the edges are shared (see CFA)
+    typedef std::map<CFANode<T> *, CENode *, IDCmp> SuccessorsT;
+    // for predecessors, we need only the information
+    // that the predecessor has an edge to this node
+    typedef std::set<CFANode<T> *, IDCmp> PredecessorsT;
+
+    CFANode<T>(const T& l, unsigned i)
+        : label(l), id(i) {}
 
-    CFANode<T>(const T& l)
-        :label(l) {}
+    const T& getLabel() const { return label; }
+    unsigned getID() const { return id; }
 
-    // move constructor
-    CFANode<T>(CFANode<T>&& other)
-        : label(std::move(other.label)),
-          successors(std::move(other.successors)),
-          predecessors(std::move(other.predecessors))
+    const SuccessorsT& getSuccessors() const
     {
+        return successors;
     }
 
-    // move assign operator
-    CFANode<T>& operator=(CFANode<T>&& other)
+    const PredecessorsT& getPredecessors() const
     {
-        other.successors.swap(successors);
-        other.predecessors.swap(predecessors);
-        label = std::move(other.label);
-        return *this;
+        return predecessors;
     }
 
-    ~CFANode<T>()
+    bool hasSelfLoop() const
     {
-        for (EdgeT& edge : successors) {
-            // delete the labels, we allocate them
-            // using 'new'
-            delete edge.second;
-        }
+        return predecessors.count(const_cast<CFANode<T> *>(this)) != 0;
     }
 
-    // add a new successors - merge two successors
-    // when they go to the same node
-    void addSuccessor(EdgeT succ)
+    size_t successorsNum() const
     {
-        bool found = false;
-
-        for (auto I = successors.begin(), E = successors.end();
-             I != E; ++I) {
-            // we already have an edge to this successor?
-            if (I->first == succ.first) {
-                // if the label already is a branch, just
-                // add new branch to it (take over the ownership)
-                if (I->second->isa(BRANCH)) {
-                    I->second->addChild(succ.second);
-                } else {
-                    CEBranch *br = new CEBranch();
-                    br->addChild(I->second);
-                    br->addChild(succ.second);
-                    // set the new label
-                    I->second = br;
-                }
-
-                // we always have maximally one such successor
-                found = true;
-                break;
-            }
-        }
-
-        if (!found) {
-            successors.push_back(succ);
-            succ.first->predecessors.insert(this);
-        }
+        return successors.size();
     }
 
-    // simple helper that adds successors to a node
-    // and sets the label for the node
-    void addSuccessor(CFANode<T> *n)
+    size_t predecessorsNum() const
     {
-        addSuccessor(EdgeT(n, new CELabel<T>(n->label)));
+        return predecessors.size();
     }
 
-    const std::list<EdgeT>& getSuccessors() const
+    void print() const
     {
-        return successors;
+        for (const auto& s : successors)
+            s.second->print();
     }
 
-    void eliminate()
-    {
-        // entry or exit node should not be removed
-        if (successors.empty() ||
-            predecessors.empty())
-                return;
-
-        // merge multiple self-loops into one self
-        // loop and get a flag if we have a self-loop.
-        // When we have a self-loop, we must insert it
-        // into the new labels
-        CENode *self_loop_label = getSelfLoopLabel();
-
-        // are we a node that has only self-loop, but no successor
-        // or predecessor?
-        if (successors.size() == 1 &&
-            successors.begin()->first == this)
-            return;
-
-        for (CFANode<T> *pred : predecessors) {
-            // skip self-loops, we must handle them
-            // differently
-            if (pred == this)
-                continue;
+private:
+    // we need both links, because when eliminating,
+    // we must know what edges go to this node
+    SuccessorsT successors;
+    PredecessorsT predecessors;
 
-            std::vector<EdgeT> new_edges;
-
-            for (auto I = pred->successors.begin(),
-                      E = pred->successors.end();
-                 I != E;) {
-
-                // is this the edge that points to this node?
-                if (I->first == this) {
-                    auto tmp = I++;
-
-                    for (EdgeT& edge : successors) {
-                        // do not add self-loops to this
-                        // node, we're eliminating
-                        if (edge.first == this)
-                            continue;
-
-                        // create a new label
-                        CESeq *seq = new CESeq();
-                        // add the label of the edge
-                        seq->addChild(tmp->second->clone());
-
-                        // if we have a self-loop, add it too
-                        if (self_loop_label) {
-                            CELoop *L = new CELoop();
-                            L->addChild(self_loop_label->clone());
-                            seq->addChild(L);
-                        }
-
-                        // and now add the label of the successor edge
-                        seq->addChild(edge.second->clone());
-
-                        // and add the new edge from the predecessor
-                        // to the successor (now to the container,
-                        // we add them later so that we won't corrupt
-                        // the end() iterator)
-                        new_edges.push_back(EdgeT(edge.first, seq));
-                    }
-
-                    // erase the old edge
-                    delete tmp->second;
-                    pred->successors.erase(tmp);
-                } else {
-                    // this is an edge that goes somewhere else
-                    // that to this node, so just continue iterating
-                    ++I;
-                }
-            }
+    friend class CFA<T>;
+};
+
+// the order in which the nodes of the CFA are eliminated.
+// It changes only the shape of the control expression,
+// not the paths that the expression describes
+enum class CFAEliminationOrder {
+    // the node with the least predecessors and successors first,
+    // that keeps the number of new edges (and the expression) small
+    MIN_DEGREE,
+    // the nodes in the order of creation
+    CREATION,
+};
 
-            // add the new edges from predecessor to successors
-            for (EdgeT& e : new_edges)
-                pred->addSuccessor(e);
+/// ------------------------------------------------------------------
+// - CFA
+//
+//   The automaton is built from the CFG of a procedure and the nodes
+//   are eliminated one by one (state elimination), the labels of the
+//   eliminated edges are concatenated into the labels of the new edges.
+//   At the end, there is only the edge from the root to the end and
+//   its label is the control expression of the procedure.
+//
+//   The labels are never modified once created, so the new labels
+//   share the old ones instead of copying them. The labels are also
+//   hash-consed: a label of the same type and with the same children
+//   is created only once, so the repeated sub-expressions do not take
+//   any more memory. The labels form a DAG then and the control
+//   expression is this DAG (see ControlExpression).
+/// ------------------------------------------------------------------
+template <typename T>
+class CFA {
+    typedef CFANode<T> NodeT;
+
+    // the key of a symbol (a label that is not CELabel)
+    struct SymbolKey {
+        CENodeType type;
+        std::vector<CENode *> children;
+
+        bool operator==(const SymbolKey& oth) const
+        {
+            return type == oth.type && children == oth.children;
         }
+    };
 
-        // erase this node from successors
-        for (EdgeT& edge : successors) {
-            delete edge.second; // delete the label
-            edge.first->predecessors.erase(this);
+    struct SymbolKeyHash {
+        size_t operator()(const SymbolKey& key) const
+        {
+            size_t h = key.type;
+            for (CENode *c : key.children)
+                h = h * 31 + std::hash<CENode *>()(c);
+            return h;
         }
+    };
 
-        // prevent double free of the labels
-        successors.clear();
-        predecessors.clear();
-    }
+    // the arena that owns the labels of the edges
+    std::unique_ptr<CENodeArena> arena;
+    std::map<T, CENode *> labels;
+    std::unordered_map<SymbolKey, CENode *, SymbolKeyHash> symbols;
+    CENode *eps;
+
+    // nodes[0] is the root, nodes[1] the end
+    // and the rest are the nodes that were created
+    std::vector<std::unique_ptr<NodeT>> nodes;
 
-    /*
-    void dump() const
+    NodeT *getRootNode() const { return nodes[0].get(); }
+    NodeT *getEndNode() const { return nodes[1].get(); }
+
+    template <typename SymbolT>
+    CENode *getSymbol(CENodeType type, std::vector<CENode *>& children)
     {
-        std::cout << " -- " << this << " --\n";
-        for (auto E : successors) {
-            std::cout << "   --> " << E.first << "\n";
-            E.second->dump(5);
+        SymbolKey key;
+        key.type = type;
+        key.children.swap(children);
+
+        CENode *&S = symbols[key];
+        if (!S) {
+            S = arena->create<SymbolT>();
+            for (CENode *c : key.children)
+                S->addChild(c);
         }
+
+        return S;
     }
-    */
 
-    bool operator<(const CFANode<T>& oth) const
+    CENode *getLabel(const T& l)
     {
-        return label < oth.label;
+        CENode *&L = labels[l];
+        if (!L)
+            L = arena->create<CELabel<T>>(l);
+        return L;
     }
 
-    bool hasSelfLoop() const
+    // the sequence of the labels (the nested sequences
+    // and the epsilons are flattened)
+    CENode *getSeq(std::initializer_list<CENode *> seq)
     {
-        return predecessors.count(this) != 0;
-    }
+        std::vector<CENode *> children;
+        for (CENode *n : seq) {
+            if (n->isa(SEQ))
+                children.insert(children.end(), n->getChildren().begin(),
+                                n->getChildren().end());
+            else if (!n->isa(EPS))
+                children.push_back(n);
+        }
+
+        if (children.empty())
+            return eps;
+        if (children.size() == 1)
+            return children[0];
 
+        return getSymbol<CESeq>(SEQ, children);
+    }
 
-    bool hasSelfLoop()// const
+    // the branch with both labels (the same branches are merged)
+    CENode *getBranch(CENode *a, CENode *b)
     {
-        return predecessors.count(this) != 0;
+        std::vector<CENode *> children;
+        for (CENode *n : {a, b}) {
+            if (n->isa(BRANCH)) {
+                for (CENode *c : n->getChildren())
+                    if (std::find(children.begin(), children.end(), c)
+                        == children.end())
+                        children.push_back(c);
+            } else if (std::find(children.begin(), children.end(), n)
+                       == children.end())
+                children.push_back(n);
+        }
+
+        if (children.size() == 1)
+            return children[0];
+
+        return getSymbol<CEBranch>(BRANCH, children);
     }
 
-    size_t successorsNum() const
+    // the loop over the label (a sequence is flattened
+    // into the children of the loop)
+    CENode *getLoop(CENode *body)
     {
-        return successors.size();
+        std::vector<CENode *> children;
+        if (body->isa(SEQ))
+            children = body->getChildren();
+        else
+            children.push_back(body);
+
+        return getSymbol<CELoop>(LOOP, children);
     }
 
-    size_t predecessorsNum() const
+    // add the edge and merge it with the edge
+    // that goes to the same node (if any)
+    void addEdge(NodeT *from, NodeT *to, CENode *label)
     {
-        return predecessors.size();
+        auto it = from->successors.find(to);
+        if (it == from->successors.end()) {
+            from->successors.emplace(to, label);
+            to->predecessors.insert(from);
+        } else
+            it->second = getBranch(it->second, label);
     }
 
-    void print() const
+    void eliminate(NodeT *n)
     {
-        for (const auto& s : successors)
-            s.second->print();
+        auto self = n->successors.find(n);
+        CENode *self_loop = self == n->successors.end() ?
+                                nullptr : getLoop(self->second);
+
+        for (NodeT *pred : n->predecessors) {
+            // skip self-loops, we must handle them differently
+            if (pred == n)
+                continue;
+
+            auto in = pred->successors.find(n);
+            assert(in != pred->successors.end());
+            CENode *in_label = in->second;
+            pred->successors.erase(in);
+
+            for (auto& edge : n->successors) {
+                // do not add self-loops to this node, we're eliminating
+                if (edge.first == n)
+                    continue;
+
+                CENode *label = self_loop ?
+                    getSeq({in_label, self_loop, edge.second}) :
+                    getSeq({in_label, edge.second});
+                addEdge(pred, edge.first, label);
+            }
+        }
+
+        for (auto& edge : n->successors)
+            edge.first->predecessors.erase(n);
+
+        n->successors.clear();
+        n->predecessors.clear();
     }
 
-private:
-    CENode *getSelfLoopLabel() const
+    // add the edges to the end from the nodes where the paths end:
+    // the nodes without successors and the nodes that cannot get
+    // to any such node (infinite loops). This must be done before
+    // the elimination, so that it does not depend on its order
+    void addEndEdges()
     {
-        for (const EdgeT& edge : successors)
-            if (edge.first == this) {
-                return edge.second;
+        std::vector<NodeT *> queue;
+        std::vector<bool> ends(nodes.size(), false);
+        for (size_t i = 2; i < nodes.size(); ++i) {
+            if (nodes[i]->successors.empty()) {
+                ends[i] = true;
+                queue.push_back(nodes[i].get());
             }
+        }
 
-        return nullptr;
+        while (!queue.empty()) {
+            NodeT *n = queue.back();
+            queue.pop_back();
+            for (NodeT *pred : n->predecessors) {
+                if (!ends[pred->id]) {
+                    ends[pred->id] = true;
+                    queue.push_back(pred);
+                }
+            }
+        }
+
+        //               __r__
+        //       l      |     |
+        // root ----> (node)<-/   ...the node may get to the end
+        //                           only by an epsilon edge
+        for (size_t i = 2; i < nodes.size(); ++i) {
+            NodeT *n = nodes[i].get();
+            if (n->successors.empty() || !ends[i])
+                addEdge(n, getEndNode(), eps);
+        }
     }
 
-    // we need both links, because
-    // when eliminating, we must know what
-    // edges go to this node. However,
-    // for predecessors, we need only
-    // the information that the predecessor
-    // has an edge to this node, so set
-    // of CENode * is OK
-    std::list<EdgeT> successors;
-    std::set<CFANode<T> *> predecessors;
-};
+    size_t degree(const NodeT *n) const
+    {
+        return n->predecessorsNum() + n->successorsNum();
+    }
 
+    void eliminateMinDegree()
+    {
+        // (degree, number of the node), so that the nodes with the same
+        // degree are eliminated in the order of creation
+        std::set<std::pair<size_t, unsigned>> queue;
+        std::vector<size_t> degrees(nodes.size(), 0);
+        for (size_t i = 2; i < nodes.size(); ++i) {
+            degrees[i] = degree(nodes[i].get());
+            queue.emplace(degrees[i], i);
+        }
 
-template <typename T>
-class CFA {
-    CFANode<T> root;
-    CFANode<T> end;
-
-    // the CFA will have relativelly small number of nodes
-    // in our case, so this kind of expensive comparsion should
-    // not bring big overhead. On the other hand, it could
-    // produce nicer control expressions
-    /*
-    struct NdsCmp {
-        bool operator()(CFANode<T> *a, CFANode<T> *b) const
-        {
-            if (a->hasSelfLoop()) {
-                if (b->hasSelfLoop()) {
-                    return ((a->successorsNum() * a->predecessorsNum()) <
-                            (b->successorsNum() * b->predecessorsNum()));
-                } else
-                    return false;
-            } else {
-                if (b->hasSelfLoop())
-                    return true;
-                else
-                    return ((a->successorsNum() * a->predecessorsNum()) <
-                            (b->successorsNum() * b->predecessorsNum()));
+        while (!queue.empty()) {
+            NodeT *n = nodes[queue.begin()->second].get();
+            queue.erase(queue.begin());
+
+            // the neighbours get new edges, so update their degrees
+            std::set<NodeT *> neighbours(n->predecessors.begin(),
+                                         n->predecessors.end());
+            for (auto& edge : n->successors)
+                neighbours.insert(edge.first);
+
+            eliminate(n);
 
+            for (NodeT *nb : neighbours) {
+                if (nb == n || nb->id < 2)
+                    continue;
+
+                queue.erase(std::make_pair(degrees[nb->id], nb->id));
+                degrees[nb->id] = degree(nb);
+                queue.emplace(degrees[nb->id], nb->id);
             }
         }
-    };
-    */
-
-    std::set<CFANode<T> * /*, NdsCmp*/> nodes;
+    }
 
 public:
     CFA<T>()
-        :root(T()), end(T()) {}
-
-    CFA<T>(CFA<T>&& oth)
-        :root(std::move(oth.root)),
-         end(std::move(oth.end)),
-         nodes(std::move(oth.nodes))
+        : arena(new CENodeArena())
     {
+        eps = arena->create<CEEps>();
+        nodes.emplace_back(new NodeT(T(), 0));
+        nodes.emplace_back(new NodeT(T(), 1));
     }
 
-    ~CFA<T>()
+    CFA<T>(CFA<T>&& oth) = default;
+
+    // create a node of the CFA, the node is owned by the CFA
+    NodeT *createNode(const T& l)
     {
-        for (CFANode<T> *n : nodes)
-            // delete the nodes,
-            // we overtake the ownership
-            // FIXME: use std::unique_ptr?
-            delete n;
+        nodes.emplace_back(new NodeT(l, nodes.size()));
+        return nodes.back().get();
     }
 
-    // add a node into CFA. The memory must
-    // be allocated using 'new' operator and
-    // it is over-taken and deleted on CFA's
-    // destruction
-    void addNode(CFANode<T> *n)
+    // add the edge from @from to @to labeled with the label of @to
+    void addSuccessor(NodeT *from, NodeT *to)
     {
-        // if this node has no predecessors,
-        // take it as a starting node
-        if (n->predecessorsNum() == 0)
-            root.addSuccessor(n);
-
-        // if this node has no successors,
-        // make it the exit node
-        if (n->successorsNum() == 0)
-            n->addSuccessor(typename CFANode<T>::EdgeT(&end, new CEEps()));
+        addEdge(from, to, getLabel(to->getLabel()));
+    }
 
-        nodes.insert(n);
+    NodeT& getRoot()
+    {
+        return *getRootNode();
     }
 
-    CFANode<T>& getRoot()
+    size_t size() const
     {
-        return root;
+        return nodes.size() - 2;
     }
 
-    ControlExpression compute()
+    // compute the control expression. The CFA is eliminated
+    // by the computation, so it can be computed only once
+    ControlExpression compute(CFAEliminationOrder order
+                                = CFAEliminationOrder::MIN_DEGREE)
     {
+        NodeT *root = getRootNode();
+
+        for (size_t i = 2; i < nodes.size(); ++i) {
+            NodeT *n = nodes[i].get();
+            // if this node has no predecessors,
+            // take it as a starting node
+            if (n->predecessors.empty())
+                addSuccessor(root, n);
+        }
+
         // no starting point? Then we just choose one...
-        if (root.successorsNum() == 0) {
+        if (root->successorsNum() == 0) {
             assert(false && "Not implemented yet");
             abort();// in the case of NDEBUG
         }
 
-        // eliminate all the nodes
-        for (CFANode<T> *nd : nodes)
-            nd->eliminate();
-
-        // we may have end-up with two nodes,
-        // one of them having a self-loop above
-        // it (if there was no end node) and the
-        // other being the root.
-        // There's no way how to eliminate the former,
-        // so add a new end node that is going to be
-        // a successor of it -- then we can eliminate it.
-        //
-        //               __r__
-        //       l      |     |
-        // root ----> (node)<-/
-        //
-        for (CFANode<T> *nd : nodes) {
-            if (nd->hasSelfLoop()) {
-                nd->addSuccessor(typename CFANode<T>::EdgeT(&end, new CEEps()));
-                nd->eliminate();
-            }
+        addEndEdges();
+
+        if (order == CFAEliminationOrder::MIN_DEGREE)
+            eliminateMinDegree();
+        else {
+            for (size_t i = 2; i < nodes.size(); ++i)
+                eliminate(nodes[i].get());
         }
 
-        assert(root.successorsNum() == 1);
-        CENode *expr = root.getSuccessors().begin()->second;
-        expr->simplify();
+        assert(root->successorsNum() == 1);
+        assert(root->successors.begin()->first == getEndNode());
+
+        CENode *expr = root->successors.begin()->second;
 
-        return ControlExpression(expr);
+        // the expression takes the nodes over, including
+        // the labels of the eliminated edges
+        labels.clear();
+        symbols.clear();
+        return ControlExpression(expr, std::move(arena));
     }
 };
 
@@ -1,9 +1,11 @@
 #ifndef _DG_CONTROL_EXPRESSION_H_
 #define _DG_CONTROL_EXPRESSION_H_
 
-#include <list>
+#include <memory>
 #include <vector>
 #include <set>
+#include <unordered_map>
+#include <utility>
 //#include <iostream>
 #include <algorithm>
 #include <cassert>
@@ -12,44 +14,218 @@
 
 namespace dg {
 
+///
+// The control expression of a procedure. The nodes of the expression
+// are shared (the expression is a DAG, see CFA), so the paths that
+// go from a label to the end of the expression are not enumerated
+// one by one as in a tree. Instead, for every node we compute what
+// is visited after the node in any of its contexts: the labels that
+// are visited on all the paths and the labels that are visited
+// on some path. A loop may be iterated any number of times, including
+// zero times and forever, so the paths that stay in a loop are taken
+// into account too. The control scope of a label is then computed from
+// the contexts of the label. These are the paths of the CFA, so the
+// control scope does not depend on the shape of the expression
+// (i.e., on the order in which the CFA was eliminated).
 //template <typename T>
 class ControlExpression {
+    // the arena that owns the nodes of the expression
+    std::unique_ptr<CENodeArena> arena;
     CENode *root;
 
-public:
-    typedef std::vector<CENode *> CEPath;
+    // the labels visited after a node (or after a position
+    // in a node) on all the paths and on some path
+    struct Continuation {
+        CENode::VisitsSetT always;
+        CENode::VisitsSetT sometimes;
+        bool valid;
+
+        Continuation() : valid(false) {}
+
+        // merge the continuation in another context
+        void merge(const Continuation& oth)
+        {
+            if (!valid) {
+                *this = oth;
+                return;
+            }
+
+            CENode::VisitsSetT tmp;
+            std::set_intersection(always.begin(), always.end(),
+                                  oth.always.begin(), oth.always.end(),
+                                  std::inserter(tmp, tmp.end()),
+                                  CENode::CECmp());
+            always.swap(tmp);
+            sometimes.insert(oth.sometimes.begin(), oth.sometimes.end());
+        }
+    };
+
+    // the parents of the nodes with the position of the child
+    std::unordered_map<CENode *,
+                       std::vector<std::pair<CENode *, unsigned>>> parents;
+    // the nodes in topological order (parents first)
+    std::vector<CENode *> order;
+    std::vector<CENode *> labels;
+    // the labels that are in some loop
+    CENode::VisitsSetT loopLabels;
+    // the continuation of the path when it goes up to the node
+    std::unordered_map<CENode *, Continuation> upCont;
+    // the continuations after the children of a SEQ or a LOOP
+    std::unordered_map<CENode *, std::vector<Continuation>> childCont;
+    bool contComputed;
+
+    void computeOrder()
+    {
+        if (!order.empty())
+            return;
+
+        std::set<CENode *> visited;
+        // (node, index of the next child)
+        std::vector<std::pair<CENode *, unsigned>> stack;
+
+        visited.insert(root);
+        stack.push_back(std::make_pair(root, 0));
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            CENode *nd = top.first;
+            if (top.second < nd->getChildren().size()) {
+                unsigned i = top.second++;
+                CENode *chld = nd->getChildren()[i];
+                parents[chld].push_back(std::make_pair(nd, i));
+                if (visited.insert(chld).second)
+                    stack.push_back(std::make_pair(chld, 0));
+            } else {
+                order.push_back(nd);
+                if (nd->isLabel())
+                    labels.push_back(nd);
+                stack.pop_back();
+            }
+        }
+
+        std::reverse(order.begin(), order.end());
+    }
+
+    // the path visits @nd and then continues with @cont,
+    // or it stays in a loop of @nd forever
+    Continuation prepend(CENode *nd, const Continuation& cont) const
+    {
+        Continuation ret;
+        ret.valid = true;
+
+        ret.always = cont.always;
+        ret.always.insert(nd->getAlwaysVisits().begin(),
+                          nd->getAlwaysVisits().end());
+        if (nd->mayLoop()) {
+            CENode::VisitsSetT tmp;
+            std::set_intersection(ret.always.begin(), ret.always.end(),
+                                  nd->getLoopVisits().begin(),
+                                  nd->getLoopVisits().end(),
+                                  std::inserter(tmp, tmp.end()),
+                                  CENode::CECmp());
+            ret.always.swap(tmp);
+        }
+
+        ret.sometimes = cont.sometimes;
+        ret.sometimes.insert(nd->getAlwaysVisits().begin(),
+                             nd->getAlwaysVisits().end());
+        ret.sometimes.insert(nd->getSometimesVisits().begin(),
+                             nd->getSometimesVisits().end());
+        return ret;
+    }
+
+    // the continuation after the child on position @pos in @nd
+    const Continuation& getNext(CENode *nd, unsigned pos) const
+    {
+        // from a branch we go up, from a sequence or a loop
+        // to the next child (and up or to the next iteration
+        // when there is none)
+        if (nd->isa(BRANCH))
+            return upCont.find(nd)->second;
+
+        return childCont.find(nd)->second[pos];
+    }
+
+    void computeContinuations()
+    {
+        if (contComputed)
+            return;
+
+        computeOrder();
+
+        for (CENode *nd : order) {
+            Continuation& up = upCont[nd];
+            // the path ends when it gets to the root
+            if (nd == root)
+                up.valid = true;
+
+            for (auto& par : parents[nd])
+                up.merge(getNext(par.first, par.second));
+
+            if (nd->isa(LOOP))
+                loopLabels.insert(nd->getSometimesVisits().begin(),
+                                  nd->getSometimesVisits().end());
+
+            if (nd->isa(BRANCH) || !nd->hasChildren())
+                continue;
+
+            // the path continues from a child with the next children
+            // of this node and then it goes up. In a loop, the path
+            // may also continue with the next iterations of the loop
+            auto& chlds = nd->getChildren();
+            std::vector<Continuation>& conts = childCont[nd];
+            conts.resize(chlds.size());
+            conts.back() = nd->isa(LOOP) ? prepend(nd, up) : up;
+            for (size_t i = chlds.size() - 1; i > 0; --i)
+                conts[i - 1] = prepend(chlds[i], conts[i]);
+        }
+
+        contComputed = true;
+    }
 
-    ControlExpression(CENode *r)
-        : root(r) {}
+public:
+    ControlExpression(CENode *r, std::unique_ptr<CENodeArena> a)
+        : arena(std::move(a)), root(r), contComputed(false) {}
 
     ControlExpression()
-        :root(nullptr) {}
+        : root(nullptr), contComputed(false) {}
 
     ControlExpression(ControlExpression&& oth)
-        :root(oth.root)
+        : ControlExpression()
     {
-        oth.root = nullptr;
+        *this = std::move(oth);
     }
 
     ControlExpression& operator=(ControlExpression&& oth)
     {
+        arena = std::move(oth.arena);
         root = oth.root;
         oth.root = nullptr;
+
+        parents = std::move(oth.parents);
+        order = std::move(oth.order);
+        labels = std::move(oth.labels);
+        loopLabels = std::move(oth.loopLabels);
+        upCont = std::move(oth.upCont);
+        childCont = std::move(oth.childCont);
+        contComputed = oth.contComputed;
+        oth.contComputed = false;
         return *this;
     }
 
     ControlExpression(const ControlExpression& oth) = delete;
-    /*
-        : root(oth.root->clone())
-    {
-    }
-    */
 
     CENode *getRoot()
     {
         return root;
     }
 
+    // the number of the nodes of the expression
+    // (including the nodes that are not used anymore)
+    size_t size() const
+    {
+        return arena ? arena->size() : 0;
+    }
+
     void computeSets()
     {
         root->computeSets();
@@ -65,157 +241,58 @@ public:
     // return by value to allow using
     // move constructor
     template <typename T>
-    std::vector<CENode *> getLabels(const T& lab) const
+    std::vector<CENode *> getLabels(const T& lab)
     {
+        computeOrder();
+
         std::vector<CENode *> tmp;
-        getLabels(root, lab, tmp);
+        for (CENode *nd : labels) {
+            if (static_cast<CELabel<T> *>(nd)->getLabel() == lab)
+                tmp.push_back(nd);
+        }
+
         return tmp;
     }
 
+    // the labels that are visited only on some of the paths
+    // that go from the label @lab to the end of the expression
+    // (or that stay in a loop forever). When computing termination
+    // sensitive information, we assume that a loop may not terminate
+    // even in its first iteration, so the labels in loops (other
+    // than @lab) are never visited on all the paths
     template <typename T>
-    std::vector<CEPath> getPathsFrom(const T& l) const
+    CENode::VisitsSetT getControlScope(const T& lab,
+                                       bool termination_sensitive = false)
     {
-        std::vector<CEPath> paths;
-        std::vector<CENode *> labels = getLabels<T>(l);
-
-        for (CENode *lab : labels) {
-            CEPath P;
-            for (auto I = lab->path_begin(), E = lab->path_end();
-                 I != E; ++I) {
-                P.push_back(*I);
-
-                // XXX: Consider selective termination
-                // every loop may non-terminate, so every loop terminates a path
-                if ((*I)->isa(LOOP))
-                    // copy the path that is terminated with this loop
-                    paths.push_back(CEPath(P));
-
-                // continue building the path
-            }
-
-            // rely on move constructors
-            paths.push_back(P);
-        }
-
-        // hopefully a move constructor again
-        return paths;
-    }
+        assert((!root->getAlwaysVisits().empty() ||
+               !root->getSometimesVisits().empty()) && "Did you called computeSets?");
 
-    // FIXME: this should go out of this class
-    std::pair<CENode::VisitsSetT, CENode::VisitsSetT>
-    getSetsForPath(CEPath& path, bool termination_sensitive = false) const
-    {
-        CENode::VisitsSetT always, smtm;
-        bool found_loop = false;
+        computeContinuations();
 
-        for (CENode *nd : path) {
-            if (nd->isa(LOOP))
-                found_loop = true;
-
-            // in the case we compute termination sensitive
-            // information, we assume that a loop may
-            // not terminate, therefore everything that
-            // follows a loop is only 'sometimes' (possibly) visited
-            if (found_loop && termination_sensitive) {
-                smtm.insert(nd->getAlwaysVisits().begin(),
-                            nd->getAlwaysVisits().end());
-            } else {
-                always.insert(nd->getAlwaysVisits().begin(),
-                              nd->getAlwaysVisits().end());
+        Continuation cont;
+        for (CENode *L : getLabels<T>(lab)) {
+            if (L == root) {
+                cont.merge(prepend(L, upCont[L]));
+                continue;
             }
 
-            smtm.insert(nd->getSometimesVisits().begin(),
-                        nd->getSometimesVisits().end());
+            for (auto& par : parents[L])
+                cont.merge(prepend(L, getNext(par.first, par.second)));
         }
 
-        CENode::VisitsSetT diff;
-        std::set_difference(smtm.begin(), smtm.end(),
-                            always.begin(), always.end(),
-                            std::inserter(diff, diff.end()), CENode::CECmp());
-
-        diff.swap(smtm);
-
-        return std::make_pair(always, smtm);
-    }
-
-    std::pair<CENode::VisitsSetT, CENode::VisitsSetT>
-    getSets(std::vector<CEPath>& paths, bool termination_sensitive = false) const
-    {
-        CENode::VisitsSetT always, smtm;
-
-        assert(paths.size() > 0);
-
-        if (paths.size() == 1)
-            return getSetsForPath(*(paths.begin()), termination_sensitive);
-
-        auto I = paths.begin();
-        auto S = getSetsForPath(*I, termination_sensitive);
-
-        // initialize the alwas set
-        always = std::move(S.first);
-
-        // initialize the somtimes set (we put there everything
-        // and then filter it at the end)
-        smtm = std::move(S.second);
-        smtm.insert(always.begin(), always.end());
-
-        ++I;
-        for (auto E = paths.end(); I != E; ++I) {
-            // make intersection of the always sets
-            CENode::VisitsSetT tmpa;
-
-            auto cur = getSetsForPath(*I, termination_sensitive);
-            std::set_intersection(always.begin(), always.end(),
-                                  cur.first.begin(), cur.first.end(),
-                                  std::inserter(tmpa, tmpa.end()),
-                                  CENode::CECmp());
-
-            always.swap(tmpa);
-
-            // we insert both sets into the insert and then
-            // we simply remove what is in always
-            smtm.insert(cur.first.begin(), cur.first.end());
-            smtm.insert(cur.second.begin(), cur.second.end());
+        if (termination_sensitive) {
+            for (CENode *L : loopLabels)
+                if (!(static_cast<CELabel<T> *>(L)->getLabel() == lab))
+                    cont.always.erase(L);
         }
 
+        // return the 'sometimes' set (empty if the label
+        // is not in the expression, i.e. it is unreachable)
         CENode::VisitsSetT diff;
-        std::set_difference(smtm.begin(), smtm.end(),
-                            always.begin(), always.end(),
+        std::set_difference(cont.sometimes.begin(), cont.sometimes.end(),
+                            cont.always.begin(), cont.always.end(),
                             std::inserter(diff, diff.end()), CENode::CECmp());
-
-        diff.swap(smtm);
-
-        return std::make_pair(always, smtm);
-    }
-
-    template <typename T>
-    CENode::VisitsSetT getControlScope(const T& lab,
-                                       bool termination_sensitive = false) const
-    {
-        assert((!root->getAlwaysVisits().empty() ||
-               !root->getSometimesVisits().empty()) && "Did you called computeSets?");
-
-        auto paths = getPathsFrom<T>(lab);
-        // return the 'sometimes' set
-        return getSets(paths, termination_sensitive).second;
-    }
-
-private:
-
-    template <typename T>
-    void getLabels(CENode *nd, const T& lab, std::vector<CENode *>& out) const
-    {
-        if (nd->isLabel()) {
-            CELabel<T> *l = static_cast<CELabel<T> *>(nd);
-            // std::cout << l->getLabel() << " == " << lab << "\n";
-            if (l->getLabel() == lab) {
-                out.push_back(nd);
-            }
-        }
-
-        // recursively call to children
-        for (CENode *chld : nd->getChildren())
-            getLabels(chld, lab, out);
+        return diff;
     }
 };
 
@@ -0,0 +1,186 @@
+#ifndef _DG_DOMINATORS_H_
+#define _DG_DOMINATORS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BBlock.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// Compute immediate dominators of the blocks of one procedure
+//
+// This is the same algorithm as in PostDominators, just on the CFG
+// instead of the reverse CFG: the blocks are numbered densely and
+// the immediate dominators are computed on arrays by the iterative
+// algorithm walking the blocks in the reverse postorder from the entry.
+// The successors that were not added are ignored and the blocks
+// that are not reachable from the entry get no dominator.
+//
+// The algorithm is due:
+//
+// K. D. Cooper, T. J. Harvey, and K. Kennedy. 2001.
+// A Simple, Fast Dominance Algorithm.
+// Software Practice & Experience 4, 1-10.
+//
+template <typename NodeT>
+class Dominators
+{
+    typedef BBlock<NodeT> BBlockT;
+
+    // the idom of the entry and of the unreachable blocks
+    enum : unsigned { NONE = ~0U };
+
+    std::vector<BBlockT *> blocks;
+    std::unordered_map<BBlockT *, unsigned> numbers;
+
+    std::vector<std::vector<unsigned>> succs;
+    std::vector<std::vector<unsigned>> preds;
+
+    std::vector<unsigned> idom;
+    // the order of the blocks in the postorder of the CFG
+    std::vector<unsigned> postorder;
+
+    unsigned intersect(unsigned a, unsigned b) const
+    {
+        while (a != b) {
+            while (postorder[a] < postorder[b])
+                a = idom[a];
+            while (postorder[b] < postorder[a])
+                b = idom[b];
+        }
+
+        return a;
+    }
+
+    void buildEdges()
+    {
+        succs.resize(blocks.size());
+        preds.resize(blocks.size());
+
+        for (unsigned b = 0; b < blocks.size(); ++b) {
+            for (const auto& edge : blocks[b]->successors()) {
+                auto it = numbers.find(edge.target);
+                if (it == numbers.end())
+                    continue;
+
+                // there may be more edges with different labels
+                unsigned s = it->second;
+                if (std::find(succs[b].begin(), succs[b].end(), s)
+                    == succs[b].end()) {
+                    succs[b].push_back(s);
+                    preds[s].push_back(b);
+                }
+            }
+        }
+    }
+
+    // number the blocks reachable from @root in the postorder
+    // of the CFG. Returns the reverse postorder
+    std::vector<unsigned> computePostorder(unsigned root)
+    {
+        std::vector<unsigned> order;
+        order.reserve(blocks.size());
+        postorder.assign(blocks.size(), NONE);
+
+        std::vector<bool> visited(blocks.size(), false);
+        // (block, index of the next successor)
+        std::vector<std::pair<unsigned, unsigned>> stack;
+
+        visited[root] = true;
+        stack.push_back(std::make_pair(root, 0));
+        while (!stack.empty()) {
+            auto& top = stack.back();
+            if (top.second < succs[top.first].size()) {
+                unsigned s = succs[top.first][top.second++];
+                if (!visited[s]) {
+                    visited[s] = true;
+                    stack.push_back(std::make_pair(s, 0));
+                }
+            } else {
+                postorder[top.first] = order.size();
+                order.push_back(top.first);
+                stack.pop_back();
+            }
+        }
+
+        return std::vector<unsigned>(order.rbegin(), order.rend());
+    }
+
+public:
+    void addBlock(BBlockT *B)
+    {
+        assert(succs.empty() && "Adding a block after computing");
+        if (numbers.emplace(B, blocks.size()).second)
+            blocks.push_back(B);
+    }
+
+    // compute the immediate dominators of the blocks
+    // reachable from @entry (that must be added)
+    void compute(BBlockT *entry)
+    {
+        auto it = numbers.find(entry);
+        assert(it != numbers.end() && "The entry was not added");
+        unsigned root = it->second;
+
+        buildEdges();
+        std::vector<unsigned> rpo = computePostorder(root);
+
+        idom.assign(blocks.size(), NONE);
+        // the entry is its own idom while computing,
+        // so that intersect() stops there
+        idom[root] = root;
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+
+            for (unsigned b : rpo) {
+                if (b == root)
+                    continue;
+
+                unsigned newIDom = NONE;
+                for (unsigned p : preds[b]) {
+                    // not processed yet or unreachable
+                    if (idom[p] == NONE)
+                        continue;
+
+                    if (newIDom == NONE)
+                        newIDom = p;
+                    else
+                        newIDom = intersect(p, newIDom);
+                }
+
+                if (idom[b] != newIDom) {
+                    idom[b] = newIDom;
+                    changed = true;
+                }
+            }
+        }
+
+        idom[root] = NONE;
+    }
+
+    // the immediate dominator of the block, nullptr if it is
+    // the entry, if it is not reachable from the entry
+    // or if it was not added
+    BBlockT *getIDom(BBlockT *B) const
+    {
+        auto it = numbers.find(B);
+        if (it == numbers.end())
+            return nullptr;
+
+        unsigned id = idom[it->second];
+        return id == NONE ? nullptr : blocks[id];
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_DOMINATORS_H_
@@ -1,6 +1,8 @@
 #ifndef _DG_NODES_WALK_H_
 #define _DG_NODES_WALK_H_
 
+#include <atomic>
+
 #include "Analysis.h"
 #include "DGParameters.h"
 
@@ -38,13 +40,14 @@ class NodesWalkBase : public Analysis<NodeT>
 protected:
     // this counter will increase each time we run
     // NodesWalk, so it can be used as an indicator
-    // that we queued a node in a particular run or not
-    static unsigned int walk_run_counter;
+    // that we queued a node in a particular run or not.
+    // It is shared by all the walks, even those in other threads
+    static std::atomic<unsigned int> walk_run_counter;
 };
 
 // counter definition
 template<typename NodeT>
-unsigned int NodesWalkBase<NodeT>::walk_run_counter = 0;
+std::atomic<unsigned int> NodesWalkBase<NodeT>::walk_run_counter(0);
 
 template <typename NodeT, typename QueueT>
 class NodesWalk : public NodesWalkBase<NodeT>
@@ -236,13 +239,14 @@ class BBlockWalkBase : public BBlockAnalysis<NodeT>
 protected:
     // this counter will increase each time we run
     // NodesWalk, so it can be used as an indicator
-    // that we queued a node in a particular run or not
-    static unsigned int walk_run_counter;
+    // that we queued a node in a particular run or not.
+    // It is shared by all the walks, even those in other threads
+    static std::atomic<unsigned int> walk_run_counter;
 };
 
 // counter definition
 template<typename NodeT>
-unsigned int BBlockWalkBase<NodeT>::walk_run_counter = 0;
+std::atomic<unsigned int> BBlockWalkBase<NodeT>::walk_run_counter(0);
 
 #ifdef ENABLE_CFG
 template <typename NodeT, typename QueueT>
@@ -1,6 +1,8 @@
 #ifndef _DG_OFFSET_H_
 #define _DG_OFFSET_H_
 
+#include <cstdint>
+
 namespace dg {
 namespace analysis {
 
@@ -13,6 +13,9 @@ namespace pta {
 class PointsToFlowInsensitive : public PointerAnalysis
 {
     PointerSubgraph *ps;
+    // the node for unknown memory is shared by all analyses,
+    // so we keep its memory object here and not in the node
+    MemoryObject *unknown_mo = nullptr;
 
 protected:
     PointsToFlowInsensitive() = default;
@@ -27,6 +30,8 @@ public:
             MemoryObject *mo = n->getData<MemoryObject>();
             delete mo;
         }
+
+        delete unknown_mo;
     }
 
     virtual void getMemoryObjects(PSNode *where, const Pointer& pointer,
@@ -50,6 +55,14 @@ public:
         assert(n->getType() == pta::ALLOC || n->getType() == pta::DYN_ALLOC
                || n->getType() == pta::UNKNOWN_MEM);
 
+        if (n == UNKNOWN_MEMORY) {
+            if (!unknown_mo)
+                unknown_mo = new MemoryObject(n);
+
+            objects.push_back(unknown_mo);
+            return;
+        }
+
         MemoryObject *mo = n->getData<MemoryObject>();
         if (!mo) {
             mo = new MemoryObject(n);
@@ -0,0 +1,266 @@
+#ifndef _DG_POST_DOMINATORS_H_
+#define _DG_POST_DOMINATORS_H_
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ADT/Bitvector.h"
+#include "BBlock.h"
+
+namespace dg {
+namespace analysis {
+
+///
+// Compute post-dominators and post-dominance frontiers
+// of the blocks of one procedure
+//
+// The blocks are numbered densely and the immediate post-dominators
+// are computed on arrays by the iterative algorithm on the reverse CFG.
+// The frontiers are then found by walking up the post-dominator tree
+// from the successors of every block. A successor that was not added
+// (e.g. an artificial exit block) is taken as the exit of the procedure.
+//
+// The blocks from which no exit is reachable (infinite loops) are
+// connected to the exit, so that every block has a post-dominator.
+//
+// The algorithm is due:
+//
+// K. D. Cooper, T. J. Harvey, and K. Kennedy. 2001.
+// A Simple, Fast Dominance Algorithm.
+// Software Practice & Experience 4, 1-10.
+//
+template <typename NodeT>
+class PostDominators
+{
+    typedef BBlock<NodeT> BBlockT;
+
+    // the number of the (virtual) exit, the root of the tree
+    enum : unsigned { EXIT = ~0U };
+
+    std::vector<BBlockT *> blocks;
+    std::unordered_map<BBlockT *, unsigned> numbers;
+
+    // the successors in the CFG (EXIT for the exit)
+    std::vector<std::vector<unsigned>> succs;
+    // the predecessors in the CFG (the successors in the reverse CFG)
+    std::vector<std::vector<unsigned>> preds;
+    // the blocks that are connected to the exit
+    std::vector<unsigned> exits;
+
+    std::vector<unsigned> ipdom;
+    // the order of the blocks in the postorder of the reverse CFG
+    std::vector<unsigned> postorder;
+
+    unsigned getIPDom(unsigned b) const
+    {
+        return b == EXIT ? EXIT : ipdom[b];
+    }
+
+    unsigned getOrder(unsigned b) const
+    {
+        // the exit is the last one in the postorder
+        return b == EXIT ? blocks.size() : postorder[b];
+    }
+
+    unsigned intersect(unsigned a, unsigned b) const
+    {
+        while (a != b) {
+            while (getOrder(a) < getOrder(b))
+                a = getIPDom(a);
+            while (getOrder(b) < getOrder(a))
+                b = getIPDom(b);
+        }
+
+        return a;
+    }
+
+    void buildEdges()
+    {
+        succs.resize(blocks.size());
+        preds.resize(blocks.size());
+
+        for (unsigned b = 0; b < blocks.size(); ++b) {
+            bool toExit = false;
+            for (const auto& edge : blocks[b]->successors()) {
+                auto it = numbers.find(edge.target);
+                if (it == numbers.end()) {
+                    toExit = true;
+                    continue;
+                }
+
+                // there may be more edges with different labels
+                unsigned s = it->second;
+                if (std::find(succs[b].begin(), succs[b].end(), s)
+                    == succs[b].end()) {
+                    succs[b].push_back(s);
+                    preds[s].push_back(b);
+                }
+            }
+
+            if (toExit || succs[b].empty()) {
+                succs[b].push_back(EXIT);
+                exits.push_back(b);
+            }
+        }
+    }
+
+    // number the blocks in the postorder of the reverse CFG walked
+    // from the exit. Returns the reverse postorder (without the exit)
+    std::vector<unsigned> computePostorder()
+    {
+        std::vector<unsigned> order;
+        order.reserve(blocks.size());
+        postorder.assign(blocks.size(), EXIT);
+
+        std::vector<bool> visited(blocks.size(), false);
+        // (block, index of the next predecessor)
+        std::vector<std::pair<unsigned, unsigned>> stack;
+
+        auto walk = [&](unsigned root) {
+            visited[root] = true;
+            stack.push_back(std::make_pair(root, 0));
+            while (!stack.empty()) {
+                auto& top = stack.back();
+                if (top.second < preds[top.first].size()) {
+                    unsigned p = preds[top.first][top.second++];
+                    if (!visited[p]) {
+                        visited[p] = true;
+                        stack.push_back(std::make_pair(p, 0));
+                    }
+                } else {
+                    postorder[top.first] = order.size();
+                    order.push_back(top.first);
+                    stack.pop_back();
+                }
+            }
+        };
+
+        for (size_t i = 0; i < exits.size(); ++i) {
+            if (!visited[exits[i]])
+                walk(exits[i]);
+        }
+
+        // the blocks that cannot reach the exit. Connect the last
+        // one to the exit and walk again, until we have all
+        for (unsigned b = blocks.size(); b > 0; --b) {
+            if (visited[b - 1])
+                continue;
+
+            succs[b - 1].push_back(EXIT);
+            exits.push_back(b - 1);
+            walk(b - 1);
+        }
+
+        return std::vector<unsigned>(order.rbegin(), order.rend());
+    }
+
+public:
+    void addBlock(BBlockT *B)
+    {
+        assert(succs.empty() && "Adding a block after computing");
+        if (numbers.emplace(B, blocks.size()).second)
+            blocks.push_back(B);
+    }
+
+    // compute the immediate post-dominators
+    void compute()
+    {
+        buildEdges();
+        std::vector<unsigned> rpo = computePostorder();
+
+        // EXIT is also the undefined value
+        ipdom.assign(blocks.size(), EXIT);
+        std::vector<bool> processed(blocks.size(), false);
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+
+            for (unsigned b : rpo) {
+                // the successors in the CFG are the
+                // predecessors in the reverse CFG
+                unsigned newIPDom = EXIT;
+                bool first = true;
+                for (unsigned s : succs[b]) {
+                    if (s != EXIT && !processed[s])
+                        continue;
+
+                    if (first) {
+                        newIPDom = s;
+                        first = false;
+                    } else
+                        newIPDom = intersect(s, newIPDom);
+                }
+
+                processed[b] = true;
+                if (ipdom[b] != newIPDom) {
+                    ipdom[b] = newIPDom;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // the immediate post-dominator of the block,
+    // nullptr if it is the exit
+    BBlockT *getIPostDom(BBlockT *B) const
+    {
+        auto it = numbers.find(B);
+        assert(it != numbers.end() && "Unknown block");
+
+        unsigned ip = ipdom[it->second];
+        return ip == EXIT ? nullptr : blocks[ip];
+    }
+
+    // call @fn(B, deps) for every block B that has some blocks
+    // in its post-dominance frontier. The vector @deps contains
+    // the blocks that have B in their frontier (i.e. the blocks
+    // that are control dependent on B) in the order of addBlock().
+    //
+    // The blocks found by the walks from the successors of B
+    // are gathered in a bitvector, so that we do not need a set
+    // of blocks for every block. The frontiers of blocks that end
+    // with a large switch can contain most of the blocks.
+    template <typename FuncT>
+    void computeFrontiers(FuncT fn) const
+    {
+        ADT::Bitvector found(blocks.size());
+        std::vector<BBlockT *> deps;
+
+        for (unsigned b = 0; b < blocks.size(); ++b) {
+            // with one successor, the successor is the ipdom
+            // and the walk ends immediately
+            if (succs[b].size() < 2)
+                continue;
+
+            for (unsigned s : succs[b]) {
+                for (unsigned r = s; r != ipdom[b]; r = ipdom[r]) {
+                    assert(r != EXIT && "Walked out of the tree");
+                    // the walks from the other successors
+                    // continue the same way from here
+                    if (!found.set(r))
+                        break;
+                }
+            }
+
+            if (found.empty())
+                continue;
+
+            deps.clear();
+            found.forEach([this, &deps](size_t r) {
+                deps.push_back(blocks[r]);
+            });
+            found.clear();
+
+            fn(blocks[b], deps);
+        }
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_POST_DOMINATORS_H_
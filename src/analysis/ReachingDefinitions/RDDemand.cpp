@@ -0,0 +1,163 @@
+#include <cassert>
+#include <set>
+#include <vector>
+
+#include "ADT/Queue.h"
+
+#include "RDMap.h"
+#include "RDDemand.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+void DemandReachingDefinitions::initialize()
+{
+    ADT::QueueFIFO<RDNode *> fifo;
+    fifo.push(root);
+    reachable.insert(root);
+
+    while (!fifo.empty()) {
+        RDNode *cur = fifo.pop();
+        for (RDNode *succ : cur->getSuccessors()) {
+            if (reachable.insert(succ).second)
+                fifo.push(succ);
+        }
+    }
+
+    // gather what objects are defined in the program. The definitions
+    // of the unreachable nodes can get to their reachable successors,
+    // so take them into account too
+    for (RDNode *n : reachable) {
+        for (const DefSite& ds : n->defs)
+            objects[ds.target].insert(ds);
+
+        for (RDNode *pred : n->getPredecessors()) {
+            if (reachable.count(pred) != 0)
+                continue;
+
+            for (const DefSite& ds : pred->defs)
+                objects[ds.target].insert(ds);
+        }
+    }
+}
+
+// does the node strong-update every definition of the object?
+bool DemandReachingDefinitions::killsAll(RDNode *n, RDNode *target,
+                                         const DefSiteSetT& defs) const
+{
+    (void) target;
+
+    if (n->overwrites.empty())
+        return false;
+
+    for (const DefSite& ds : defs) {
+        assert(ds.target == target);
+        if (!RDMap::isOverwritten(ds, n->overwrites, strong_update_unknown))
+            return false;
+    }
+
+    return true;
+}
+
+void DemandReachingDefinitions::getOwnDefinitions(RDNode *n, RDNode *target,
+                                                  RDMap& map) const
+{
+    auto range = n->def_map.getObjectRange(DefSite(target));
+    for (auto I = range.first; I != range.second; ++I)
+        map[I->first] = I->second;
+}
+
+RDMap& DemandReachingDefinitions::getObjectDefinitions(RDNode *n, RDNode *target)
+{
+    if (reachable.empty())
+        initialize();
+
+    auto& known = memo[target];
+    auto it = known.find(n);
+    if (it != known.end())
+        return it->second;
+
+    auto oit = objects.find(target);
+    if (oit == objects.end())
+        // nobody defines this object
+        return known[n];
+
+    const DefSiteSetT& defs = oit->second;
+
+    // walk the predecessors backward and find the nodes
+    // whose definitions we need to compute
+    std::vector<RDNode *> region;
+    std::unordered_set<RDNode *> active;
+    ADT::QueueFIFO<RDNode *> fifo;
+
+    getOwnDefinitions(n, target, known[n]);
+    region.push_back(n);
+    fifo.push(n);
+
+    while (!fifo.empty()) {
+        RDNode *cur = fifo.pop();
+
+        // unreachable nodes have only their own definitions
+        // and nothing gets through a node that kills all the definitions
+        if (reachable.count(cur) == 0 || killsAll(cur, target, defs))
+            continue;
+
+        active.insert(cur);
+        for (RDNode *pred : cur->getPredecessors()) {
+            // we already have this one
+            if (known.count(pred) != 0)
+                continue;
+
+            getOwnDefinitions(pred, target, known[pred]);
+            region.push_back(pred);
+            fifo.push(pred);
+        }
+    }
+
+    // run the fixpoint on the nodes we found, starting
+    // from the nodes that are the farthest from the query
+    ADT::QueueFIFO<RDNode *> queue;
+    std::unordered_set<RDNode *> queued;
+    for (auto I = region.rbegin(), E = region.rend(); I != E; ++I) {
+        if (active.count(*I) != 0) {
+            queue.push(*I);
+            queued.insert(*I);
+        }
+    }
+
+    while (!queue.empty()) {
+        RDNode *cur = queue.pop();
+        queued.erase(cur);
+        ++processed;
+
+        RDMap& map = known[cur];
+        bool changed = false;
+        for (RDNode *pred : cur->getPredecessors())
+            changed |= map.merge(&known[pred], &cur->overwrites,
+                                 strong_update_unknown, max_set_size,
+                                 false /* merge unknown */);
+
+        if (!changed)
+            continue;
+
+        for (RDNode *succ : cur->getSuccessors()) {
+            if (active.count(succ) != 0 && queued.insert(succ).second)
+                queue.push(succ);
+        }
+    }
+
+    return known[n];
+}
+
+size_t DemandReachingDefinitions::get(RDNode *n, RDNode *target,
+                                      const Offset& off, const Offset& len,
+                                      std::set<RDNode *>& ret)
+{
+    RDMap& map = getObjectDefinitions(n, target);
+    return map.get(target, off, len, ret);
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
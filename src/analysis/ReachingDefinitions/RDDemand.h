@@ -0,0 +1,80 @@
+#ifndef _DG_RD_DEMAND_H_
+#define _DG_RD_DEMAND_H_
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ReachingDefinitions.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+///
+// Demand-driven reaching definitions. Instead of computing
+// the maps for every node and every memory object, we compute the
+// definitions of one object at one node only when somebody asks for it.
+// We walk the predecessors backward from the node and stop at the nodes
+// that strong-update every definition of the object in the program
+// (nothing from before such node can reach through it). Then we run
+// the fixpoint restricted to the object on the nodes that we found.
+// The results are remembered for every (node, object) pair,
+// so the next queries for the object stop at the nodes that we
+// already know.
+//
+// The results are the same as the maps computed by
+// ReachingDefinitionsAnalysis, the def_map of nodes must contain
+// only the node's own definitions though (i.e. do not run
+// the analysis on the graph).
+class DemandReachingDefinitions
+{
+public:
+    DemandReachingDefinitions(RDNode *r,
+                              bool strong_updt_unknown = false,
+                              uint32_t max_set_sz = ~((uint32_t) 0))
+        : root(r), strong_update_unknown(strong_updt_unknown),
+          max_set_size(max_set_sz), processed(0)
+    {
+        assert(r && "Root cannot be null");
+    }
+
+    // gather reaching definitions of memory [target + off, target + off + len]
+    // at the node @n and store them to @ret
+    size_t get(RDNode *n, RDNode *target,
+               const Offset& off, const Offset& len,
+               std::set<RDNode *>& ret);
+
+    // get definitions of the object @target that reach the node @n
+    RDMap& getObjectDefinitions(RDNode *n, RDNode *target);
+
+    // how many nodes we processed in all the queries
+    size_t getProcessedNum() const { return processed; }
+
+private:
+    RDNode *root;
+    bool strong_update_unknown;
+    uint32_t max_set_size;
+    size_t processed;
+
+    // nodes reachable from the root, only these are processed
+    // by the ReachingDefinitionsAnalysis. The rest has only
+    // its own definitions
+    std::unordered_set<RDNode *> reachable;
+    // object -> all definitions of the object in the program
+    std::unordered_map<RDNode *, DefSiteSetT> objects;
+
+    // object -> node -> definitions of the object at the node
+    std::unordered_map<RDNode *,
+                       std::unordered_map<RDNode *, RDMap>> memo;
+
+    void initialize();
+    bool killsAll(RDNode *n, RDNode *target, const DefSiteSetT& defs) const;
+    void getOwnDefinitions(RDNode *n, RDNode *target, RDMap& map) const;
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif //  _DG_RD_DEMAND_H_
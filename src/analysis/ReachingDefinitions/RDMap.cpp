@@ -21,6 +21,69 @@ static bool comp_ds(const DefSite& a, const DefSite& b)
     return a.target < b.target;
 }
 
+///
+// Is the definition @ds overwritten by some of the strong updates
+// from @no_update? We do strong updates only if the offset is concrete,
+// because if it is not concrete, we want to do weak update.
+// Also, we don't want to do strong updates for heap allocated objects,
+// since they are all represented by the call site.
+// If @unknown_overwrite is given, it is set to true when @no_update
+// contains a definition of the target on unknown offset.
+bool RDMap::isOverwritten(const DefSite& ds, const DefSiteSetT& no_update,
+                          bool strong_update_unknown, bool *unknown_overwrite)
+{
+    // if the memory is defined at unknown offset, we can
+    // still do a strong update provided this is the update
+    // of whole memory (so we need to know the size of the memory).
+    if (strong_update_unknown &&
+        ds.offset.isUnknown() && ds.target->getSize() > 0) {
+        // get the writes that should overwrite this definition
+        auto range = std::equal_range(no_update.begin(),
+                                      no_update.end(),
+                                      ds, comp_ds);
+        // XXX: we could check wether all the strong updates
+        // together overwrite the memory, but that could be
+        // to much work. Just check wether there's is just a one
+        // update that overwrites the whole memory
+        for (auto I = range.first; I!= range.second; ++I) {
+            const DefSite& ds2 = *I;
+            assert(ds.target == ds2.target);
+            if (*ds2.offset == 0 && *ds2.len >= ds.target->getSize())
+                return true;
+        }
+
+        return false;
+    }
+
+    if (ds.target->getType() == DYN_ALLOC)
+        return false;
+
+    auto range = std::equal_range(no_update.begin(),
+                                  no_update.end(),
+                                  ds, comp_ds);
+    for (auto I = range.first; I!= range.second; ++I) {
+        const DefSite& ds2 = *I;
+        assert(ds.target == ds2.target);
+        // if the 'no_update' set contains target with unknown
+        // pointer, we should always keep that value
+        // and the value being merged (just all possible definitions)
+        if (ds2.offset.isUnknown()) {
+            if (unknown_overwrite)
+                *unknown_overwrite = true;
+            return false;
+        }
+
+        // targets are the same, check if the what we have
+        // in 'no_update' set overwrites the values that are in
+        // the other map
+        if ((*ds.offset >= *ds2.offset)
+            && (*ds.offset + *ds.len <= *ds2.offset + *ds2.len))
+            return true;
+    }
+
+    return false;
+}
+
 ///
 // merge @oth map to this map. If given @no_update set,
 // take those definitions as 'overwrites'. That is -
@@ -72,72 +135,18 @@ bool RDMap::merge(const RDMap *oth,
         // STRONG UPDATE
         // --------------------
         // should we update this def-site (strong update)?
-        // but only if the offset is concrete, because if
-        // it is not concrete, we want to do weak update
-        // Also, we don't want to do strong updates for
-        // heap allocated objects, since they are all represented
-        // by the call site
         if (no_update) { // do we have anything for strong update at all?
-            // if the memory is defined at unknown offset, we can
-            // still do a strong update provided this is the update
-            // of whole memory (so we need to know the size of the memory).
-            if (strong_update_unknown &&
-                is_unknown && ds.target->getSize() > 0) {
-                // get the writes that should overwrite this definition
-                auto range = std::equal_range(no_update->begin(),
-                                              no_update->end(),
-                                              ds, comp_ds);
-                // XXX: we could check wether all the strong updates
-                // together overwrite the memory, but that could be
-                // to much work. Just check wether there's is just a one
-                // update that overwrites the whole memory
-                bool overwrites_whole_memory = false;
-                for (auto I = range.first; I!= range.second; ++I) {
-                    const DefSite& ds2 = *I;
-                    assert(ds.target == ds2.target);
-                    if (*ds2.offset == 0 && *ds2.len >= ds.target->getSize()) {
-                        overwrites_whole_memory = true;
-                        break;
-                    }
-                }
-
-                // do strong update - just continue the loop without
-                // merging this definition into our map
-                if (overwrites_whole_memory)
-                    continue;
-            } else if (ds.target->getType() != DYN_ALLOC) {
-                bool skip = false;
-                auto range = std::equal_range(no_update->begin(),
-                                              no_update->end(),
-                                              ds, comp_ds);
-                for (auto I = range.first; I!= range.second; ++I) {
-                    const DefSite& ds2 = *I;
-                    assert(ds.target == ds2.target);
-                    // if the 'no_update' set contains target with unknown
-                    // pointer, we should always keep that value
-                    // and the value being merged (just all possible definitions)
-                    if (ds2.offset.isUnknown()) {
-                        // break no_update skip = true, thus adding
-                        // the values for UNKOWN to our map
-                        is_unknown = true;
-                        break;
-                    }
-
-                    // targets are the same, check if the what we have
-                    // in 'no_update' set overwrites the values that are in
-                    // the other map
-                    if ((*ds.offset >= *ds2.offset)
-                        && (*ds.offset + *ds.len <= *ds2.offset + *ds2.len)) {
-                        skip = true;
-                        break;
-                    }
-                }
-
-                // if values in 'no_update' map overwrite the coresponding values
-                // in the other map, don't update our map
-                if (skip)
-                    continue;
-            }
+            bool unknown_overwrite = false;
+            // do strong update - just continue the loop without
+            // merging this definition into our map
+            if (isOverwritten(ds, *no_update, strong_update_unknown,
+                              &unknown_overwrite))
+                continue;
+
+            // if the 'no_update' set contains target with unknown
+            // pointer, we keep the values for UNKNOWN
+            if (unknown_overwrite)
+                is_unknown = true;
         }
 
         // MERGE CONCRETE OFFSETS (if desired)
@@ -1,6 +1,7 @@
 #ifndef _DG_DEF_MAP_H_
 #define _DG_DEF_MAP_H_
 
+#include <cstddef>
 #include <set>
 #include <map>
 #include <cassert>
@@ -48,6 +49,11 @@ struct DefSite
                 : target < oth.target;
     }
 
+    bool operator==(const DefSite& oth) const
+    {
+        return target == oth.target && offset == oth.offset && len == oth.len;
+    }
+
     // what memory this node defines
     RDNode *target;
     // on what offset
@@ -138,6 +144,12 @@ public:
                uint32_t max_set_size  = (~((uint32_t) 0)),
                bool merge_unknown     = false);
     bool add(const DefSite&, RDNode *n);
+
+    // is @ds killed by some of the strong updates from @no_update?
+    static bool isOverwritten(const DefSite& ds,
+                              const DefSiteSetT& no_update,
+                              bool strong_update_unknown = true,
+                              bool *unknown_overwrite = nullptr);
     bool update(const DefSite&, RDNode *n);
     bool empty() const { return defs.empty(); }
 
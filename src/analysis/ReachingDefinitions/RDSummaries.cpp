@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "ADT/Queue.h"
+#include "ADT/ThreadPool.h"
+#include "analysis/SCC.h"
+
+#include "RDMap.h"
+#include "RDSummaries.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+// node of the call graph, as SCC<> wants it
+struct CallGraphNode {
+    CallGraphNode()
+        : index(0), dfs_id(0), lowpt(0), scc_id(0), on_stack(false) {}
+
+    unsigned index;
+
+    unsigned dfs_id;
+    unsigned lowpt;
+    unsigned scc_id;
+    bool on_stack;
+
+    std::vector<CallGraphNode *> successors;
+
+    const std::vector<CallGraphNode *>& getSuccessors() const { return successors; }
+    unsigned getSCCId() const { return scc_id; }
+};
+
+void RDSummaries::addProcedure(RDNode *root, RDNode *ret)
+{
+    assert(root && ret && "Incomplete procedure");
+
+    auto it = procedures.emplace(root, summaries.size());
+    if (it.second)
+        summaries.emplace_back(root, ret);
+}
+
+void RDSummaries::addCallSite(RDNode *call, RDNode *ret, RDNode *callee)
+{
+    assert(call && ret && callee && "Incomplete call site");
+
+    calls[call] = CallSite(call, ret, callee);
+}
+
+void RDSummaries::getSuccessors(const RDSummary& S, RDNode *n,
+                                std::vector<RDNode *>& succs) const
+{
+    // do not leave the procedure via return edges
+    if (n == S.ret)
+        return;
+
+    RDNode *callee = nullptr;
+    auto it = calls.find(n);
+    if (it != calls.end()) {
+        callee = it->second.callee;
+        assert(procedures.count(callee) > 0 && "Call of unknown procedure");
+        succs.push_back(it->second.ret);
+    }
+
+    for (RDNode *succ : n->getSuccessors()) {
+        // do not descend into the callee
+        if (succ == callee)
+            continue;
+
+        succs.push_back(succ);
+    }
+}
+
+// gather the nodes of the procedure and what its body defines.
+// This touches only the summary of the procedure, so it can
+// run in parallel for all procedures
+void RDSummaries::collect(RDSummary& S)
+{
+    std::unordered_set<RDNode *> visited;
+    std::vector<RDNode *> succs;
+    ADT::QueueFIFO<RDNode *> fifo;
+
+    fifo.push(S.root);
+    visited.insert(S.root);
+
+    while (!fifo.empty()) {
+        RDNode *cur = fifo.pop();
+        S.nodes.push_back(cur);
+
+        S.defines.insert(cur->defs.begin(), cur->defs.end());
+        S.overwrites.insert(cur->overwrites.begin(), cur->overwrites.end());
+
+        auto it = calls.find(cur);
+        if (it != calls.end())
+            S.callees.insert(procedures.find(it->second.callee)->second);
+
+        succs.clear();
+        getSuccessors(S, cur, succs);
+        for (RDNode *succ : succs) {
+            if (visited.insert(succ).second)
+                fifo.push(succ);
+        }
+    }
+}
+
+// close the summaries of the component over the callees.
+// The callees outside of this component are already done
+void RDSummaries::closeSummaries(const std::vector<unsigned>& component)
+{
+    DefSiteSetT defines, overwrites;
+    for (unsigned idx : component) {
+        RDSummary& S = summaries[idx];
+        defines.insert(S.defines.begin(), S.defines.end());
+        overwrites.insert(S.overwrites.begin(), S.overwrites.end());
+
+        for (unsigned callee : S.callees) {
+            RDSummary& C = summaries[callee];
+            defines.insert(C.defines.begin(), C.defines.end());
+            overwrites.insert(C.overwrites.begin(), C.overwrites.end());
+        }
+    }
+
+    for (unsigned idx : component) {
+        summaries[idx].defines = defines;
+        summaries[idx].overwrites = overwrites;
+    }
+}
+
+// one pass over the nodes, the same as ReachingDefinitionsAnalysis
+// does in processNode(). The root merges the maps from the call-sites
+// and the return nodes from the ret nodes of the callees.
+// Returns true if some map changed
+bool RDSummaries::computeDefinitions(const std::vector<RDNode *>& nodes)
+{
+    bool changed = false;
+
+    for (RDNode *n : nodes) {
+        if (reachable.count(n) == 0)
+            continue;
+
+        for (RDNode *pred : n->getPredecessors())
+            changed |= n->def_map.merge(&pred->def_map, &n->overwrites,
+                                        strong_update_unknown,
+                                        max_set_size, false);
+    }
+
+    return changed;
+}
+
+// iterate the procedures of the component until their maps do not
+// change. Returns true if some map changed
+bool RDSummaries::processComponent(const std::vector<unsigned>& component)
+{
+    bool any = false;
+    bool changed;
+    do {
+        changed = false;
+        for (unsigned idx : component)
+            changed |= computeDefinitions(summaries[idx].nodes);
+
+        any |= changed;
+    } while (changed);
+
+    return any;
+}
+
+void RDSummaries::run(const std::set<RDNode *>& reach, unsigned threads)
+{
+    reachable.clear();
+    reachable.insert(reach.begin(), reach.end());
+
+    ADT::ThreadPool pool(threads);
+
+    // phase 1: walk every procedure on its own
+    pool.parallelFor(summaries.size(),
+                     [this](size_t i) { collect(summaries[i]); });
+
+    std::unordered_set<RDNode *> inside;
+    for (const RDSummary& S : summaries)
+        inside.insert(S.nodes.begin(), S.nodes.end());
+
+    outside.clear();
+    for (RDNode *n : reach) {
+        if (inside.count(n) == 0)
+            outside.push_back(n);
+    }
+
+    // phase 2: compute the SCCs of the call graph and split them
+    // into waves - every component goes into the wave after
+    // all the components that it calls
+    std::vector<CallGraphNode> cg(summaries.size());
+    for (unsigned i = 0; i < summaries.size(); ++i) {
+        cg[i].index = i;
+        for (unsigned callee : summaries[i].callees)
+            cg[i].successors.push_back(&cg[callee]);
+    }
+
+    SCC<CallGraphNode> scc;
+    for (CallGraphNode& nd : cg) {
+        if (nd.dfs_id == 0)
+            scc.compute(&nd);
+    }
+
+    // the components are in reverse topological order,
+    // so callees always come before the callers
+    const auto& components = scc.getSCC();
+    std::vector<unsigned> level(components.size(), 0);
+    std::vector<std::vector<std::vector<unsigned>>> up;
+    for (unsigned c = 0; c < components.size(); ++c) {
+        std::vector<unsigned> component;
+        for (CallGraphNode *nd : components[c]) {
+            component.push_back(nd->index);
+            for (CallGraphNode *succ : nd->getSuccessors()) {
+                assert(succ->scc_id <= c);
+                if (succ->scc_id != c)
+                    level[c] = std::max(level[c], level[succ->scc_id] + 1);
+            }
+        }
+
+        if (up.size() <= level[c])
+            up.resize(level[c] + 1);
+
+        up[level[c]].push_back(std::move(component));
+    }
+
+    for (const auto& wave : up)
+        pool.parallelFor(wave.size(),
+                         [this, &wave](size_t i) { closeSummaries(wave[i]); });
+
+    // every component goes into the wave after all its callers
+    std::vector<unsigned> depth(components.size(), 0);
+    std::vector<std::vector<std::vector<unsigned>>> down;
+    for (unsigned c = components.size(); c-- > 0;) {
+        std::vector<unsigned> component;
+        for (CallGraphNode *nd : components[c]) {
+            component.push_back(nd->index);
+            for (CallGraphNode *succ : nd->getSuccessors()) {
+                if (succ->scc_id != c)
+                    depth[succ->scc_id] = std::max(depth[succ->scc_id], depth[c] + 1);
+            }
+        }
+
+        if (down.size() <= depth[c])
+            down.resize(depth[c] + 1);
+
+        down[depth[c]].push_back(std::move(component));
+    }
+
+    // phase 3: solve the equations component by component. The components
+    // in one wave do not call each other, so they do not read the maps
+    // that the others write: a procedure reads only the maps of the
+    // call-sites of its callers and of the ret nodes of its callees
+    auto sweep = [this, &pool](const std::vector<std::vector<std::vector<unsigned>>>& waves) {
+        bool changed = false;
+        for (const auto& wave : waves) {
+            std::vector<char> wchanged(wave.size(), 0);
+            pool.parallelFor(wave.size(), [this, &wave, &wchanged](size_t i) {
+                wchanged[i] = processComponent(wave[i]);
+            });
+
+            changed |= std::find(wchanged.begin(), wchanged.end(), 1)
+                        != wchanged.end();
+        }
+
+        return changed;
+    };
+
+    bool changed;
+    do {
+        changed = false;
+        while (computeDefinitions(outside))
+            changed = true;
+
+        changed |= sweep(up);
+        changed |= sweep(down);
+    } while (changed);
+}
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
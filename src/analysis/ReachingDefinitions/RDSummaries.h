@@ -0,0 +1,139 @@
+#ifndef _DG_RD_SUMMARIES_H_
+#define _DG_RD_SUMMARIES_H_
+
+#include <set>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "ReachingDefinitions.h"
+
+namespace dg {
+namespace analysis {
+namespace rd {
+
+// mod/ref summary of one procedure of the reaching definitions graph.
+// The summary covers the procedure together with all the procedures
+// that it (transitively) calls.
+struct RDSummary
+{
+    RDSummary(RDNode *r, RDNode *rt)
+        : root(r), ret(rt) {}
+
+    // the artificial entry and (unified) exit node of the procedure
+    RDNode *root;
+    RDNode *ret;
+
+    // memory that may be defined in the procedure
+    DefSiteSetT defines;
+    // memory that may be strong-updated in the procedure
+    DefSiteSetT overwrites;
+
+    // nodes of the procedure (not of callees) in BFS order
+    std::vector<RDNode *> nodes;
+    // indices of the called procedures
+    std::set<unsigned> callees;
+};
+
+///
+// Computation of reaching definitions that works on one procedure
+// at a time. In the first phase, every procedure is walked on its own
+// (in parallel) and we gather the memory that its body may define
+// or strong-update. Then we go bottom-up over the strongly connected
+// components of the call graph and close these mod/ref summaries over
+// the callees.
+//
+// The definitions are then computed by the same equations as
+// ReachingDefinitionsAnalysis uses, only they are solved procedure
+// by procedure: a procedure is iterated until its maps do not change,
+// taking the definitions that its root gets from the call-sites and
+// that its return nodes get from the callees as they are at the moment.
+// The components are processed in waves bottom-up (callees first)
+// and then top-down (callers first), and the sweeps are repeated until
+// nothing changes. The components in one wave do not call each other,
+// so the wave is processed in parallel. It is only a different order
+// of solving the same monotone equations, so the result is the same
+// as the fixpoint of ReachingDefinitionsAnalysis and it does not need
+// to run after this. Usually two sweeps are enough: the bottom-up
+// sweep computes the definitions made in the callees and the top-down
+// sweep brings the definitions of the callers into them.
+// The summaries do not work when the size of the sets
+// is bounded (the cropping is not monotone).
+class RDSummaries
+{
+public:
+    RDSummaries(bool strong_updt_unknown = false,
+                uint32_t max_set_sz = ~((uint32_t) 0))
+        : strong_update_unknown(strong_updt_unknown), max_set_size(max_set_sz)
+    {
+        assert(max_set_size == ~((uint32_t) 0)
+               && "Summaries are not supported with bounded sets");
+    }
+
+    // register a procedure given by its entry and (unified) exit node
+    void addProcedure(RDNode *root, RDNode *ret);
+
+    // register a call of the procedure with root @callee. @call is the node
+    // that has an edge to the callee's root and @ret is the node
+    // to which the callee returns
+    void addCallSite(RDNode *call, RDNode *ret, RDNode *callee);
+
+    // compute the summaries and the reaching definitions in the nodes.
+    // Only the nodes from the @reachable set (the nodes reachable
+    // from the root of the program) are computed
+    void run(const std::set<RDNode *>& reachable, unsigned threads = 1);
+
+    const RDSummary *getSummary(RDNode *root) const
+    {
+        auto it = procedures.find(root);
+        if (it == procedures.end())
+            return nullptr;
+
+        return &summaries[it->second];
+    }
+
+    const std::vector<RDSummary>& getSummaries() const { return summaries; }
+
+private:
+    struct CallSite {
+        CallSite(RDNode *c = nullptr, RDNode *r = nullptr, RDNode *cl = nullptr)
+            : call(c), ret(r), callee(cl) {}
+
+        RDNode *call;
+        RDNode *ret;
+        RDNode *callee;
+    };
+
+    // procedure's root -> index to summaries
+    std::unordered_map<RDNode *, unsigned> procedures;
+    std::vector<RDSummary> summaries;
+
+    // call node -> call site
+    std::unordered_map<RDNode *, CallSite> calls;
+
+    // nodes that are processed by the fixpoint
+    std::unordered_set<RDNode *> reachable;
+
+    bool strong_update_unknown;
+    uint32_t max_set_size;
+
+    // nodes that are reachable, but are not in any procedure
+    // (e.g. the global variables before the entry procedure)
+    std::vector<RDNode *> outside;
+
+    // get the successors of the node in the procedure. A call is
+    // replaced by an edge to the return node
+    void getSuccessors(const RDSummary& S, RDNode *n,
+                       std::vector<RDNode *>& succs) const;
+
+    void collect(RDSummary& S);
+    void closeSummaries(const std::vector<unsigned>& component);
+    bool computeDefinitions(const std::vector<RDNode *>& nodes);
+    bool processComponent(const std::vector<unsigned>& component);
+};
+
+} // namespace rd
+} // namespace analysis
+} // namespace dg
+
+#endif //  _DG_RD_SUMMARIES_H_
@@ -1,11 +1,19 @@
 #ifndef _DG_SLICING_H_
 #define _DG_SLICING_H_
 
+#include <algorithm>
+#include <atomic>
 #include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "NodesWalk.h"
 #include "BFS.h"
+#include "SummaryEdges.h"
 #include "ADT/Queue.h"
+#include "ADT/Bitvector.h"
+#include "ADT/SmallBitvector.h"
 #include "DependenceGraph.h"
 
 #ifdef ENABLE_CFG
@@ -17,23 +25,94 @@ using dg::ADT::QueueFIFO;
 namespace dg {
 namespace analysis {
 
+template <typename NodeT>
+class Slicer;
+
+// what a marking walk got to
+struct MarkStatistics
+{
+    MarkStatistics()
+        : nodes(0), blocks(0), graphs(0) {}
+
+    uint64_t nodes;
+    uint64_t blocks;
+    // the graphs are the functions
+    uint64_t graphs;
+
+    void add(const MarkStatistics& oth)
+    {
+        nodes += oth.nodes;
+        blocks += oth.blocks;
+        graphs += oth.graphs;
+    }
+};
+
+// the base of the marking walks. Every walk has its own id and the blocks
+// and graphs are stamped with the id of the last walk that got to them.
+// This way a walk marks every block and graph only once, not for every
+// node that it marks in them
+template <typename NodeT>
+class MarkWalkBase
+{
+public:
+    const MarkStatistics& getMarkStatistics() const { return markStatistics; }
+
+protected:
+    MarkWalkBase() : walk_id(0) {}
+
+    void newWalk()
+    {
+        walk_id = ++walk_counter;
+        markStatistics = MarkStatistics();
+    }
+
+    // return true if this walk got to @x for the first time
+    template <typename T>
+    bool firstVisit(T *x)
+    {
+        if (x->getMarkWalk() == walk_id)
+            return false;
+
+        x->setMarkWalk(walk_id);
+        return true;
+    }
+
+    unsigned int walk_id;
+    MarkStatistics markStatistics;
+
+    // shared by all the marking walks, even those in other threads
+    static std::atomic<unsigned int> walk_counter;
+};
+
+template <typename NodeT>
+std::atomic<unsigned int> MarkWalkBase<NodeT>::walk_counter(0);
+
 // this class will go through the nodes
 // and will mark the ones that should be in the slice
 template <typename NodeT>
-class WalkAndMark : public NodesWalk<NodeT, QueueFIFO<NodeT *>>
+class WalkAndMark : public NodesWalk<NodeT, QueueFIFO<NodeT *>>,
+                    public MarkWalkBase<NodeT>
 {
 public:
-    WalkAndMark()
+    // if @sl is given, its prepareGraph() is called for every
+    // graph that the walk gets to, before going through
+    // the edges of the graph's nodes
+    WalkAndMark(Slicer<NodeT> *sl = nullptr)
         : NodesWalk<NodeT, QueueFIFO<NodeT *>>(NODES_WALK_REV_CD |
-                                               NODES_WALK_REV_DD) {}
+                                               NODES_WALK_REV_DD),
+          slicer(sl) {}
 
     void mark(NodeT *start, uint32_t slice_id)
     {
+        this->newWalk();
+
         WalkData data(slice_id, this);
         this->walk(start, markSlice, &data);
     }
 
 private:
+    Slicer<NodeT> *slicer;
+
     struct WalkData
     {
         WalkData(uint32_t si, WalkAndMark *wm)
@@ -45,33 +124,672 @@ private:
 
     static void markSlice(NodeT *n, WalkData *data)
     {
+        WalkAndMark *wm = data->analysis;
         uint32_t slice_id = data->slice_id;
         n->setSlice(slice_id);
+        ++wm->markStatistics.nodes;
 
 #ifdef ENABLE_CFG
         // when we marked a node, we need to mark even
         // the basic block - if there are basic blocks
         BBlock<NodeT> *B = n->getBBlock();
-        if (B)
+        if (B && wm->firstVisit(B)) {
             B->setSlice(slice_id);
+            ++wm->markStatistics.blocks;
+        }
 #endif
 
         // the same with dependence graph, if we keep a node from
         // a dependence graph, we need to keep the dependence graph
         DependenceGraph<NodeT> *dg = n->getDG();
-        if (dg) {
+        if (dg && wm->firstVisit(dg)) {
+            if (wm->slicer)
+                wm->slicer->prepareGraph(dg);
+
             dg->setSlice(slice_id);
+            ++wm->markStatistics.graphs;
             // and keep also all call-sites of this func (they are
             // control dependent on the entry node)
             // This is correct but not so precise - fix it later.
             // Now I need the correctness...
             NodeT *entry = dg->getEntry();
             assert(entry && "No entry node in dg");
-            data->analysis->enqueue(entry);
+            wm->enqueue(entry);
+        }
+    }
+};
+
+// The two-phase marking of Horwitz, Reps and Binkley. In the first
+// phase, the walk goes through all the edges, except the edges from
+// the outputs of called procedures. These are skipped using the summary
+// edges and the outputs are processed in the second phase, where the walk
+// does not go up to the callers (it goes only to the called procedures).
+// Unlike WalkAndMark, the slice then does not contain the call-sites
+// of a procedure that do not affect the slicing criterion.
+// The nodes that are reached via the edges from other procedures that
+// are not carried by parameters (memory dependencies) are processed
+// in the first phase, since we do not know the context of these edges.
+template <typename NodeT>
+class ContextSensitiveMark : public MarkWalkBase<NodeT>
+{
+public:
+    ContextSensitiveMark(SummaryEdges<NodeT> *sum, Slicer<NodeT> *sl = nullptr)
+        : summaries(sum), slicer(sl) {}
+
+    void mark(NodeT *start, uint32_t sl_id)
+    {
+        this->newWalk();
+        slice_id = sl_id;
+
+        enqueue(start, PHASE_ONE);
+        while (!queue.empty()) {
+            std::pair<NodeT *, unsigned> it = queue.pop();
+            process(it.first, it.second);
+        }
+    }
+
+private:
+    enum {
+        // can go up to the callers
+        PHASE_ONE = 1 << 0,
+        // goes only down to the called procedures
+        PHASE_TWO = 1 << 1,
+    };
+
+    SummaryEdges<NodeT> *summaries;
+    Slicer<NodeT> *slicer;
+    uint32_t slice_id;
+
+    QueueFIFO<std::pair<NodeT *, unsigned>> queue;
+    // the phases in which the node was queued
+    std::unordered_map<NodeT *, unsigned> visited;
+    std::vector<NodeT *> actualIns;
+
+    void enqueue(NodeT *n, unsigned phase)
+    {
+        unsigned& v = visited[n];
+        // the first phase covers everything that the second does
+        if ((v & phase) || (v & PHASE_ONE))
+            return;
+
+        v |= phase;
+        queue.push(std::make_pair(n, phase));
+    }
+
+    void markNode(NodeT *n, unsigned phase)
+    {
+        n->setSlice(slice_id);
+        ++this->markStatistics.nodes;
+
+#ifdef ENABLE_CFG
+        BBlock<NodeT> *B = n->getBBlock();
+        if (B && this->firstVisit(B)) {
+            B->setSlice(slice_id);
+            ++this->markStatistics.blocks;
+        }
+#endif
+
+        DependenceGraph<NodeT> *dg = n->getDG();
+        if (!dg)
+            return;
+
+        if (this->firstVisit(dg)) {
+            if (slicer)
+                slicer->prepareGraph(dg);
+
+            dg->setSlice(slice_id);
+            ++this->markStatistics.graphs;
+        }
+
+        NodeT *entry = dg->getEntry();
+        assert(entry && "No entry node in dg");
+        // in the first phase, keep the call-sites of the procedure
+        // (they are control dependent on the entry node),
+        // in the second phase keep just the entry
+        if (phase == PHASE_ONE)
+            enqueue(entry, PHASE_ONE);
+        else
+            entry->setSlice(slice_id);
+    }
+
+    void process(NodeT *n, unsigned phase)
+    {
+        markNode(n, phase);
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end();
+             I != E; ++I) {
+            // the edge from a call-site to the entry of the procedure
+            if ((*I)->getDG() != n->getDG()) {
+                if (phase == PHASE_ONE)
+                    enqueue(*I, PHASE_ONE);
+            } else
+                enqueue(*I, phase);
+        }
+
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *B = n->getBBlock()) {
+            for (BBlock<NodeT> *CD : B->revControlDependence())
+                enqueue(CD->getLastNode(), phase);
+        }
+#endif // ENABLE_CFG
+
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end();
+             I != E; ++I) {
+            NodeT *m = *I;
+            if (m->getDG() == n->getDG()) {
+                enqueue(m, phase);
+            } else if (SummaryEdges<NodeT>::isOutput(m)) {
+                processOutput(n, m, phase);
+            } else if (SummaryEdges<NodeT>::isFormalIn(n)) {
+                // the edge from an actual parameter of a call-site
+                if (phase == PHASE_ONE)
+                    enqueue(m, PHASE_ONE);
+            } else
+                enqueue(m, PHASE_ONE);
+        }
+    }
+
+    // the edge from the output @out of a called procedure to @n
+    void processOutput(NodeT *n, NodeT *out, unsigned phase)
+    {
+        NodeT *callSite = SummaryEdges<NodeT>::getCallSite(n, out);
+        const typename SummaryEdges<NodeT>::Summary *S
+            = callSite ? summaries->getSummary(out) : nullptr;
+
+        // we do not know what to follow at the call-site
+        if (!S) {
+            enqueue(out, PHASE_ONE);
+            return;
+        }
+
+        for (NodeT *formal : S->inputs) {
+            actualIns.clear();
+            SummaryEdges<NodeT>::getActualIns(callSite, formal, actualIns);
+            for (NodeT *actual : actualIns)
+                enqueue(actual, phase);
+        }
+
+        for (NodeT *ext : S->external)
+            enqueue(ext, PHASE_ONE);
+
+        enqueue(out, PHASE_TWO);
+    }
+};
+
+// Marks the slices of many criteria in one walk. Every node keeps
+// the set of slices that it is in (a bitmask) and when the set grows,
+// the node is queued again, so that the new slices are propagated along
+// its edges. The whole set is propagated at once, so a node is usually
+// processed only a few times, not once for every criterion.
+// The walk follows the same edges as WalkAndMark, but it does not
+// change the slice ids of the nodes. The slices are taken
+// one by one afterwards with setSlice() (or with Slicer::slice(),
+// that drops the nodes it removes from the graph with forget())
+template <typename NodeT>
+class BatchMark
+{
+public:
+    typedef ADT::SmallBitvector SlicesT;
+
+    BatchMark(Slicer<NodeT> *sl = nullptr)
+        : slicer(sl), slicesNum(0) {}
+
+    // @criteria[k] are the nodes of the k-th slicing criterion
+    void mark(const std::vector<std::vector<NodeT *>>& criteria)
+    {
+        if (criteria.size() > slicesNum)
+            slicesNum = criteria.size();
+
+        for (size_t k = 0; k < criteria.size(); ++k) {
+            SlicesT S;
+            S.set(k);
+            for (NodeT *n : criteria[k])
+                add(n, S);
+        }
+
+        while (!queue.empty())
+            process(queue.pop());
+    }
+
+    size_t getSlicesNum() const { return slicesNum; }
+
+    // the slices that the node is in (nullptr if in none)
+    const SlicesT *getSlices(NodeT *n) const
+    {
+        auto it = nodes.find(n);
+        return it == nodes.end() ? nullptr : &it->second.slices;
+    }
+
+    bool inSlice(NodeT *n, unsigned k) const
+    {
+        const SlicesT *S = getSlices(n);
+        return S && S->test(k);
+    }
+
+    // set @sl_id to the nodes, blocks and graphs of the k-th slice
+    // (and reset it in the marked ones that are not in the slice),
+    // so that the graph can be sliced with @sl_id
+    void setSlice(unsigned k, uint32_t sl_id) const
+    {
+        assert(sl_id != 0 && "Slice id 0 means no slice");
+
+        for (auto& it : nodes)
+            setSliceOf(it.first, it.second.slices, k, sl_id);
+#ifdef ENABLE_CFG
+        for (auto& it : blocks)
+            setSliceOf(it.first, it.second, k, sl_id);
+#endif
+        for (auto& it : graphs)
+            setSliceOf(it.first, it.second, k, sl_id);
+    }
+
+    // the node was removed from the graph, do not touch it anymore
+    void forget(NodeT *n)
+    {
+        nodes.erase(n);
+    }
+
+#ifdef ENABLE_CFG
+    void forget(BBlock<NodeT> *B)
+    {
+        blocks.erase(B);
+    }
+#endif
+
+private:
+    struct NodeInfo
+    {
+        NodeInfo() : queued(false) {}
+
+        SlicesT slices;
+        bool queued;
+    };
+
+    Slicer<NodeT> *slicer;
+    size_t slicesNum;
+
+    QueueFIFO<NodeT *> queue;
+    std::unordered_map<NodeT *, NodeInfo> nodes;
+#ifdef ENABLE_CFG
+    std::unordered_map<BBlock<NodeT> *, SlicesT> blocks;
+#endif
+    std::unordered_map<DependenceGraph<NodeT> *, SlicesT> graphs;
+
+    template <typename T>
+    static void setSliceOf(T *x, const SlicesT& slices,
+                           unsigned k, uint32_t sl_id)
+    {
+        if (slices.test(k))
+            x->setSlice(sl_id);
+        else if (x->getSlice() == sl_id)
+            x->setSlice(0);
+    }
+
+    // add the slices @S to the node and queue it if it got new ones
+    void add(NodeT *n, const SlicesT& S)
+    {
+        NodeInfo& info = nodes[n];
+        if (info.slices.merge(S) && !info.queued) {
+            info.queued = true;
+            queue.push(n);
+        }
+    }
+
+    void process(NodeT *n)
+    {
+        // the references to the elements of unordered_map
+        // stay valid when other elements are inserted
+        NodeInfo& info = nodes[n];
+        info.queued = false;
+        const SlicesT& S = info.slices;
+
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *B = n->getBBlock())
+            blocks[B].merge(S);
+#endif
+
+        // keep the graph and the call-sites of the graph
+        // (see WalkAndMark)
+        if (DependenceGraph<NodeT> *dg = n->getDG()) {
+            auto it = graphs.find(dg);
+            if (it == graphs.end()) {
+                if (slicer)
+                    slicer->prepareGraph(dg);
+                it = graphs.emplace(dg, SlicesT()).first;
+            }
+
+            it->second.merge(S);
+
+            NodeT *entry = dg->getEntry();
+            assert(entry && "No entry node in dg");
+            add(entry, S);
+        }
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end();
+             I != E; ++I)
+            add(*I, S);
+
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *B = n->getBBlock()) {
+            for (BBlock<NodeT> *CD : B->revControlDependence())
+                add(CD->getLastNode(), S);
+        }
+#endif // ENABLE_CFG
+
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end();
+             I != E; ++I)
+            add(*I, S);
+    }
+};
+
+// The nodes get dense numbers when a walk gets to them for the first time,
+// so that the sets of nodes that the walks compute can be bitvectors.
+// The nodes are kept as pointers, so the numbers must be
+// forgotten (clear()) when the graph changes, e.g. by slicing.
+template <typename NodeT>
+class NumberedNodes : public MarkWalkBase<NodeT>
+{
+public:
+    NodeT *getNode(size_t i) const
+    {
+        assert(i < nodes.size() && "No such node");
+        return nodes[i];
+    }
+
+    size_t getNodesNum() const { return nodes.size(); }
+
+    // is the node in the set?
+    bool inSet(const ADT::Bitvector& set, NodeT *n) const
+    {
+        auto it = ids.find(n);
+        return it != ids.end() && it->second < set.size()
+                && set.test(it->second);
+    }
+
+    // mark the nodes in the set with @sl_id, together with their
+    // blocks and graphs (every block and graph only once)
+    void markNodes(const ADT::Bitvector& set, uint32_t sl_id)
+    {
+        this->newWalk();
+        set.forEach([this, sl_id](size_t i) {
+            NodeT *n = nodes[i];
+            n->setSlice(sl_id);
+            ++this->markStatistics.nodes;
+#ifdef ENABLE_CFG
+            BBlock<NodeT> *B = n->getBBlock();
+            if (B && this->firstVisit(B)) {
+                B->setSlice(sl_id);
+                ++this->markStatistics.blocks;
+            }
+#endif
+            DependenceGraph<NodeT> *dg = n->getDG();
+            if (dg && this->firstVisit(dg)) {
+                dg->setSlice(sl_id);
+                ++this->markStatistics.graphs;
+            }
+        });
+    }
+
+protected:
+    void clearNumbers()
+    {
+        ids.clear();
+        nodes.clear();
+    }
+
+    size_t getID(NodeT *n)
+    {
+        auto it = ids.emplace(n, nodes.size());
+        if (it.second)
+            nodes.push_back(n);
+
+        return it.first->second;
+    }
+
+    // add the node to the set (the set grows if needed),
+    // return true if the node was not in the set before
+    bool addTo(ADT::Bitvector& set, NodeT *n)
+    {
+        size_t id = getID(n);
+        if (id >= set.size())
+            set.resize(std::max(2 * set.size(), id + 1));
+
+        return set.set(id);
+    }
+
+    // call @fn for every node that @n depends on. These are the same
+    // edges as WalkAndMark takes, including the edge to the entry
+    // of the graph (the call-sites of the graph depend on the entry)
+    template <typename FuncT>
+    static void forEachBackward(NodeT *n, FuncT fn)
+    {
+        if (DependenceGraph<NodeT> *dg = n->getDG()) {
+            NodeT *entry = dg->getEntry();
+            assert(entry && "No entry node in dg");
+            fn(entry);
+        }
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end();
+             I != E; ++I)
+            fn(*I);
+
+#ifdef ENABLE_CFG
+        if (BBlock<NodeT> *B = n->getBBlock()) {
+            for (BBlock<NodeT> *CD : B->revControlDependence())
+                fn(CD->getLastNode());
+        }
+#endif // ENABLE_CFG
+
+        for (auto I = n->rev_data_begin(), E = n->rev_data_end();
+             I != E; ++I)
+            fn(*I);
+    }
+
+    // call @fn for every node that depends on @n. These are the reversed
+    // edges of forEachBackward(), so every node of a graph depends on its
+    // entry (e.g. a call-site gets to all the nodes of the called graph)
+    template <typename FuncT>
+    static void forEachForward(NodeT *n, FuncT fn)
+    {
+        DependenceGraph<NodeT> *dg = n->getDG();
+        if (dg && dg->getEntry() == n) {
+            for (auto& it : *dg)
+                fn(it.second);
+        }
+
+        for (auto I = n->control_begin(), E = n->control_end();
+             I != E; ++I)
+            fn(*I);
+
+#ifdef ENABLE_CFG
+        // the last node of a block decides whether the blocks
+        // that are control dependent on the block are executed,
+        // so all their nodes depend on it
+        BBlock<NodeT> *B = n->getBBlock();
+        if (B && B->getLastNode() == n) {
+            for (BBlock<NodeT> *CD : B->controlDependence()) {
+                for (NodeT *m : CD->getNodes())
+                    fn(m);
+            }
+        }
+#endif // ENABLE_CFG
+
+        for (auto I = n->data_begin(), E = n->data_end();
+             I != E; ++I)
+            fn(*I);
+    }
+
+private:
+    std::unordered_map<NodeT *, size_t> ids;
+    std::vector<NodeT *> nodes;
+};
+
+// Remembers the slices of the criteria that were asked for,
+// so that the same or overlapping criteria are not walked again.
+// The slice of a set of nodes is the union of the slices of the nodes
+// (the walk is a backward reachability, as in WalkAndMark), so the
+// slice of every criterion node is kept on its own and the slice of
+// a request is the union of them. The walk from a new criterion
+// does not go through the nodes whose slice is known already, it
+// just takes their slices.
+template <typename NodeT>
+class MemoizedMark : public NumberedNodes<NodeT>
+{
+public:
+    MemoizedMark(Slicer<NodeT> *sl = nullptr)
+        : slicer(sl) {}
+
+    // the slice of @criteria as a set of the numbers of nodes
+    // (see getNode()). The set may be bigger than the number of nodes
+    ADT::Bitvector getSlice(const std::vector<NodeT *>& criteria)
+    {
+        ADT::Bitvector ret(this->getNodesNum());
+        for (NodeT *c : criteria)
+            ret.merge(getNodeSlice(c));
+
+        return ret;
+    }
+
+    // mark the slice of @criteria with @sl_id the same way as WalkAndMark
+    void mark(const std::vector<NodeT *>& criteria, uint32_t sl_id)
+    {
+        this->markNodes(getSlice(criteria), sl_id);
+    }
+
+    // the number of criterion nodes whose slices are remembered
+    size_t getMemoizedNum() const { return slices.size(); }
+
+    void clear()
+    {
+        this->clearNumbers();
+        slices.clear();
+    }
+
+private:
+    Slicer<NodeT> *slicer;
+
+    // the slices of the criterion nodes
+    std::unordered_map<NodeT *, ADT::Bitvector> slices;
+
+    const ADT::Bitvector& getNodeSlice(NodeT *crit)
+    {
+        auto known = slices.find(crit);
+        if (known != slices.end())
+            return known->second;
+
+        // the walk from the criterion stamps the graphs,
+        // so that the slicer gets every graph only once
+        this->newWalk();
+
+        ADT::Bitvector slice(this->getNodesNum());
+        std::vector<NodeT *> stack;
+
+        auto add = [this, &slice, &stack](NodeT *n) {
+            if (this->addTo(slice, n))
+                stack.push_back(n);
+        };
+
+        add(crit);
+        while (!stack.empty()) {
+            NodeT *n = stack.back();
+            stack.pop_back();
+
+            // the slice of this node is known,
+            // everything it reaches is in there
+            if (n != crit) {
+                auto it = slices.find(n);
+                if (it != slices.end()) {
+                    slice.merge(it->second);
+                    continue;
+                }
+            }
+
+            DependenceGraph<NodeT> *dg = n->getDG();
+            if (dg && slicer && this->firstVisit(dg))
+                slicer->prepareGraph(dg);
+
+            this->forEachBackward(n, add);
+        }
+
+        return slices.emplace(crit, std::move(slice)).first->second;
+    }
+};
+
+// Computes forward slices (the nodes that depend on the given nodes)
+// and chops (the nodes that depend on the sources and that the sinks
+// depend on). Every set is computed by one walk that goes only
+// through the nodes in the set. The edges are not computed lazily
+// here, since the forward edges of a node are computed together with
+// the graphs of its users, so the graph must be complete.
+template <typename NodeT>
+class ChopMark : public NumberedNodes<NodeT>
+{
+public:
+    // the nodes that depend on @sources
+    ADT::Bitvector forward(const std::vector<NodeT *>& sources)
+    {
+        return walk(sources, true);
+    }
+
+    // the nodes that @sinks depend on (the backward slice)
+    ADT::Bitvector backward(const std::vector<NodeT *>& sinks)
+    {
+        return walk(sinks, false);
+    }
+
+    // the nodes on the paths from @sources to @sinks
+    ADT::Bitvector chop(const std::vector<NodeT *>& sources,
+                        const std::vector<NodeT *>& sinks)
+    {
+        ADT::Bitvector ret = forward(sources);
+        ret.intersect(backward(sinks));
+        return ret;
+    }
+
+    void clear()
+    {
+        this->clearNumbers();
+    }
+
+private:
+    ADT::Bitvector walk(const std::vector<NodeT *>& start, bool fwd)
+    {
+        ADT::Bitvector set(this->getNodesNum());
+        std::vector<NodeT *> stack;
+
+        auto add = [this, &set, &stack](NodeT *n) {
+            if (this->addTo(set, n))
+                stack.push_back(n);
+        };
+
+        for (NodeT *n : start)
+            add(n);
+
+        while (!stack.empty()) {
+            NodeT *n = stack.back();
+            stack.pop_back();
+
+            if (fwd)
+                this->forEachForward(n, add);
+            else
+                this->forEachBackward(n, add);
         }
+
+        return set;
     }
 };
 
+enum SlicerFlags {
+    // mark the slice with ContextSensitiveMark
+    // instead of WalkAndMark
+    SLICER_CONTEXT_SENSITIVE = 1 << 0,
+    // remember the slices of the marked nodes (MemoizedMark), so that
+    // the next calls of mark() do not walk them again. The slices are
+    // forgotten when the graph is sliced. Not used with
+    // SLICER_CONTEXT_SENSITIVE
+    SLICER_MEMOIZE = 1 << 1,
+};
+
 struct SlicerStatistics
 {
     SlicerStatistics()
@@ -94,8 +812,11 @@ class Slicer : Analysis<NodeT>
 
     void sliceGraph(DependenceGraph<NodeT> *dg, uint32_t slice_id)
     {
-        for (auto& it : *dg) {
-            NodeT *n = it.second;
+        for (auto I = dg->begin(), E = dg->end(); I != E;) {
+            NodeT *n = I->second;
+            // shift here, so that we won't corrupt the iterator
+            // by deleting the node
+            ++I;
 
             // slice subgraphs if this node is a call-site
             for (DependenceGraph<NodeT> *sub : n->getSubgraphs())
@@ -103,8 +824,10 @@ class Slicer : Analysis<NodeT>
 
             if (n->getSlice() != slice_id) {
                 // do graph specific logic
-                if (removeNode(n))
+                if (removeNode(n)) {
+                    forget(n);
                     dg->deleteNode(n);
+                }
             }
         }
 
@@ -115,10 +838,29 @@ protected:
 
     // how many nodes and blocks were removed or kept
     SlicerStatistics statistics;
+    // what the marking got to, for every slice id
+    std::unordered_map<uint32_t, MarkStatistics> markStatistics;
+
+    // summary edges for the context-sensitive marking,
+    // they are shared by all the calls of mark()
+    SummaryEdges<NodeT> summaries;
+    // the remembered slices with SLICER_MEMOIZE
+    MemoizedMark<NodeT> memoized;
+    // the batch marking whose slice is being sliced
+    BatchMark<NodeT> *batch;
+
+    // the node is going to be deleted, drop it
+    // from the batch marking that we slice (if any)
+    void forget(NodeT *n)
+    {
+        if (batch)
+            batch->forget(n);
+    }
 
 public:
     Slicer<NodeT>(uint32_t opt = 0)
-        :options(opt), slice_id(0) {}
+        :options(opt), slice_id(0), summaries(this), memoized(this),
+         batch(nullptr) {}
 
     SlicerStatistics& getStatistics() { return statistics; }
     const SlicerStatistics& getStatistics() const { return statistics; }
@@ -128,22 +870,74 @@ public:
         if (sl_id == 0)
             sl_id = ++slice_id;
 
-        WalkAndMark<NodeT> wm;
-        wm.mark(start, sl_id);
+        MarkStatistics& ms = markStatistics[sl_id];
+        if (options & SLICER_CONTEXT_SENSITIVE) {
+            ContextSensitiveMark<NodeT> csm(&summaries, this);
+            csm.mark(start, sl_id);
+            ms.add(csm.getMarkStatistics());
+        } else if (options & SLICER_MEMOIZE) {
+            memoized.mark({start}, sl_id);
+            ms.add(memoized.getMarkStatistics());
+        } else {
+            WalkAndMark<NodeT> wm(this);
+            wm.mark(start, sl_id);
+            ms.add(wm.getMarkStatistics());
+        }
 
         return sl_id;
     }
 
+    // what the marking of the slice got to, summed over all
+    // the calls of mark() with this slice id (so a node that
+    // is marked in more calls is counted more times)
+    MarkStatistics getMarkStatistics(uint32_t sl_id) const
+    {
+        auto it = markStatistics.find(sl_id);
+        return it == markStatistics.end() ? MarkStatistics() : it->second;
+    }
+
+    // the number of nodes whose slices are remembered (SLICER_MEMOIZE)
+    size_t getMemoizedNum() const { return memoized.getMemoizedNum(); }
+
     uint32_t slice(NodeT *start, uint32_t sl_id = 0)
     {
         // for now it will does the same as mark,
         // just remove the rest of nodes
         sl_id = mark(start, sl_id);
         sliceGraph(start->getDG(), sl_id);
+        // the remembered slices have the removed nodes
+        memoized.clear();
+
+        return sl_id;
+    }
+
+    // slice with the k-th slice of a batch marking. All the slices
+    // are in the same graph, so the nodes that are not in the slice
+    // are removed from the marking too and the next slice
+    // is taken from the nodes that are left
+    uint32_t slice(DependenceGraph<NodeT> *dg, BatchMark<NodeT>& marks,
+                   unsigned k, uint32_t sl_id)
+    {
+        assert(k < marks.getSlicesNum() && "No such slice");
+
+        marks.setSlice(k, sl_id);
+        batch = &marks;
+        sliceGraph(dg, sl_id);
+        batch = nullptr;
+        // the remembered slices have the removed nodes
+        memoized.clear();
 
         return sl_id;
     }
 
+    // called by mark() when it gets to a node of the graph,
+    // before it goes through the edges of the node. This allows
+    // to compute the edges of the graph only when they are needed
+    virtual void prepareGraph(DependenceGraph<NodeT> *graph)
+    {
+        (void) graph;
+    }
+
     // remove node from the graph
     // This virtual method allows to taky an action
     // when node is being removed from the graph. It can also
@@ -160,6 +954,16 @@ public:
         (void) block;
     }
 
+    void forget(BBlock<NodeT> *block)
+    {
+        if (!batch)
+            return;
+
+        batch->forget(block);
+        for (NodeT *n : block->getNodes())
+            batch->forget(n);
+    }
+
     struct RemoveBlockData {
         uint32_t sl_id;
         std::set<BBlock<NodeT> *>& blocks;
@@ -191,7 +995,8 @@ public:
             // call specific handlers (overriden by child class)
             removeBlock(blk);
 
-            // remove block from the graph
+            // remove block from the graph (with its nodes)
+            forget(blk);
             blk->remove();
         }
     }
@@ -222,7 +1027,8 @@ public:
             // call specific handlers (overriden by child class)
             removeBlock(blk);
 
-            // remove block from the graph
+            // remove block from the graph (with its nodes)
+            forget(blk);
             blk->remove();
         }
 
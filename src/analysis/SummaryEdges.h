@@ -0,0 +1,240 @@
+#ifndef _DG_SUMMARY_EDGES_H_
+#define _DG_SUMMARY_EDGES_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "DependenceGraph.h"
+#include "DGParameters.h"
+
+namespace dg {
+namespace analysis {
+
+template <typename NodeT>
+class Slicer;
+
+/// ------------------------------------------------------------------
+// - SummaryEdges
+//
+//   Summary edges of Horwitz, Reps and Binkley. For an output of
+//   a procedure (the exit node or a formal output parameter) it keeps
+//   the formal input parameters that the output depends on. They are
+//   found by a backward walk through the procedure that does not go
+//   into the called procedures, but uses their summaries instead.
+//   At a call-site, the summary gives the actual input parameters that
+//   the result of the call depends on, so a walk does not need to go
+//   into the procedure and out of it to all of its call-sites.
+//
+//   The dependencies that are not carried by parameters (e.g. the edges
+//   from memory definitions in other procedures) are kept in the summary
+//   as external nodes. The same holds for the outputs of (recursive)
+//   procedures whose summary is being computed at the moment.
+//
+//   The summaries are computed on demand and cached.
+//   They are valid until the graph is modified.
+/// ------------------------------------------------------------------
+template <typename NodeT>
+class SummaryEdges
+{
+public:
+    struct Summary {
+        // formal input parameters that the output depends on
+        std::set<NodeT *> inputs;
+        // nodes outside of the procedure (and the procedures
+        // it calls) that the output depends on
+        std::set<NodeT *> external;
+    };
+
+    // the slicer is asked to prepare every graph
+    // before it is walked (see Slicer::prepareGraph())
+    SummaryEdges<NodeT>(Slicer<NodeT> *sl = nullptr)
+        : slicer(sl) {}
+
+    // get the summary of the output @out (the exit node or a formal
+    // output parameter). Return nullptr if the summary of @out is just
+    // being computed (the procedure is recursive)
+    const Summary *getSummary(NodeT *out)
+    {
+        auto it = summaries.find(out);
+        if (it != summaries.end())
+            return it->second.get();
+
+        if (!computing.insert(out).second)
+            return nullptr;
+
+        std::unique_ptr<Summary> S(new Summary());
+        compute(out, *S);
+
+        computing.erase(out);
+        return (summaries[out] = std::move(S)).get();
+    }
+
+    void clear()
+    {
+        summaries.clear();
+    }
+
+    // is the node an input parameter of its graph?
+    static bool isFormalIn(NodeT *n)
+    {
+        DGParameter<NodeT> *p = findParameter(getFormalParameters(n), n);
+        return p && p->in == n;
+    }
+
+    // is the node an output of its graph (the exit node or
+    // an output parameter)?
+    static bool isOutput(NodeT *n)
+    {
+        if (!n->getDG())
+            return false;
+
+        if (n == n->getDG()->getExit())
+            return true;
+
+        DGParameter<NodeT> *p = findParameter(getFormalParameters(n), n);
+        return p && p->out == n;
+    }
+
+    // get the call-site where the output @out of a procedure gets
+    // to the node @n in the caller (@n is the call-site itself
+    // or its actual output parameter)
+    static NodeT *getCallSite(NodeT *n, NodeT *out)
+    {
+        if (n->getSubgraphs().count(out->getDG()) != 0)
+            return n;
+
+        for (auto I = n->rev_control_begin(), E = n->rev_control_end();
+             I != E; ++I) {
+            DGParameter<NodeT> *p = findParameter((*I)->getParameters(), n);
+            if (p && p->out == n)
+                return *I;
+        }
+
+        return nullptr;
+    }
+
+    // store to @ret the actual input parameters of the call-site
+    // that are passed to the formal input parameter @formal
+    static void getActualIns(NodeT *callSite, NodeT *formal,
+                             std::vector<NodeT *>& ret)
+    {
+        DGParameters<NodeT> *params = callSite->getParameters();
+        if (!params)
+            return;
+
+        for (auto I = formal->rev_data_begin(), E = formal->rev_data_end();
+             I != E; ++I) {
+            DGParameter<NodeT> *p = findParameter(params, *I);
+            if (p && p->in == *I)
+                ret.push_back(*I);
+        }
+    }
+
+private:
+    Slicer<NodeT> *slicer;
+
+    std::map<NodeT *, std::unique_ptr<Summary>> summaries;
+    // the outputs whose summaries we are computing
+    std::set<NodeT *> computing;
+
+    static DGParameters<NodeT> *getFormalParameters(NodeT *n)
+    {
+        return n->getDG() ? n->getDG()->getParameters() : nullptr;
+    }
+
+    static DGParameter<NodeT> *findParameter(DGParameters<NodeT> *params,
+                                             NodeT *n)
+    {
+        if (!params)
+            return nullptr;
+
+        DGParameter<NodeT> *p = params->find(n->getKey());
+        if (p && (p->in == n || p->out == n))
+            return p;
+
+        p = params->getVarArg();
+        if (p && (p->in == n || p->out == n))
+            return p;
+
+        return nullptr;
+    }
+
+    // walk backward from the output through its procedure
+    void compute(NodeT *out, Summary& S)
+    {
+        auto *graph = out->getDG();
+        if (slicer)
+            slicer->prepareGraph(graph);
+
+        std::set<NodeT *> visited;
+        std::vector<NodeT *> queue;
+
+        auto enqueue = [&visited, &queue](NodeT *n) {
+            if (visited.insert(n).second)
+                queue.push_back(n);
+        };
+
+        std::vector<NodeT *> actualIns;
+
+        enqueue(out);
+        while (!queue.empty()) {
+            NodeT *n = queue.back();
+            queue.pop_back();
+
+            // the input parameters get the values from the callers
+            if (isFormalIn(n)) {
+                S.inputs.insert(n);
+                continue;
+            }
+
+            // the only control dependencies that come from other
+            // graphs are the edges from the call-sites to the entry
+            for (auto I = n->rev_control_begin(), E = n->rev_control_end();
+                 I != E; ++I) {
+                if ((*I)->getDG() == graph)
+                    enqueue(*I);
+            }
+
+#ifdef ENABLE_CFG
+            if (BBlock<NodeT> *B = n->getBBlock()) {
+                for (BBlock<NodeT> *CD : B->revControlDependence())
+                    enqueue(CD->getLastNode());
+            }
+#endif // ENABLE_CFG
+
+            for (auto I = n->rev_data_begin(), E = n->rev_data_end();
+                 I != E; ++I) {
+                NodeT *m = *I;
+                if (m->getDG() == graph) {
+                    enqueue(m);
+                    continue;
+                }
+
+                // an output of a called procedure,
+                // skip the procedure using its summary
+                NodeT *callSite = isOutput(m) ? getCallSite(n, m) : nullptr;
+                const Summary *sub = callSite ? getSummary(m) : nullptr;
+                if (!sub) {
+                    S.external.insert(m);
+                    continue;
+                }
+
+                for (NodeT *formal : sub->inputs) {
+                    actualIns.clear();
+                    getActualIns(callSite, formal, actualIns);
+                    for (NodeT *actual : actualIns)
+                        enqueue(actual);
+                }
+
+                S.external.insert(sub->external.begin(), sub->external.end());
+            }
+        }
+    }
+};
+
+} // namespace analysis
+} // namespace dg
+
+#endif // _DG_SUMMARY_EDGES_H_
@@ -63,13 +63,15 @@ static std::ostream& printLLVMVal(std::ostream& os, const llvm::Value *val)
 
 class LLVMDG2Dot : public debug::DG2Dot<LLVMNode>
 {
+    LLVMDependenceGraph *llvmdg;
+
 public:
 
     // FIXME: make dg const
     LLVMDG2Dot(LLVMDependenceGraph *dg,
                uint32_t opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD,
                const char *file = NULL)
-        : debug::DG2Dot<LLVMNode>(dg, opts, file) {}
+        : debug::DG2Dot<LLVMNode>(dg, opts, file), llvmdg(dg) {}
 
     /* virtual */
     std::ostream& printKey(std::ostream& os, llvm::Value *val)
@@ -128,7 +130,7 @@ public:
             return false;
 
         const std::map<llvm::Value *,
-                       LLVMDependenceGraph *>& CF = getConstructedFunctions();
+                       LLVMDependenceGraph *>& CF = llvmdg->getConstructedFunctions();
 
         start();
 
@@ -164,12 +166,14 @@ private:
 
 class LLVMDGDumpBlocks : public debug::DG2Dot<LLVMNode>
 {
+    LLVMDependenceGraph *llvmdg;
+
 public:
 
     LLVMDGDumpBlocks(LLVMDependenceGraph *dg,
                   uint32_t opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD,
                   const char *file = NULL)
-        : debug::DG2Dot<LLVMNode>(dg, opts, file) {}
+        : debug::DG2Dot<LLVMNode>(dg, opts, file), llvmdg(dg) {}
 
     /* virtual
     std::ostream& printKey(std::ostream& os, llvm::Value *val)
@@ -192,7 +196,7 @@ public:
             return false;
 
         const std::map<llvm::Value *,
-                       LLVMDependenceGraph *>& CF = getConstructedFunctions();
+                       LLVMDependenceGraph *>& CF = llvmdg->getConstructedFunctions();
 
         start();
 
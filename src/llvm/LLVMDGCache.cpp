@@ -0,0 +1,1374 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Value.h>
+#include <llvm/IR/Function.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "LLVMDependenceGraph.h"
+#include "LLVMNode.h"
+#include "LLVMDGCache.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+#include "llvm/analysis/ReachingDefinitions/ReachingDefinitions.h"
+
+using llvm::errs;
+using dg::analysis::rd::LLVMRDBuilder;
+using dg::analysis::rd::LLVMReachingDefinitions;
+using dg::analysis::rd::RDMap;
+using dg::analysis::rd::RDNode;
+
+namespace dg {
+
+namespace {
+
+// 'DGC' and the version of the format
+const uint32_t CACHE_MAGIC = 0x00434744;
+const uint32_t CACHE_VERSION = 3;
+
+enum ValueKind : uint8_t {
+    VAL_NONE,
+    VAL_GLOBAL,
+    VAL_FUNCTION,
+    VAL_ARGUMENT,
+    VAL_BLOCK,
+    VAL_INSTRUCTION,
+    // the vararg parameter and the unified exit block,
+    // we do not have these in the module
+    VAL_VARARG,
+    VAL_EXIT_BLOCK
+};
+
+// a value identified by its kind and the numbers of the function
+// and of the value in the function (or the number of the global)
+struct ValueId {
+    uint8_t kind;
+    uint32_t x, y;
+
+    ValueId(uint8_t k = VAL_NONE, uint32_t a = 0, uint32_t b = 0)
+        : kind(k), x(a), y(b) {}
+
+    bool operator<(const ValueId& oth) const
+    {
+        return std::tie(kind, x, y) < std::tie(oth.kind, oth.x, oth.y);
+    }
+};
+
+enum NodeKind : uint8_t {
+    NODE_GLOBAL,
+    NODE_ENTRY,
+    NODE_EXIT,
+    NODE_LOCAL,
+    NODE_FORMAL_IN,
+    NODE_FORMAL_OUT,
+    NODE_ACTUAL_IN,
+    NODE_ACTUAL_OUT
+};
+
+// a node is identified by its kind, its value and the value
+// that it belongs to (the function or the call-site)
+struct NodeId {
+    uint8_t kind;
+    ValueId owner;
+    ValueId value;
+
+    NodeId(uint8_t k = NODE_GLOBAL, const ValueId& o = ValueId(),
+           const ValueId& v = ValueId())
+        : kind(k), owner(o), value(v) {}
+
+    bool operator<(const NodeId& oth) const
+    {
+        return std::tie(kind, owner, value)
+                < std::tie(oth.kind, oth.owner, oth.value);
+    }
+};
+
+// the numbers of the values in the module
+class ModuleNumbering
+{
+    std::unordered_map<const llvm::Value *, ValueId> ids;
+    std::map<ValueId, llvm::Value *> values;
+    std::vector<llvm::Function *> functions;
+
+    void add(llvm::Value *val, const ValueId& id)
+    {
+        ids[val] = id;
+        values[id] = val;
+    }
+
+public:
+    ModuleNumbering(llvm::Module *M)
+    {
+        uint32_t idx = 0;
+        for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I)
+            add(&*I, ValueId(VAL_GLOBAL, idx++));
+
+        idx = 0;
+        for (llvm::Function& F : *M) {
+            functions.push_back(&F);
+            add(&F, ValueId(VAL_FUNCTION, idx));
+
+            uint32_t num = 0;
+            for (auto I = F.arg_begin(), E = F.arg_end(); I != E; ++I)
+                add(&*I, ValueId(VAL_ARGUMENT, idx, num++));
+
+            uint32_t bnum = 0;
+            num = 0;
+            for (llvm::BasicBlock& B : F) {
+                add(&B, ValueId(VAL_BLOCK, idx, bnum++));
+                for (llvm::Instruction& I : B)
+                    add(&I, ValueId(VAL_INSTRUCTION, idx, num++));
+            }
+
+            ++idx;
+        }
+    }
+
+    bool getId(const llvm::Value *val, ValueId& id) const
+    {
+        auto it = ids.find(val);
+        if (it == ids.end())
+            return false;
+
+        id = it->second;
+        return true;
+    }
+
+    llvm::Value *getValue(const ValueId& id) const
+    {
+        auto it = values.find(id);
+        return it == values.end() ? nullptr : it->second;
+    }
+
+    const std::vector<llvm::Function *>& getFunctions() const
+    {
+        return functions;
+    }
+};
+
+// FNV-1a, it must not change between runs
+const uint64_t HASH_INIT = 14695981039346656037ULL;
+
+static void hashBytes(uint64_t& hash, const char *data, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+}
+
+template <typename T>
+static void hashValue(uint64_t& hash, const T& val)
+{
+    hashBytes(hash, reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+static void hashString(uint64_t& hash, const std::string& str)
+{
+    hashValue(hash, static_cast<uint32_t>(str.size()));
+    hashBytes(hash, str.data(), str.size());
+}
+
+template <typename T>
+static std::string toString(const T *val)
+{
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    val->print(os);
+    return os.str();
+}
+
+// the hash of the instructions of the function. It does not depend
+// on the other functions (e.g. on the numbering of the metadata),
+// so it changes only when the function changes
+static uint64_t hashFunction(const llvm::Function& F,
+                             std::unordered_map<const llvm::Type *,
+                                                std::string>& types)
+{
+    using namespace llvm;
+
+    auto typeString = [&types](const Type *T) -> const std::string& {
+        auto it = types.find(T);
+        if (it == types.end())
+            it = types.emplace(T, toString(T)).first;
+        return it->second;
+    };
+
+    // the local values are identified by their numbers
+    std::unordered_map<const Value *, uint32_t> local;
+    for (auto I = F.arg_begin(), E = F.arg_end(); I != E; ++I)
+        local.emplace(&*I, local.size());
+    for (const BasicBlock& B : F) {
+        local.emplace(&B, local.size());
+        for (const Instruction& I : B)
+            local.emplace(&I, local.size());
+    }
+
+    uint64_t hash = HASH_INIT;
+    hashString(hash, typeString(F.getFunctionType()));
+    for (const BasicBlock& B : F) {
+        hashValue(hash, static_cast<uint32_t>(B.size()));
+        for (const Instruction& I : B) {
+            hashValue(hash, I.getOpcode());
+            hashString(hash, typeString(I.getType()));
+            if (const CmpInst *C = dyn_cast<CmpInst>(&I))
+                hashValue(hash, static_cast<uint32_t>(C->getPredicate()));
+
+            hashValue(hash, I.getNumOperands());
+            for (auto O = I.op_begin(), OE = I.op_end(); O != OE; ++O) {
+                const Value *op = *O;
+                auto it = local.find(op);
+                if (it != local.end()) {
+                    hashValue(hash, 'l');
+                    hashValue(hash, it->second);
+                } else if (const GlobalValue *GV = dyn_cast<GlobalValue>(op)) {
+                    hashValue(hash, 'g');
+                    hashString(hash, GV->getName().str());
+                } else if (isa<Constant>(op)) {
+                    hashValue(hash, 'c');
+                    hashString(hash, toString(op));
+                } else
+                    // metadata or inline assembly
+                    hashValue(hash, 'o');
+            }
+        }
+    }
+
+    return hash;
+}
+
+// the names of the globals, the nodes of the globals
+// are identified by their numbers
+static uint64_t hashGlobals(llvm::Module *M)
+{
+    uint64_t hash = HASH_INIT;
+    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I)
+        hashString(hash, I->getName().str());
+
+    return hash;
+}
+
+// the hash of what the def-use edges of a function are computed from
+// besides its instructions: the points-to sets of its pointer operands,
+// the definitions that reach its root from the callers and the return
+// nodes of its calls from the callees, and the nodes that may define
+// the memory (these are used when the definitions are unknown).
+// The definitions are taken only for the memory that the function
+// may access. The reaching definitions in the function are the least
+// solution of its own equations given the definitions in the root
+// and in the return nodes, so when neither the function nor this hash
+// changed, the def-use edges of the function did not change either.
+// The values are identified by the names of the functions and their
+// numbers in the functions, so that the hash does not change when
+// other functions are added or removed
+class DataFlowHasher
+{
+    // the ids of the null and unknown memory
+    enum : uint64_t { ID_NULL = 1, ID_UNKNOWN = 2 };
+
+    const ModuleNumbering& nums;
+    LLVMReachingDefinitions *RD;
+    LLVMPointerAnalysis *PTA;
+
+    // the call nodes of the calls of defined functions
+    std::unordered_map<RDNode *, const LLVMRDBuilder::CallSite *> calls;
+    std::unordered_map<RDNode *, const llvm::Function *> roots;
+    std::unordered_map<const llvm::Value *, uint64_t> ids;
+
+    bool getId(const llvm::Value *val, uint64_t& ret)
+    {
+        auto it = ids.find(val);
+        if (it != ids.end()) {
+            ret = it->second;
+            return true;
+        }
+
+        ValueId id;
+        if (!nums.getId(val, id))
+            return false;
+
+        uint64_t hash = HASH_INIT;
+        hashValue(hash, id.kind);
+        if (id.kind == VAL_GLOBAL) {
+            hashValue(hash, id.x);
+        } else {
+            const llvm::Function *F = nums.getFunctions()[id.x];
+            if (F->getName().empty())
+                return false;
+
+            hashString(hash, F->getName().str());
+            hashValue(hash, id.y);
+        }
+
+        ids.emplace(val, hash);
+        ret = hash;
+        return true;
+    }
+
+    bool getId(RDNode *n, uint64_t& ret)
+    {
+        if (n == analysis::rd::UNKNOWN_MEMORY) {
+            ret = ID_UNKNOWN;
+            return true;
+        }
+
+        const llvm::Value *val = n->getUserData<llvm::Value>();
+        uint64_t id;
+        if (!val || !getId(val, id))
+            return false;
+
+        ret = HASH_INIT;
+        hashValue(ret, id);
+        hashValue(ret, static_cast<uint8_t>(n->getType()));
+        return true;
+    }
+
+    // hash the definitions of the @memory in the map
+    bool hashMap(const RDMap& map, const std::set<RDNode *>& memory,
+                 uint64_t& hash)
+    {
+        std::vector<std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>> defs;
+        for (const auto& it : map) {
+            if (memory.count(it.first.target) == 0)
+                continue;
+
+            uint64_t target, def;
+            if (!getId(it.first.target, target))
+                return false;
+
+            for (RDNode *n : it.second) {
+                if (!getId(n, def))
+                    return false;
+
+                defs.emplace_back(target, *it.first.offset,
+                                  *it.first.len, def);
+            }
+        }
+
+        std::sort(defs.begin(), defs.end());
+        hashValue(hash, static_cast<uint32_t>(defs.size()));
+        for (const auto& def : defs) {
+            hashValue(hash, std::get<0>(def));
+            hashValue(hash, std::get<1>(def));
+            hashValue(hash, std::get<2>(def));
+            hashValue(hash, std::get<3>(def));
+        }
+
+        return true;
+    }
+
+public:
+    DataFlowHasher(const ModuleNumbering& n, LLVMReachingDefinitions *rd,
+                   LLVMPointerAnalysis *pta)
+        : nums(n), RD(rd), PTA(pta)
+    {
+        for (const LLVMRDBuilder::CallSite& cs : RD->getCallSites())
+            calls[cs.call] = &cs;
+
+        for (const auto& it : RD->getSubgraphs())
+            roots[it.second.root] = llvm::dyn_cast<llvm::Function>(it.first);
+    }
+
+    // store the hash of the function to @hash. Return false if the
+    // function has no reaching definitions or if some value
+    // cannot be identified
+    bool compute(const llvm::Function& F, uint64_t& hash)
+    {
+        const LLVMRDBuilder::Subgraph *subg = RD->getSubgraph(&F);
+        if (!subg)
+            return false;
+
+        hash = HASH_INIT;
+
+        // the points-to sets of the operands and the memory
+        // that the function may access
+        std::set<RDNode *> memory;
+        memory.insert(analysis::rd::UNKNOWN_MEMORY);
+        std::vector<std::pair<uint64_t, uint64_t>> pointers;
+        for (const llvm::BasicBlock& B : F) {
+            for (const llvm::Instruction& I : B) {
+                for (auto O = I.op_begin(), OE = I.op_end(); O != OE; ++O) {
+                    const llvm::Value *op = *O;
+                    if (!op->getType()->isPointerTy())
+                        continue;
+
+                    analysis::pta::PSNode *pts = PTA->getPointsTo(op);
+                    if (!pts) {
+                        hashValue(hash, 'n');
+                        continue;
+                    }
+
+                    pointers.clear();
+                    for (const analysis::pta::Pointer& ptr : pts->pointsTo) {
+                        uint64_t id;
+                        if (ptr.isNull())
+                            id = ID_NULL;
+                        else if (ptr.isUnknown())
+                            id = ID_UNKNOWN;
+                        else {
+                            const llvm::Value *val
+                                = ptr.target->getUserData<llvm::Value>();
+                            if (!val || !getId(val, id))
+                                return false;
+
+                            if (RDNode *target = RD->getNode(val))
+                                memory.insert(target);
+                        }
+
+                        pointers.emplace_back(id, *ptr.offset);
+                    }
+
+                    std::sort(pointers.begin(), pointers.end());
+                    hashValue(hash, 'p');
+                    hashValue(hash, static_cast<uint32_t>(pointers.size()));
+                    for (const auto& ptr : pointers) {
+                        hashValue(hash, ptr.first);
+                        hashValue(hash, ptr.second);
+                    }
+                }
+            }
+        }
+
+        if (!hashMap(subg->root->getReachingDefinitions(), memory, hash))
+            return false;
+
+        // find the called functions, the calls are not followed
+        // into the callees, but to the return nodes
+        std::map<std::string, RDNode *> callees;
+        std::vector<RDNode *> stack;
+        std::set<RDNode *> visited;
+        stack.push_back(subg->root);
+        visited.insert(subg->root);
+        while (!stack.empty()) {
+            RDNode *n = stack.back();
+            stack.pop_back();
+
+            if (n == subg->ret)
+                continue;
+
+            auto cit = calls.find(n);
+            if (cit != calls.end()) {
+                auto rit = roots.find(cit->second->callee);
+                if (rit == roots.end() || !rit->second
+                    || rit->second->getName().empty())
+                    return false;
+
+                callees[rit->second->getName().str()]
+                    = RD->getSubgraph(rit->second)->ret;
+                if (visited.insert(cit->second->ret).second)
+                    stack.push_back(cit->second->ret);
+                continue;
+            }
+
+            for (RDNode *succ : n->getSuccessors()) {
+                if (visited.insert(succ).second)
+                    stack.push_back(succ);
+            }
+        }
+
+        hashValue(hash, static_cast<uint32_t>(callees.size()));
+        for (const auto& it : callees) {
+            hashString(hash, it.first);
+            if (!hashMap(it.second->getReachingDefinitions(), memory, hash))
+                return false;
+        }
+
+        // the nodes that may define the memory
+        std::vector<std::pair<uint64_t, RDNode *>> targets;
+        for (RDNode *target : memory) {
+            uint64_t id;
+            if (!getId(target, id))
+                return false;
+
+            targets.emplace_back(id, target);
+        }
+
+        std::sort(targets.begin(), targets.end());
+        std::vector<uint64_t> defs;
+        for (const auto& target : targets) {
+            defs.clear();
+            if (const std::vector<RDNode *> *nodes
+                    = RD->getDefinitions(target.second)) {
+                for (RDNode *n : *nodes) {
+                    uint64_t id;
+                    if (!getId(n, id))
+                        return false;
+
+                    defs.push_back(id);
+                }
+            }
+
+            std::sort(defs.begin(), defs.end());
+            hashValue(hash, target.first);
+            hashValue(hash, static_cast<uint32_t>(defs.size()));
+            for (uint64_t id : defs)
+                hashValue(hash, id);
+        }
+
+        return true;
+    }
+};
+
+template <typename T>
+static void write(std::ostream& os, const T& val)
+{
+    os.write(reinterpret_cast<const char *>(&val), sizeof(T));
+}
+
+template <typename T>
+static bool read(std::istream& is, T& val)
+{
+    is.read(reinterpret_cast<char *>(&val), sizeof(T));
+    return static_cast<bool>(is);
+}
+
+static void write(std::ostream& os, const ValueId& id)
+{
+    write(os, id.kind);
+    write(os, id.x);
+    write(os, id.y);
+}
+
+static bool read(std::istream& is, ValueId& id)
+{
+    return read(is, id.kind) && read(is, id.x) && read(is, id.y);
+}
+
+static void write(std::ostream& os, const NodeId& id)
+{
+    write(os, id.kind);
+    write(os, id.owner);
+    write(os, id.value);
+}
+
+static bool read(std::istream& is, NodeId& id)
+{
+    return read(is, id.kind) && read(is, id.owner) && read(is, id.value);
+}
+
+static void write(std::ostream& os, const std::string& str)
+{
+    write(os, static_cast<uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+static bool read(std::istream& is, std::string& str)
+{
+    uint32_t size;
+    if (!read(is, size))
+        return false;
+
+    str.resize(size);
+    is.read(&str[0], size);
+    return static_cast<bool>(is);
+}
+
+// write the vectors of numbers, each prefixed with its size
+static void writeLists(std::ostream& os,
+                       const std::vector<std::vector<uint32_t>>& lists)
+{
+    for (const auto& l : lists) {
+        write(os, static_cast<uint32_t>(l.size()));
+        for (uint32_t i : l)
+            write(os, i);
+    }
+}
+
+// read @num lists of numbers that are less than @bound
+static bool readLists(std::istream& is, uint32_t num, uint32_t bound,
+                      std::vector<std::vector<uint32_t>>& lists)
+{
+    lists.resize(num);
+    for (auto& l : lists) {
+        uint32_t size;
+        if (!read(is, size) || size > bound)
+            return false;
+
+        l.resize(size);
+        for (uint32_t& i : l) {
+            if (!read(is, i) || i >= bound)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+struct FunctionInfo {
+    std::string name;
+    uint64_t hash;
+    // did we have the graph of the function?
+    uint8_t built;
+    // the hash of the inputs of the def-use edges (see DataFlowHasher),
+    // valid only if we had it
+    uint8_t flowed;
+    uint64_t flow;
+};
+
+// the contents of the file
+struct CacheContents {
+    uint64_t hash;
+    std::string config;
+    std::vector<FunctionInfo> functions;
+    uint64_t globals;
+    uint32_t entry;
+    // the call-sites with the numbers of the called functions
+    std::vector<std::pair<ValueId, std::vector<uint32_t>>> calls;
+    std::vector<NodeId> nodes;
+    std::vector<std::vector<uint32_t>> controlDeps;
+    std::vector<std::vector<uint32_t>> dataDeps;
+    std::vector<ValueId> blocks;
+    std::vector<std::vector<uint32_t>> blockDeps;
+};
+
+// read the beginning of the file (up to the configuration)
+static bool readHeader(std::istream& is, CacheContents& C)
+{
+    uint32_t magic, version;
+    return read(is, magic) && magic == CACHE_MAGIC
+            && read(is, version) && version == CACHE_VERSION
+            && read(is, C.hash) && read(is, C.config);
+}
+
+// read the rest of the file and check that the numbers are in bounds
+static bool readContents(std::istream& is, CacheContents& C)
+{
+    uint32_t num;
+    if (!read(is, num))
+        return false;
+
+    C.functions.resize(num);
+    for (FunctionInfo& FI : C.functions) {
+        if (!read(is, FI.name) || !read(is, FI.hash) || !read(is, FI.built)
+            || !read(is, FI.flowed) || !read(is, FI.flow))
+            return false;
+    }
+
+    if (!read(is, C.globals)
+        || !read(is, C.entry) || C.entry >= C.functions.size()
+        || !read(is, num))
+        return false;
+
+    C.calls.resize(num);
+    for (auto& call : C.calls) {
+        uint32_t size;
+        if (!read(is, call.first) || !read(is, size)
+            || size > C.functions.size())
+            return false;
+
+        call.second.resize(size);
+        for (uint32_t& fidx : call.second) {
+            if (!read(is, fidx) || fidx >= C.functions.size())
+                return false;
+        }
+    }
+
+    if (!read(is, num))
+        return false;
+
+    C.nodes.resize(num);
+    for (NodeId& id : C.nodes) {
+        if (!read(is, id))
+            return false;
+    }
+
+    if (!readLists(is, num, num, C.controlDeps)
+        || !readLists(is, num, num, C.dataDeps)
+        || !read(is, num))
+        return false;
+
+    C.blocks.resize(num);
+    for (ValueId& id : C.blocks) {
+        if (!read(is, id))
+            return false;
+    }
+
+    return readLists(is, num, num, C.blockDeps);
+}
+
+// if the node belongs to a function (it is a local node, the entry
+// or the exit), store the number of the function to @fidx
+static bool getFunction(const NodeId& id, uint32_t& fidx)
+{
+    switch (id.kind) {
+        case NODE_LOCAL:
+            fidx = id.owner.x;
+            return true;
+        case NODE_ENTRY:
+        case NODE_EXIT:
+            fidx = id.value.x;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// change the number of the function in the id of the node
+// (that belongs to the function)
+static NodeId moveToFunction(NodeId id, uint32_t fidx)
+{
+    if (id.kind == NODE_LOCAL)
+        id.owner.x = fidx;
+    id.value.x = fidx;
+    return id;
+}
+
+static bool isParameter(const NodeId& id)
+{
+    return id.kind == NODE_FORMAL_IN || id.kind == NODE_FORMAL_OUT
+            || id.kind == NODE_ACTUAL_IN || id.kind == NODE_ACTUAL_OUT;
+}
+
+template <typename FuncT>
+static bool forEachParameter(LLVMDGParameters *params, const ValueId& owner,
+                             bool formal, const ModuleNumbering& nums,
+                             FuncT& fn)
+{
+    if (!params)
+        return true;
+
+    uint8_t in = formal ? NODE_FORMAL_IN : NODE_ACTUAL_IN;
+    uint8_t out = formal ? NODE_FORMAL_OUT : NODE_ACTUAL_OUT;
+    ValueId id;
+
+    for (auto& it : *params) {
+        if (!nums.getId(it.first, id))
+            return false;
+
+        fn(NodeId(in, owner, id), it.second.in);
+        fn(NodeId(out, owner, id), it.second.out);
+    }
+
+    for (auto I = params->global_begin(), E = params->global_end();
+         I != E; ++I) {
+        if (!nums.getId(I->first, id))
+            return false;
+
+        fn(NodeId(in, owner, id), I->second.in);
+        fn(NodeId(out, owner, id), I->second.out);
+    }
+
+    if (DGParameter<LLVMNode> *va = params->getVarArg()) {
+        fn(NodeId(in, owner, ValueId(VAL_VARARG)), va->in);
+        fn(NodeId(out, owner, ValueId(VAL_VARARG)), va->out);
+    }
+
+    return true;
+}
+
+// call @fn for every node of the graphs built for the module.
+// Return false if some node cannot be identified
+template <typename FuncT>
+static bool forEachNode(LLVMDependenceGraph *dg, llvm::Module *M,
+                        const ModuleNumbering& nums, FuncT fn)
+{
+    ValueId id;
+    for (auto I = M->global_begin(), E = M->global_end(); I != E; ++I) {
+        LLVMNode *n = dg->getGlobalNode(&*I);
+        if (n && nums.getId(&*I, id))
+            fn(NodeId(NODE_GLOBAL, ValueId(), id), n);
+    }
+
+    const auto& CF = dg->getConstructedFunctions();
+    for (llvm::Function *F : nums.getFunctions()) {
+        auto it = CF.find(F);
+        if (it == CF.end())
+            continue;
+
+        LLVMDependenceGraph *graph = it->second;
+        ValueId fid;
+        nums.getId(F, fid);
+
+        fn(NodeId(NODE_ENTRY, ValueId(), fid), graph->getEntry());
+        if (graph->getExit())
+            fn(NodeId(NODE_EXIT, ValueId(), fid), graph->getExit());
+
+        if (!forEachParameter(graph->getParameters(), fid, true, nums, fn))
+            return false;
+
+        for (auto& nit : *graph) {
+            if (!nums.getId(nit.first, id))
+                return false;
+
+            fn(NodeId(NODE_LOCAL, fid, id), nit.second);
+            if (!forEachParameter(nit.second->getParameters(), id,
+                                  false, nums, fn))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// call @fn for every block of the graphs built for the module
+template <typename FuncT>
+static void forEachBlock(LLVMDependenceGraph *dg,
+                         const ModuleNumbering& nums, FuncT fn)
+{
+    const auto& CF = dg->getConstructedFunctions();
+    for (llvm::Function *F : nums.getFunctions()) {
+        auto it = CF.find(F);
+        if (it == CF.end())
+            continue;
+
+        LLVMDependenceGraph *graph = it->second;
+        ValueId id;
+        for (auto& bit : graph->getBlocks()) {
+            if (nums.getId(bit.first, id))
+                fn(id, bit.second);
+        }
+
+        // the unified exit block is not in the blocks
+        LLVMBBlock *exitBB = graph->getExitBB();
+        if (!exitBB)
+            continue;
+
+        auto bit = graph->getBlocks().find(exitBB->getKey());
+        if (bit == graph->getBlocks().end() || bit->second != exitBB) {
+            nums.getId(F, id);
+            fn(ValueId(VAL_EXIT_BLOCK, id.x), exitBB);
+        }
+    }
+}
+
+} // anonymous namespace
+
+uint64_t LLVMDGCache::getModuleHash()
+{
+    if (hashed)
+        return hash;
+
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    module->print(os, nullptr);
+    os.flush();
+
+    hash = HASH_INIT;
+    hashBytes(hash, str.data(), str.size());
+
+    hashed = true;
+    return hash;
+}
+
+bool LLVMDGCache::store(LLVMDependenceGraph *dg,
+                        LLVMReachingDefinitions *RD,
+                        LLVMPointerAnalysis *PTA)
+{
+    ModuleNumbering nums(module);
+
+    std::vector<NodeId> ids;
+    std::set<NodeId> seenIds;
+    std::vector<LLVMNode *> nodes;
+    std::unordered_map<LLVMNode *, uint32_t> indices;
+    bool unique = true;
+
+    bool ret = forEachNode(dg, module, nums,
+                           [&](const NodeId& id, LLVMNode *n) {
+        if (!seenIds.insert(id).second
+            || !indices.insert(std::make_pair(n, nodes.size())).second) {
+            unique = false;
+            return;
+        }
+
+        ids.push_back(id);
+        nodes.push_back(n);
+    });
+
+    if (!ret || !unique) {
+        errs() << "ERR: Cannot identify all the nodes of the graph\n";
+        return false;
+    }
+
+    auto getIndex = [&indices](LLVMNode *n, std::vector<uint32_t>& l) {
+        auto it = indices.find(n);
+        if (it == indices.end())
+            return false;
+
+        l.push_back(it->second);
+        return true;
+    };
+
+    std::vector<std::vector<uint32_t>> controlDeps(nodes.size());
+    std::vector<std::vector<uint32_t>> dataDeps(nodes.size());
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        LLVMNode *n = nodes[i];
+        for (auto I = n->control_begin(), E = n->control_end(); I != E; ++I) {
+            if (!getIndex(*I, controlDeps[i]))
+                ret = false;
+        }
+
+        for (auto I = n->data_begin(), E = n->data_end(); I != E; ++I) {
+            if (!getIndex(*I, dataDeps[i]))
+                ret = false;
+        }
+    }
+
+    if (!ret) {
+        errs() << "ERR: An edge goes to a node that is not in the graph\n";
+        return false;
+    }
+
+    std::vector<ValueId> blockIds;
+    std::unordered_map<LLVMBBlock *, uint32_t> blockIndices;
+    std::vector<LLVMBBlock *> blocks;
+    forEachBlock(dg, nums, [&](const ValueId& id, LLVMBBlock *B) {
+        blockIndices[B] = blocks.size();
+        blockIds.push_back(id);
+        blocks.push_back(B);
+    });
+
+    // the control dependencies on blocks that we do not know
+    // (e.g. the root of the post-dominator tree) are not needed
+    std::vector<std::vector<uint32_t>> blockDeps(blocks.size());
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        for (LLVMBBlock *B : blocks[i]->controlDependence()) {
+            auto it = blockIndices.find(B);
+            if (it != blockIndices.end())
+                blockDeps[i].push_back(it->second);
+        }
+    }
+
+    // the functions that the calls via pointers call,
+    // so that the graph can be built without points-to
+    std::vector<std::pair<ValueId, std::vector<uint32_t>>> calls;
+    const auto& CF = dg->getConstructedFunctions();
+    for (llvm::Function *F : nums.getFunctions()) {
+        auto it = CF.find(F);
+        if (it == CF.end())
+            continue;
+
+        for (llvm::BasicBlock& B : *F) {
+            for (llvm::Instruction& I : B) {
+                llvm::CallInst *CInst = llvm::dyn_cast<llvm::CallInst>(&I);
+                if (!CInst || llvm::isa<llvm::Function>(
+                        CInst->getCalledValue()->stripPointerCasts()))
+                    continue;
+
+                LLVMNode *n = it->second->getNode(CInst);
+                if (!n || n->getSubgraphs().empty())
+                    continue;
+
+                ValueId id;
+                nums.getId(CInst, id);
+                calls.push_back(std::make_pair(id, std::vector<uint32_t>()));
+                for (LLVMDependenceGraph *sub : n->getSubgraphs()) {
+                    ValueId fid;
+                    nums.getId(sub->getEntry()->getKey(), fid);
+                    calls.back().second.push_back(fid.x);
+                }
+
+                std::sort(calls.back().second.begin(),
+                          calls.back().second.end());
+            }
+        }
+    }
+
+    ValueId entry;
+    if (!nums.getId(dg->getEntry()->getKey(), entry)) {
+        errs() << "ERR: Unknown entry of the graph\n";
+        return false;
+    }
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        errs() << "ERR: Cannot open the file for writing: " << file << "\n";
+        return false;
+    }
+
+    write(out, CACHE_MAGIC);
+    write(out, CACHE_VERSION);
+    write(out, getModuleHash());
+    write(out, config);
+
+    // the functions, so that we can find the unchanged ones
+    // when the module changes (see loadControlDependencies()
+    // and loadDataDependencies())
+    std::unique_ptr<DataFlowHasher> flows;
+    if (RD && PTA && RD->getAlgorithm() == analysis::rd::EAGER)
+        flows.reset(new DataFlowHasher(nums, RD, PTA));
+
+    std::unordered_map<const llvm::Type *, std::string> types;
+    write(out, static_cast<uint32_t>(nums.getFunctions().size()));
+    for (llvm::Function *F : nums.getFunctions()) {
+        uint64_t flow = 0;
+        uint8_t flowed = CF.count(F) && flows && flows->compute(*F, flow);
+
+        write(out, F->getName().str());
+        write(out, hashFunction(*F, types));
+        write(out, static_cast<uint8_t>(CF.count(F)));
+        write(out, flowed);
+        write(out, flow);
+    }
+
+    write(out, hashGlobals(module));
+    write(out, entry.x);
+
+    write(out, static_cast<uint32_t>(calls.size()));
+    for (const auto& call : calls) {
+        write(out, call.first);
+        write(out, static_cast<uint32_t>(call.second.size()));
+        for (uint32_t fidx : call.second)
+            write(out, fidx);
+    }
+
+    write(out, static_cast<uint32_t>(ids.size()));
+    for (const NodeId& id : ids)
+        write(out, id);
+
+    writeLists(out, controlDeps);
+    writeLists(out, dataDeps);
+
+    write(out, static_cast<uint32_t>(blockIds.size()));
+    for (const ValueId& id : blockIds)
+        write(out, id);
+
+    writeLists(out, blockDeps);
+
+    out.close();
+    if (!out) {
+        errs() << "ERR: Failed writing the file: " << file << "\n";
+        std::remove(file.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// get the nodes and blocks of the built graph by their ids
+static void getBuiltGraph(LLVMDependenceGraph *dg, llvm::Module *M,
+                          const ModuleNumbering& nums,
+                          std::map<NodeId, LLVMNode *>& nodes,
+                          std::map<ValueId, LLVMBBlock *>& blocks)
+{
+    forEachNode(dg, M, nums, [&nodes](const NodeId& id, LLVMNode *n) {
+        nodes[id] = n;
+    });
+
+    forEachBlock(dg, nums, [&blocks](const ValueId& id, LLVMBBlock *B) {
+        blocks[id] = B;
+    });
+}
+
+bool LLVMDGCache::load(LLVMDependenceGraph *dg, unsigned threads)
+{
+    std::ifstream in(file, std::ios::binary);
+    CacheContents C;
+    if (!in || !readHeader(in, C)
+        || C.config != config || C.hash != getModuleHash())
+        return false;
+
+    // read everything before building the graph,
+    // so that we do not build it from a broken file
+    ModuleNumbering nums(module);
+    if (!readContents(in, C)
+        || C.functions.size() != nums.getFunctions().size())
+        return false;
+
+    CalledFunctionsMapT called;
+    for (const auto& call : C.calls) {
+        llvm::CallInst *CInst
+            = llvm::dyn_cast_or_null<llvm::CallInst>(nums.getValue(call.first));
+        if (!CInst)
+            return false;
+
+        std::vector<llvm::Function *>& funs = called[CInst];
+        for (uint32_t fidx : call.second)
+            funs.push_back(nums.getFunctions()[fidx]);
+    }
+
+    if (!dg->build(module, called, nums.getFunctions()[C.entry], threads))
+        return false;
+
+    // the hash matched, so we must have built the same graph
+    std::map<NodeId, LLVMNode *> built;
+    std::map<ValueId, LLVMBBlock *> builtBlocks;
+    getBuiltGraph(dg, module, nums, built, builtBlocks);
+
+    if (built.size() != C.nodes.size()
+        || builtBlocks.size() != C.blocks.size()) {
+        errs() << "ERR: The graph in the cache does not match the module\n";
+        abort();
+    }
+
+    std::vector<LLVMNode *> nodes;
+    nodes.reserve(C.nodes.size());
+    for (const NodeId& id : C.nodes) {
+        auto it = built.find(id);
+        if (it == built.end()) {
+            errs() << "ERR: The graph in the cache does not match the module\n";
+            abort();
+        }
+
+        nodes.push_back(it->second);
+    }
+
+    std::vector<LLVMBBlock *> blocks;
+    blocks.reserve(C.blocks.size());
+    for (const ValueId& id : C.blocks) {
+        auto it = builtBlocks.find(id);
+        if (it == builtBlocks.end()) {
+            errs() << "ERR: The graph in the cache does not match the module\n";
+            abort();
+        }
+
+        blocks.push_back(it->second);
+    }
+
+    // building the graph added some of the edges already,
+    // adding them again does nothing
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        for (uint32_t j : C.controlDeps[i])
+            nodes[i]->addControlDependence(nodes[j]);
+        for (uint32_t j : C.dataDeps[i])
+            nodes[i]->addDataDependence(nodes[j]);
+    }
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        for (uint32_t j : C.blockDeps[i])
+            blocks[i]->addControlDependence(blocks[j]);
+    }
+
+    return true;
+}
+
+bool LLVMDGCache::loadControlDependencies(LLVMDependenceGraph *dg,
+                                          std::set<llvm::Function *>& reused)
+{
+    std::ifstream in(file, std::ios::binary);
+    CacheContents C;
+    if (!in || !readHeader(in, C) || C.config != config
+        || !readContents(in, C))
+        return false;
+
+    ModuleNumbering nums(module);
+    std::unordered_map<std::string, uint32_t> byName;
+    for (uint32_t i = 0; i < nums.getFunctions().size(); ++i)
+        byName[nums.getFunctions()[i]->getName().str()] = i;
+
+    // the old numbers of the unchanged functions mapped to the new ones
+    const auto& CF = dg->getConstructedFunctions();
+    std::unordered_map<const llvm::Type *, std::string> types;
+    std::unordered_map<uint32_t, uint32_t> unchanged;
+    for (uint32_t i = 0; i < C.functions.size(); ++i) {
+        const FunctionInfo& FI = C.functions[i];
+        auto it = byName.find(FI.name);
+        if (!FI.built || FI.name.empty() || it == byName.end())
+            continue;
+
+        llvm::Function *F = nums.getFunctions()[it->second];
+        if (CF.count(F) == 0 || hashFunction(*F, types) != FI.hash)
+            continue;
+
+        unchanged[i] = it->second;
+        reused.insert(F);
+    }
+
+    std::map<NodeId, LLVMNode *> built;
+    std::map<ValueId, LLVMBBlock *> builtBlocks;
+    getBuiltGraph(dg, module, nums, built, builtBlocks);
+
+    // the nodes of the unchanged functions in the built graph
+    std::vector<LLVMNode *> nodes(C.nodes.size(), nullptr);
+    std::vector<uint32_t> nodeFunctions(C.nodes.size());
+    for (size_t i = 0; i < C.nodes.size(); ++i) {
+        uint32_t fidx;
+        if (!getFunction(C.nodes[i], fidx))
+            continue;
+
+        auto fit = unchanged.find(fidx);
+        if (fit == unchanged.end())
+            continue;
+
+        auto it = built.find(moveToFunction(C.nodes[i], fit->second));
+        if (it != built.end()) {
+            nodes[i] = it->second;
+            nodeFunctions[i] = fidx;
+        }
+    }
+
+    std::vector<LLVMBBlock *> blocks(C.blocks.size(), nullptr);
+    std::vector<uint32_t> blockFunctions(C.blocks.size());
+    for (size_t i = 0; i < C.blocks.size(); ++i) {
+        auto fit = unchanged.find(C.blocks[i].x);
+        if (fit == unchanged.end())
+            continue;
+
+        ValueId id = C.blocks[i];
+        id.x = fit->second;
+        auto it = builtBlocks.find(id);
+        if (it != builtBlocks.end()) {
+            blocks[i] = it->second;
+            blockFunctions[i] = C.blocks[i].x;
+        }
+    }
+
+    // the control dependencies do not cross the functions
+    // (the edges from the call-sites are added when building)
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (!nodes[i])
+            continue;
+
+        for (uint32_t j : C.controlDeps[i]) {
+            if (nodes[j] && nodeFunctions[j] == nodeFunctions[i])
+                nodes[i]->addControlDependence(nodes[j]);
+        }
+    }
+
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (!blocks[i])
+            continue;
+
+        for (uint32_t j : C.blockDeps[i]) {
+            if (blocks[j] && blockFunctions[j] == blockFunctions[i])
+                blocks[i]->addControlDependence(blocks[j]);
+        }
+    }
+
+    return true;
+}
+
+bool LLVMDGCache::loadDataDependencies(LLVMDependenceGraph *dg,
+                                       LLVMReachingDefinitions *RD,
+                                       LLVMPointerAnalysis *PTA,
+                                       std::set<llvm::Function *>& reused)
+{
+    // we hash the maps of the eager analysis
+    if (RD->getAlgorithm() != analysis::rd::EAGER)
+        return false;
+
+    std::ifstream in(file, std::ios::binary);
+    CacheContents C;
+    if (!in || !readHeader(in, C) || C.config != config
+        || !readContents(in, C) || C.globals != hashGlobals(module))
+        return false;
+
+    ModuleNumbering nums(module);
+    std::unordered_map<std::string, uint32_t> byName;
+    for (uint32_t i = 0; i < nums.getFunctions().size(); ++i)
+        byName[nums.getFunctions()[i]->getName().str()] = i;
+
+    // the old numbers of the functions mapped to the new ones
+    // and the (old numbers of) functions whose edges we can take
+    const auto& CF = dg->getConstructedFunctions();
+    DataFlowHasher flows(nums, RD, PTA);
+    std::unordered_map<const llvm::Type *, std::string> types;
+    std::unordered_map<uint32_t, uint32_t> numbers;
+    std::set<uint32_t> unchanged;
+    for (uint32_t i = 0; i < C.functions.size(); ++i) {
+        const FunctionInfo& FI = C.functions[i];
+        auto it = byName.find(FI.name);
+        if (FI.name.empty() || it == byName.end())
+            continue;
+
+        numbers[i] = it->second;
+
+        llvm::Function *F = nums.getFunctions()[it->second];
+        uint64_t flow;
+        if (FI.built && FI.flowed && CF.count(F)
+            && hashFunction(*F, types) == FI.hash
+            && flows.compute(*F, flow) && flow == FI.flow)
+            unchanged.insert(i);
+    }
+
+    // the values of a function are identified by their numbers
+    // in the function of the same name. In the other (changed)
+    // functions, the edges go only from the exit nodes and from
+    // the definitions, which the hash identifies the same way
+    auto translate = [&numbers](ValueId& id) {
+        switch (id.kind) {
+            case VAL_FUNCTION:
+            case VAL_ARGUMENT:
+            case VAL_BLOCK:
+            case VAL_INSTRUCTION:
+            case VAL_EXIT_BLOCK: {
+                auto it = numbers.find(id.x);
+                if (it == numbers.end())
+                    return false;
+
+                id.x = it->second;
+                return true;
+            }
+            default:
+                return true;
+        }
+    };
+
+    std::map<NodeId, LLVMNode *> built;
+    std::map<ValueId, LLVMBBlock *> builtBlocks;
+    getBuiltGraph(dg, module, nums, built, builtBlocks);
+
+    auto getNode = [&](NodeId id) -> LLVMNode * {
+        if (!translate(id.owner) || !translate(id.value))
+            return nullptr;
+
+        auto it = built.find(id);
+        return it == built.end() ? nullptr : it->second;
+    };
+
+    // the edges that go to the nodes of the unchanged functions.
+    // The edges from the parameters are added when building the graph
+    std::map<uint32_t, std::vector<std::pair<LLVMNode *, LLVMNode *>>> edges;
+    std::set<uint32_t> missing;
+    for (size_t i = 0; i < C.nodes.size(); ++i) {
+        if (isParameter(C.nodes[i]))
+            continue;
+
+        LLVMNode *from = nullptr;
+        bool found = false;
+        for (uint32_t j : C.dataDeps[i]) {
+            uint32_t fidx;
+            if (!getFunction(C.nodes[j], fidx) || unchanged.count(fidx) == 0)
+                continue;
+
+            if (!found) {
+                from = getNode(C.nodes[i]);
+                found = true;
+            }
+
+            LLVMNode *to = getNode(C.nodes[j]);
+            if (!from || !to)
+                missing.insert(fidx);
+            else
+                edges[fidx].emplace_back(from, to);
+        }
+    }
+
+    for (uint32_t fidx : unchanged) {
+        if (missing.count(fidx) > 0)
+            continue;
+
+        for (const auto& edge : edges[fidx])
+            edge.first->addDataDependence(edge.second);
+
+        reused.insert(nums.getFunctions()[numbers[fidx]]);
+    }
+
+    return true;
+}
+
+} // namespace dg
@@ -0,0 +1,101 @@
+#ifndef _LLVM_DG_CACHE_H_
+#define _LLVM_DG_CACHE_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+
+#include "LLVMDependenceGraph.h"
+
+namespace llvm {
+    class Module;
+    class Function;
+}
+
+namespace dg {
+
+class LLVMPointerAnalysis;
+
+namespace analysis {
+namespace rd {
+class LLVMReachingDefinitions;
+}
+}
+
+// Store the dependence graph of a module (with all the computed edges)
+// to a file and build it again from the file later, so that we do not
+// need to run the analyses again when slicing the same module.
+//
+// The file keeps the functions that are called via pointers, so that
+// the graphs are built again without the points-to analysis, and then
+// the control and data dependencies between the nodes and the control
+// dependencies between the blocks. The nodes are identified by the
+// numbers of the functions and the instructions in the module (or of
+// the globals and the arguments), so they do not depend on addresses.
+// The post-dominators and the control expressions are not kept.
+//
+// The file is valid only for the module it was stored for (it keeps
+// a hash of the module) and for the same configuration of the analyses,
+// which is an arbitrary string given by the user.
+//
+// When only some functions of the module change, the control
+// dependencies of the other functions can be still taken from the
+// file. The file keeps a hash of every function for that, the hash
+// does not depend on the rest of the module.
+//
+// The def-use edges of a function are taken from the file too when
+// the function did not change and neither did what the edges are
+// computed from: the points-to sets of its operands and the definitions
+// that its entry gets from the callers and its calls from the callees
+// (the file keeps a hash of these for every function). The points-to
+// analysis and the reaching definitions still run on the whole module
+// to find this out, only the def-use edges are not computed again.
+class LLVMDGCache {
+    llvm::Module *module;
+    std::string file;
+    std::string config;
+    uint64_t hash;
+    bool hashed;
+
+    uint64_t getModuleHash();
+public:
+    LLVMDGCache(llvm::Module *M, const std::string& f,
+                const std::string& conf = "")
+        : module(M), file(f), config(conf), hash(0), hashed(false) {}
+
+    // store the built graph with its edges to the file. With the points-to
+    // analysis and the (eager) reaching definitions that the def-use
+    // edges were computed from, store also what is needed to reuse
+    // the def-use edges of the functions (see loadDataDependencies())
+    bool store(LLVMDependenceGraph *dg,
+               analysis::rd::LLVMReachingDefinitions *RD = nullptr,
+               LLVMPointerAnalysis *PTA = nullptr);
+
+    // build the graph @dg for the module and add the stored edges.
+    // Return false if the file does not exist or it is not valid for
+    // the module and the configuration, @dg is not touched then
+    bool load(LLVMDependenceGraph *dg, unsigned threads = 0);
+
+    // add to the built graph @dg the control dependencies of the
+    // functions that did not change since the file was stored
+    // (the module may have changed). The functions whose control
+    // dependencies were added are stored to @reused.
+    // Return false if the file cannot be used at all
+    bool loadControlDependencies(LLVMDependenceGraph *dg,
+                                 std::set<llvm::Function *>& reused);
+
+    // add to the built graph @dg the def-use edges of the functions
+    // that did not change and whose points-to sets and incoming
+    // definitions (computed by @PTA and @RD for the module) are the same
+    // as when the file was stored. The functions whose def-use edges
+    // were added are stored to @reused, the def-use analysis must run
+    // on the rest. Return false if the file cannot be used at all
+    bool loadDataDependencies(LLVMDependenceGraph *dg,
+                              analysis::rd::LLVMReachingDefinitions *RD,
+                              LLVMPointerAnalysis *PTA,
+                              std::set<llvm::Function *>& reused);
+};
+
+} // namespace dg
+
+#endif // _LLVM_DG_CACHE_H_
@@ -6,9 +6,11 @@
  #error "Need CFG enabled for building LLVM Dependence Graph"
 #endif
 
+#include <chrono>
 #include <utility>
 #include <unordered_map>
 #include <set>
+#include <mutex>
 
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
@@ -40,6 +42,7 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include "ADT/ThreadPool.h"
 #include "LLVMDGVerifier.h"
 #include "LLVMDependenceGraph.h"
 #include "LLVMNode.h"
@@ -57,19 +60,6 @@ namespace dg {
 //  -- LLVMDependenceGraph
 /// ------------------------------------------------------------------
 
-// map of all constructed functions
-std::map<llvm::Value *, LLVMDependenceGraph *> constructedFunctions;
-
-const std::map<llvm::Value *,
-               LLVMDependenceGraph *>& getConstructedFunctions()
-{
-    return constructedFunctions;
-}
-
-void clearConstructedFunctions() {
-    constructedFunctions.clear();
-}
-
 LLVMDependenceGraph::~LLVMDependenceGraph()
 {
     // delete nodes
@@ -144,6 +134,8 @@ bool LLVMDependenceGraph::build(llvm::Module *m, llvm::Function *entry)
     }
 
     module = m;
+    if (!context)
+        context = std::make_shared<LLVMDGContext>();
 
     // add global nodes. These will be shared across subgraphs
     addGlobals(m, this);
@@ -151,6 +143,9 @@ bool LLVMDependenceGraph::build(llvm::Module *m, llvm::Function *entry)
     // build recursively DG from entry point
     build(entry);
 
+    if (gather_callsites)
+        getCallSites(gather_callsites, gatheredCallsites);
+
     return true;
 };
 
@@ -232,16 +227,27 @@ void LLVMDependenceGraph::addSubgraphGlobalParameters(LLVMDependenceGraph *subgr
     }
 }
 
+void LLVMDependenceGraph::updateCallers()
+{
+    // a recursive call may have been connected to this graph
+    // before we built the rest of it, so give the call-sites
+    // the formal parameters that we added since then.
+    // When building in parallel, the graph has no callers yet
+    // and the call-sites get all the parameters in connectSubgraph()
+    for (LLVMNode *callsite : getCallers()) {
+        callsite->getDG()->addSubgraphGlobalParameters(this);
+        callsite->addActualParameters(this);
+    }
+}
+
 LLVMDependenceGraph *
 LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
 {
     using namespace llvm;
 
-    LLVMBBlock *BB;
-
     // if we don't have this subgraph constructed, construct it
     // else just add call edge
-    LLVMDependenceGraph *&subgraph = constructedFunctions[callFunc];
+    LLVMDependenceGraph *&subgraph = context->constructedFunctions[callFunc];
     if (!subgraph) {
         // since we have reference the the pointer in
         // constructedFunctions, we can assing to it
@@ -251,8 +257,7 @@ LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
         subgraph->setGlobalNodes(getGlobalNodes());
         subgraph->module = module;
         subgraph->PTA = PTA;
-        // make subgraphs gather the call-sites too
-        subgraph->gatherCallsites(gather_callsites, gatheredCallsites);
+        subgraph->context = context;
 
         // make the real work
         bool ret = subgraph->build(callFunc);
@@ -269,7 +274,15 @@ LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
         subgraph->unref(false /* deleteOnZero */);
     }
 
-    BB = node->getBBlock();
+    connectSubgraph(node, subgraph, callFunc);
+    return subgraph;
+}
+
+void LLVMDependenceGraph::connectSubgraph(LLVMNode *node,
+                                          LLVMDependenceGraph *subgraph,
+                                          llvm::Function *callFunc)
+{
+    LLVMBBlock *BB = node->getBBlock();
     assert(BB && "do not have BB; this is a bug, sir");
     BB->addCallsite(node);
 
@@ -282,8 +295,6 @@ LLVMDependenceGraph::buildSubgraph(LLVMNode *node, llvm::Function *callFunc)
     // pointer call
     addSubgraphGlobalParameters(subgraph);
     node->addActualParameters(subgraph, callFunc);
-
-    return subgraph;
 }
 
 static bool
@@ -335,60 +346,98 @@ static bool isMemAllocationFunc(const llvm::Function *func)
     return false;
 }
 
+// get the defined functions that may be called by the call-site
+static std::vector<llvm::Function *>
+getCalledFunctions(llvm::CallInst *CInst, LLVMPointerAnalysis *PTA,
+                   const LLVMDGContext *context)
+{
+    using namespace llvm;
+
+    std::vector<Function *> ret;
+    Value *strippedValue = CInst->getCalledValue()->stripPointerCasts();
+    Function *func = dyn_cast<Function>(strippedValue);
+    // if func is nullptr, then this is indirect call
+    // via function pointer. If we have the points-to information,
+    // create the subgraph
+    if (!func && context && context->calledFunctions) {
+        // we were given the called functions
+        auto it = context->calledFunctions->find(CInst);
+        if (it != context->calledFunctions->end())
+            ret = it->second;
+    } else if (!func && !CInst->isInlineAsm() && PTA) {
+        using namespace analysis::pta;
+        PSNode *op = PTA->getNode(strippedValue);
+        if (op) {
+            for (const Pointer& ptr : op->pointsTo) {
+                if (!ptr.isValid())
+                    continue;
+
+                // vararg may introduce imprecision here, so we
+                // must check that it is really pointer to a function
+                if (!isa<Function>(ptr.target->getUserData<Value>()))
+                    continue;
+
+                Function *F = ptr.target->getUserData<Function>();
+                if (F->size() == 0 || !llvmutils::callIsCompatible(F, CInst))
+                    // incompatible prototypes or the function
+                    // is only declaration
+                    continue;
+
+                ret.push_back(F);
+            }
+        } else
+            llvmutils::printerr("Had no PTA node", strippedValue);
+    }
+
+    if (is_func_defined(func))
+        ret.push_back(func);
+
+    return ret;
+}
+
+void LLVMDependenceGraph::addCallee(LLVMNode *node, llvm::Function *F)
+{
+    if (defer_calls) {
+        deferred_calls.push_back(std::make_pair(node, F));
+        return;
+    }
+
+    LLVMDependenceGraph *subg = buildSubgraph(node, F);
+    node->addSubgraph(subg);
+}
+
 void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
                                             LLVMNode *node)
 {
     using namespace llvm;
 
     if (CallInst *CInst = dyn_cast<CallInst>(val)) {
-        Value *strippedValue = CInst->getCalledValue()->stripPointerCasts();
-        Function *func = dyn_cast<Function>(strippedValue);
-        // if func is nullptr, then this is indirect call
-        // via function pointer. If we have the points-to information,
-        // create the subgraph
-        if (!func && !CInst->isInlineAsm() && PTA) {
-            using namespace analysis::pta;
-            PSNode *op = PTA->getNode(strippedValue);
-            if (op) {
-                for (const Pointer& ptr : op->pointsTo) {
-                    if (!ptr.isValid())
-                        continue;
-
-                    // vararg may introduce imprecision here, so we
-                    // must check that it is really pointer to a function
-                    if (!isa<Function>(ptr.target->getUserData<Value>()))
-                        continue;
-
-                    Function *F = ptr.target->getUserData<Function>();
-                    if (F->size() == 0 || !llvmutils::callIsCompatible(F, CInst))
-                        // incompatible prototypes or the function
-                        // is only declaration
-                        continue;
-
-                    LLVMDependenceGraph *subg = buildSubgraph(node, F);
-                    node->addSubgraph(subg);
-                }
-            } else
-                llvmutils::printerr("Had no PTA node", strippedValue);
-        }
-
-        if (func && gather_callsites &&
-            strcmp(func->getName().data(), gather_callsites) == 0) {
-            gatheredCallsites->insert(node);
+        Function *func
+            = dyn_cast<Function>(CInst->getCalledValue()->stripPointerCasts());
+
+        std::vector<Function *> called
+            = getCalledFunctions(CInst, PTA, context.get());
+        {
+            // the undefined functions do not get a subgraph,
+            // but we want their call-sites too
+            std::lock_guard<std::mutex> guard(context->lock);
+            if (func && !is_func_defined(func))
+                context->callSites[func].insert(node);
+            for (Function *F : called)
+                context->callSites[F].insert(node);
         }
 
-        if (is_func_defined(func)) {
-            LLVMDependenceGraph *subg = buildSubgraph(node, func);
-            node->addSubgraph(subg);
-        }
+        for (Function *F : called)
+            addCallee(node, F);
 
         // if we allocate a memory in a function, we can pass
         // it to other functions, so it is like global.
         // We need it as parameter, so that if we define it,
         // we can add def-use edges from parent, through the parameter
         // to the definition
-        if (isMemAllocationFunc(CInst->getCalledFunction()))
-                addFormalParameter(val);
+        if (isMemAllocationFunc(CInst->getCalledFunction())
+            && addFormalParameter(val))
+            updateCallers();
 
         // no matter what is the function, this is a CallInst,
         // so create call-graph
@@ -396,16 +445,16 @@ void LLVMDependenceGraph::handleInstruction(llvm::Value *val,
     } else if (Instruction *Inst = dyn_cast<Instruction>(val)) {
         if (isa<LoadInst>(val) || isa<GetElementPtrInst>(val)) {
             Value *op = Inst->getOperand(0)->stripInBoundsOffsets();
-             if (isa<GlobalVariable>(op))
-                 addFormalGlobal(op);
+             if (isa<GlobalVariable>(op) && addFormalGlobal(op))
+                 updateCallers();
         } else if (isa<StoreInst>(val)) {
             Value *op = Inst->getOperand(0)->stripInBoundsOffsets();
-            if (isa<GlobalVariable>(op))
-                addFormalGlobal(op);
+            if (isa<GlobalVariable>(op) && addFormalGlobal(op))
+                updateCallers();
 
             op = Inst->getOperand(1)->stripInBoundsOffsets();
-            if (isa<GlobalVariable>(op))
-                addFormalGlobal(op);
+            if (isa<GlobalVariable>(op) && addFormalGlobal(op))
+                updateCallers();
         }
     }
 }
@@ -446,8 +495,11 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
         LLVMNode *ext = getExit();
         if (!ext) {
             // we need new llvm value, so that the nodes won't collide
-            ReturnInst *phonyRet
-                = ReturnInst::Create(termval->getContext());
+            ReturnInst *phonyRet;
+            {
+                std::lock_guard<std::mutex> guard(context->lock);
+                phonyRet = ReturnInst::Create(termval->getContext());
+            }
             if (!phonyRet) {
                 errs() << "ERR: Failed creating phony return value "
                        << "for exit node\n";
@@ -482,10 +534,14 @@ LLVMBBlock *LLVMDependenceGraph::build(llvm::BasicBlock& llvmBB)
     return BB;
 }
 
-static LLVMBBlock *createSingleExitBB(LLVMDependenceGraph *graph)
+static LLVMBBlock *createSingleExitBB(LLVMDependenceGraph *graph,
+                                      std::mutex& lock)
 {
-    llvm::UnreachableInst *ui
-        = new llvm::UnreachableInst(graph->getModule()->getContext());
+    llvm::UnreachableInst *ui;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        ui = new llvm::UnreachableInst(graph->getModule()->getContext());
+    }
     LLVMNode *exit = new LLVMNode(ui, true);
     graph->addNode(exit);
     graph->setExit(exit);
@@ -560,11 +616,16 @@ bool LLVMDependenceGraph::build(llvm::Function *func)
     if (func->size() == 0)
         return false;
 
-    constructedFunctions.insert(make_pair(func, this));
+    if (!context)
+        context = std::make_shared<LLVMDGContext>();
 
     // create entry node
     LLVMNode *entry = new LLVMNode(func);
-    addGlobalNode(entry);
+    {
+        std::lock_guard<std::mutex> guard(context->lock);
+        context->constructedFunctions.insert(make_pair(func, this));
+        addGlobalNode(entry);
+    }
     // we want the entry node to have this DG set
     entry->setDG(this);
     setEntry(entry);
@@ -615,7 +676,8 @@ bool LLVMDependenceGraph::build(llvm::Function *func)
     // and point there
     if (!getExit()) {
         assert(!unifiedExitBB && "We should not have exit BB");
-        unifiedExitBB = std::unique_ptr<LLVMBBlock>(createSingleExitBB(this));
+        unifiedExitBB
+            = std::unique_ptr<LLVMBBlock>(createSingleExitBB(this, context->lock));
     }
 
     // check if we have everything
@@ -634,10 +696,129 @@ bool LLVMDependenceGraph::build(llvm::Function *func)
 
 bool LLVMDependenceGraph::build(llvm::Module *m,
                                 LLVMPointerAnalysis *pts,
-                                llvm::Function *entry)
+                                llvm::Function *entry,
+                                unsigned threads)
 {
     this->PTA = pts;
-    return build(m, entry);
+    if (threads <= 1)
+        return build(m, entry);
+
+    if (!entry)
+        entry = m->getFunction("main");
+
+    if (!entry) {
+        errs() << "No entry function found/given\n";
+        return false;
+    }
+
+    module = m;
+    if (!context)
+        context = std::make_shared<LLVMDGContext>();
+
+    addGlobals(m, this);
+
+    buildParallel(entry, threads);
+
+    if (gather_callsites)
+        getCallSites(gather_callsites, gatheredCallsites);
+
+    return true;
+}
+
+bool LLVMDependenceGraph::build(llvm::Module *m,
+                                const CalledFunctionsMapT& called,
+                                llvm::Function *entry,
+                                unsigned threads)
+{
+    if (!context)
+        context = std::make_shared<LLVMDGContext>();
+
+    context->calledFunctions.reset(new CalledFunctionsMapT(called));
+    return build(m, static_cast<LLVMPointerAnalysis *>(nullptr),
+                 entry, threads);
+}
+
+void LLVMDependenceGraph::buildParallel(llvm::Function *entry,
+                                        unsigned threads)
+{
+    using namespace llvm;
+
+    // find the functions reachable from the entry, the same way
+    // as the sequential building would do it
+    std::vector<Function *> functions;
+    std::set<Function *> reachable;
+    functions.push_back(entry);
+    reachable.insert(entry);
+
+    for (size_t i = 0; i < functions.size(); ++i) {
+        for (BasicBlock& B : *functions[i]) {
+            for (Instruction& I : B) {
+                CallInst *CInst = dyn_cast<CallInst>(&I);
+                if (!CInst)
+                    continue;
+
+                for (Function *F : getCalledFunctions(CInst, PTA, context.get())) {
+                    if (reachable.insert(F).second)
+                        functions.push_back(F);
+                }
+            }
+        }
+    }
+
+    // create the graphs first, so that every graph is in
+    // constructedFunctions before anybody is connected to it
+    std::vector<LLVMDependenceGraph *> graphs;
+    graphs.reserve(functions.size());
+    for (Function *F : functions) {
+        LLVMDependenceGraph *graph = this;
+        if (F != entry) {
+            graph = new LLVMDependenceGraph();
+            graph->setGlobalNodes(getGlobalNodes());
+            graph->module = module;
+            graph->PTA = PTA;
+            graph->context = context;
+            // the call-sites will hold the references,
+            // see buildSubgraph()
+            graph->unref(false /* deleteOnZero */);
+        }
+
+        graph->defer_calls = true;
+        context->constructedFunctions[F] = graph;
+        graphs.push_back(graph);
+    }
+
+    ADT::ThreadPool pool(threads);
+    pool.parallelFor(graphs.size(), [&graphs, &functions](size_t i) {
+        bool ret = graphs[i]->build(functions[i]);
+        assert(ret && "Building subgraph failed");
+        (void) ret;
+    });
+
+    // connect the call-sites in the order in which the sequential
+    // building would do it, so that the graphs are the same
+    std::set<LLVMDependenceGraph *> visited;
+    connectCallSites(visited);
+}
+
+void LLVMDependenceGraph::connectCallSites(std::set<LLVMDependenceGraph *>& visited)
+{
+    if (!visited.insert(this).second)
+        return;
+
+    for (auto& call : deferred_calls) {
+        LLVMDependenceGraph *subgraph
+            = context->constructedFunctions[call.second];
+        assert(subgraph && "Did not build a reachable function");
+
+        // the callee gets connected before it is connected
+        // to this call-site, the same as in buildSubgraph()
+        subgraph->connectCallSites(visited);
+        connectSubgraph(call.first, subgraph, call.second);
+        call.first->addSubgraph(subgraph);
+    }
+
+    deferred_calls.clear();
+    defer_calls = false;
 }
 
 void LLVMDependenceGraph::addFormalParameters()
@@ -675,8 +856,12 @@ void LLVMDependenceGraph::addFormalParameters()
     }
 
     if (func->isVarArg()) {
-        Value *val = ConstantPointerNull::get(func->getType());
-        val->setName("vararg");
+        Value *val;
+        {
+            std::lock_guard<std::mutex> guard(context->lock);
+            val = ConstantPointerNull::get(func->getType());
+            val->setName("vararg");
+        }
         in = new LLVMNode(val, true);
         out = new LLVMNode(val, true);
         in->setDG(this);
@@ -689,88 +874,36 @@ void LLVMDependenceGraph::addFormalParameters()
     }
 }
 
-static bool array_match(llvm::StringRef name, const char *names[])
+const std::set<LLVMNode *>&
+LLVMDependenceGraph::getCallSitesOf(const llvm::Function *F) const
 {
-    unsigned idx = 0;
-    while(names[idx]) {
-        if (name.equals(names[idx]))
-            return true;
-        ++idx;
-    }
+    static const std::set<LLVMNode *> empty;
 
-    return false;
-}
-
-static bool array_match(llvm::StringRef name, const std::vector<std::string>& names)
-{
-    for (const auto& nm : names) {
-        if (name == nm)
-            return true;
-    }
+    assert(context && "The graph has not been built");
+    auto it = context->callSites.find(F);
+    if (it == context->callSites.end())
+        return empty;
 
-    return false;
+    return it->second;
 }
 
-static bool match_callsite_name(LLVMNode *callNode, const char *names[])
+// add the call-sites of the function with the given name
+static void addCallSitesOf(const LLVMDependenceGraph *dg, llvm::Module *M,
+                           const char *name, std::set<LLVMNode *> *callsites)
 {
-    using namespace llvm;
-
-    // if the function is undefined, it has no subgraphs,
-    // but is not called via function pointer
-    if (!callNode->hasSubgraphs()) {
-        const CallInst *callInst = cast<CallInst>(callNode->getValue());
-        const Value *calledValue = callInst->getCalledValue();
-        const Function *func = dyn_cast<Function>(calledValue->stripPointerCasts());
-        // in the case we haven't run points-to analysis
-        if (!func)
-            return false;
-
-        return array_match(func->getName(), names);
-    } else {
-        // simply iterate over the subgraphs, get the entry node
-        // and check it
-        for (LLVMDependenceGraph *dg : callNode->getSubgraphs()) {
-            LLVMNode *entry = dg->getEntry();
-            assert(entry && "No entry node in graph");
-
-            const Function *func
-                = cast<Function>(entry->getValue()->stripPointerCasts());
-            return array_match(func->getName(), names);
-        }
+    if (const llvm::Function *F = M->getFunction(name)) {
+        const auto& cs = dg->getCallSitesOf(F);
+        callsites->insert(cs.begin(), cs.end());
     }
-
-    return false;
 }
 
-static bool match_callsite_name(LLVMNode *callNode, const std::vector<std::string>& names)
+llvm::Module *LLVMDependenceGraph::getEntryModule() const
 {
-    using namespace llvm;
-
-    // if the function is undefined, it has no subgraphs,
-    // but is not called via function pointer
-    if (!callNode->hasSubgraphs()) {
-        const CallInst *callInst = cast<CallInst>(callNode->getValue());
-        const Value *calledValue = callInst->getCalledValue();
-        const Function *func = dyn_cast<Function>(calledValue->stripPointerCasts());
-        // in the case we haven't run points-to analysis
-        if (!func)
-            return false;
-
-        return array_match(func->getName(), names);
-    } else {
-        // simply iterate over the subgraphs, get the entry node
-        // and check it
-        for (LLVMDependenceGraph *dg : callNode->getSubgraphs()) {
-            LLVMNode *entry = dg->getEntry();
-            assert(entry && "No entry node in graph");
-
-            const Function *func
-                = cast<Function>(entry->getValue()->stripPointerCasts());
-            return array_match(func->getName(), names);
-        }
-    }
+    if (module)
+        return module;
 
-    return false;
+    assert(getEntry() && "The graph has not been built");
+    return llvm::cast<llvm::Function>(getEntry()->getKey())->getParent();
 }
 
 bool LLVMDependenceGraph::getCallSites(const char *name, std::set<LLVMNode *> *callsites)
@@ -782,17 +915,9 @@ bool LLVMDependenceGraph::getCallSites(const char *name, std::set<LLVMNode *> *c
 bool LLVMDependenceGraph::getCallSites(const char *names[],
                                        std::set<LLVMNode *> *callsites)
 {
-    for (auto& F : constructedFunctions) {
-        for (auto& I : F.second->getBlocks()) {
-            LLVMBBlock *BB = I.second;
-            for (LLVMNode *n : BB->getNodes()) {
-                if (llvm::isa<llvm::CallInst>(n->getValue())) {
-                    if (match_callsite_name(n, names))
-                        callsites->insert(n);
-                }
-            }
-        }
-    }
+    llvm::Module *M = getEntryModule();
+    for (unsigned idx = 0; names[idx]; ++idx)
+        addCallSitesOf(this, M, names[idx], callsites);
 
     return callsites->size() != 0;
 }
@@ -800,57 +925,65 @@ bool LLVMDependenceGraph::getCallSites(const char *names[],
 bool LLVMDependenceGraph::getCallSites(const std::vector<std::string>& names,
                                        std::set<LLVMNode *> *callsites)
 {
-    for (const auto& F : constructedFunctions) {
-        for (const auto& I : F.second->getBlocks()) {
-            LLVMBBlock *BB = I.second;
-            for (LLVMNode *n : BB->getNodes()) {
-                if (llvm::isa<llvm::CallInst>(n->getValue())) {
-                    if (match_callsite_name(n, names))
-                        callsites->insert(n);
-                }
-            }
-        }
-    }
+    llvm::Module *M = getEntryModule();
+    for (const auto& nm : names)
+        addCallSitesOf(this, M, nm.c_str(), callsites);
 
     return callsites->size() != 0;
 }
 
-void LLVMDependenceGraph::computeControlExpression(bool addCDs)
+void LLVMDependenceGraph::computeControlExpression(bool addCDs,
+                                                   unsigned threads)
 {
+    std::vector<LLVMDependenceGraph *> graphs;
+    for (auto& F : getConstructedFunctions())
+        graphs.push_back(F.second);
+
+    // every function has its own expression
+    ADT::ThreadPool pool(threads);
+    pool.parallelFor(graphs.size(), [&graphs, addCDs](size_t i) {
+        graphs[i]->computeFunctionControlExpression(addCDs);
+    });
+}
+
+void LLVMDependenceGraph::computeFunctionControlExpression(bool addCDs)
+{
+    auto start = std::chrono::steady_clock::now();
     LLVMCFABuilder builder;
 
-    for (auto& F : getConstructedFunctions()) {
-        llvm::Function *func = llvm::cast<llvm::Function>(F.first);
-        LLVMCFA cfa = builder.build(*func);
-
-        CE = cfa.compute();
-
-        if (addCDs) {
-            // compute the control scope
-            CE.computeSets();
-            auto& our_blocks = F.second->getBlocks();
-
-            for (llvm::BasicBlock& B : *func) {
-                LLVMBBlock *B1 = our_blocks[&B];
-
-                // if this block is a predicate block,
-                // we compute the control deps for it
-                // XXX: for now we compute the control
-                // scope, which is enough for slicing,
-                // but may add some extra (transitive)
-                // edges
-                if (B.getTerminator()->getNumSuccessors() > 1) {
-                    auto CS = CE.getControlScope(&B);
-                    for (auto cs : CS) {
-                        assert(cs->isa(LABEL));
-                        auto lab = static_cast<CELabel<llvm::BasicBlock *> *>(cs);
-                        LLVMBBlock *B2 = our_blocks[lab->getLabel()];
-                        B1->addControlDependence(B2);
-                    }
+    llvm::Function *func = llvm::cast<llvm::Function>(getEntry()->getKey());
+    LLVMCFA cfa = builder.build(*func);
+
+    CE = cfa.compute();
+
+    if (addCDs) {
+        // compute the control scope
+        CE.computeSets();
+        auto& our_blocks = getBlocks();
+
+        for (llvm::BasicBlock& B : *func) {
+            LLVMBBlock *B1 = our_blocks[&B];
+
+            // if this block is a predicate block,
+            // we compute the control deps for it
+            // XXX: for now we compute the control
+            // scope, which is enough for slicing,
+            // but may add some extra (transitive)
+            // edges
+            if (B.getTerminator()->getNumSuccessors() > 1) {
+                auto CS = CE.getControlScope(&B);
+                for (auto cs : CS) {
+                    assert(cs->isa(LABEL));
+                    auto lab = static_cast<CELabel<llvm::BasicBlock *> *>(cs);
+                    LLVMBBlock *B2 = our_blocks[lab->getLabel()];
+                    B1->addControlDependence(B2);
                 }
             }
         }
     }
+
+    cdTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
 }
 
 // the original algorithm from Ferrante & Ottenstein
@@ -12,14 +12,20 @@
 #error "Need CFG enabled"
 #endif
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 // forward declaration of llvm classes
 namespace llvm {
     class Module;
     class Value;
     class Function;
+    class CallInst;
 } // namespace llvm
 
 #include "LLVMNode.h"
@@ -41,6 +47,32 @@ class LLVMPointerAnalysis;
 
 typedef dg::BBlock<LLVMNode> LLVMBBlock;
 
+class LLVMDependenceGraph;
+
+// the defined functions that may be called by a call via pointer
+typedef std::map<const llvm::CallInst *,
+                 std::vector<llvm::Function *>> CalledFunctionsMapT;
+
+// the state shared by all graphs that were built for one module.
+// Every graph holds a reference to it, so independent modules
+// can be analysed (even concurrently) in one process
+struct LLVMDGContext
+{
+    // map of all constructed functions
+    std::map<llvm::Value *, LLVMDependenceGraph *> constructedFunctions;
+    // the call-sites of every called function (also of the undefined
+    // functions and of the functions called via pointers).
+    // It is filled while building the graphs, so the call-sites
+    // that are sliced away later are not removed from it
+    std::unordered_map<const llvm::Function *,
+                       std::set<LLVMNode *>> callSites;
+    // guards the shared state when the graphs are built in parallel
+    std::mutex lock;
+    // the functions called via pointers, if the graphs are built
+    // without the points-to analysis (e.g. from a cache)
+    std::unique_ptr<CalledFunctionsMapT> calledFunctions;
+};
+
 /// ------------------------------------------------------------------
 //  -- LLVMDependenceGraph
 /// ------------------------------------------------------------------
@@ -50,7 +82,8 @@ class LLVMDependenceGraph : public DependenceGraph<LLVMNode>
     std::unique_ptr<LLVMBBlock> unifiedExitBB;
 public:
     LLVMDependenceGraph()
-        : gather_callsites(nullptr), module(nullptr), PTA(nullptr) {}
+        : gather_callsites(nullptr), module(nullptr), PTA(nullptr),
+          defer_calls(false), cdTime(0) {}
 
     // free all allocated memory and unref subgraphs
     ~LLVMDependenceGraph();
@@ -59,8 +92,15 @@ public:
     // build all subgraphs (called procedures). If entry is nullptr,
     // then this methods looks for function named 'main'.
     bool build(llvm::Module *m, llvm::Function *entry = nullptr);
+    // with more than one thread, we first find the functions reachable
+    // from the entry and build their graphs in parallel. The call-sites
+    // are connected to the graphs afterwards
     bool build(llvm::Module *m, LLVMPointerAnalysis *pts,
-               llvm::Function *entry = nullptr);
+               llvm::Function *entry = nullptr, unsigned threads = 0);
+    // the same as above, but the functions called via pointers
+    // are taken from @called instead of from the points-to analysis
+    bool build(llvm::Module *m, const CalledFunctionsMapT& called,
+               llvm::Function *entry = nullptr, unsigned threads = 0);
 
     // build DependenceGraph for a function. This will automatically
     // build subgraphs of called functions
@@ -71,21 +111,32 @@ public:
 
     llvm::Module *getModule() const { return module; }
 
+    // the graphs of all functions built together with this graph
+    const std::map<llvm::Value *,
+                   LLVMDependenceGraph *>& getConstructedFunctions() const
+    {
+        assert(context && "The graph has not been built");
+        return context->constructedFunctions;
+    }
+
     // if we want to slice according some call-site(s),
-    // we can gather the relevant call-sites while building
-    // graph and do not need to recursively find in the graph
-    // later. This can handle only direct-calls though. If the
-    // function is called via pointer, it won't be covered by this
-    // function
+    // we can have the relevant call-sites stored to @callSites
+    // once the graph of the module is built
+    // (see getCallSitesOf())
     void gatherCallsites(const char *name, std::set<LLVMNode *> *callSites)
     {
         gather_callsites = name;
         gatheredCallsites = callSites;
     }
 
-    // go through the graph and find all (possible) call-sites
-    // for a function
-    // FIXME: can implement via getCallNodes
+    // the call-sites of the function in all the graphs built together
+    // with this graph (including the calls via pointers).
+    // The call-sites are gathered while building the graphs, so ask
+    // before slicing, the sliced call-sites are still there
+    const std::set<LLVMNode *>& getCallSitesOf(const llvm::Function *F) const;
+
+    // find all (possible) call-sites for a function
+    // (using getCallSitesOf())
     bool getCallSites(const char *name, std::set<LLVMNode *> *callsites);
     // this method takes NULL-terminated array of names
     bool getCallSites(const char *names[], std::set<LLVMNode *> *callsites);
@@ -100,21 +151,52 @@ public:
     // build subgraph for a call node
     LLVMDependenceGraph *buildSubgraph(LLVMNode *node);
     LLVMDependenceGraph *buildSubgraph(LLVMNode *node, llvm::Function *);
+    // connect the call node to the (built) subgraph
+    void connectSubgraph(LLVMNode *node, LLVMDependenceGraph *subgraph,
+                         llvm::Function *F);
     void addSubgraphGlobalParameters(LLVMDependenceGraph *subgraph);
+    // add the formal parameters added while building
+    // this graph to the call-sites that are already connected
+    void updateCallers();
 
     void makeSelfLoopsControlDependent();
 
-    void computeControlDependencies(enum CD_ALG alg_type)
+    // the functions are computed with @threads threads
+    void computeControlDependencies(enum CD_ALG alg_type, unsigned threads = 0)
     {
         if (alg_type == CLASSIC) {
-            computePostDominators(true);
+            computePostDominators(true, threads);
             //makeSelfLoopsControlDependent();
         } else if (alg_type == CONTROL_EXPRESSION) {
-            computeControlExpression(true);
+            computeControlExpression(true, threads);
         } else
             abort();
     }
 
+    // compute the control dependencies only in the graph of this
+    // function, not in the graphs of the called functions
+    void computeFunctionControlDependencies(enum CD_ALG alg_type)
+    {
+        if (alg_type == CLASSIC)
+            computeFunctionPostDominators(true);
+        else if (alg_type == CONTROL_EXPRESSION)
+            computeFunctionControlExpression(true);
+        else
+            abort();
+    }
+
+    // the time spent computing the control dependencies
+    // of this function (in microseconds)
+    uint64_t getControlDependenciesTime() const { return cdTime; }
+
+    // freeze the graphs of all constructed functions
+    // (see DependenceGraph::freeze())
+    void freeze()
+    {
+        for (auto& F : getConstructedFunctions())
+            F.second->DependenceGraph<LLVMNode>::freeze();
+    }
+
     bool verify() const;
 
     /* virtual */
@@ -132,8 +214,14 @@ public:
     LLVMPointerAnalysis *getPTA() const { return PTA; }
 
 private:
-    void computePostDominators(bool addPostDomFrontiers = false);
-    void computeControlExpression(bool addCDs = false);
+    // the module of the graph (also if we built only a function)
+    llvm::Module *getEntryModule() const;
+
+    void computePostDominators(bool addPostDomFrontiers = false,
+                               unsigned threads = 0);
+    void computeControlExpression(bool addCDs = false, unsigned threads = 0);
+    void computeFunctionPostDominators(bool addPostDomFrontiers = false);
+    void computeFunctionControlExpression(bool addCDs = false);
 
     // add formal parameters of the function to the graph
     // (graph is a graph of one procedure)
@@ -144,6 +232,15 @@ private:
     // then build subgraph or similar
     void handleInstruction(llvm::Value *val, LLVMNode *node);
 
+    // build the subgraph of the called function (or remember
+    // the call if we build the graphs in parallel)
+    void addCallee(LLVMNode *node, llvm::Function *F);
+
+    // build the graphs of all functions reachable from the entry
+    // in parallel and then connect the call-sites
+    void buildParallel(llvm::Function *entry, unsigned threads);
+    void connectCallSites(std::set<LLVMDependenceGraph *>& visited);
+
     // convert llvm basic block to our basic block
     // That includes creating all the nodes and adding them
     // to this graph and creating the basic block and
@@ -166,18 +263,24 @@ private:
     // points-to information (if available)
     LLVMPointerAnalysis *PTA;
 
-    // control expression for this graph
+    // shared with all the subgraphs
+    std::shared_ptr<LLVMDGContext> context;
+
+    // when building in parallel, the calls are not connected
+    // to the subgraphs during building, but stored here
+    bool defer_calls;
+    std::vector<std::pair<LLVMNode *, llvm::Function *>> deferred_calls;
+
+    // control expression for this graph (owns its nodes)
     ControlExpression CE;
 
+    // see getControlDependenciesTime()
+    uint64_t cdTime;
+
     // verifier needs access to private elements
     friend class LLVMDGVerifier;
 };
 
-const std::map<llvm::Value *,
-               LLVMDependenceGraph *>& getConstructedFunctions();
-
-void clearConstructedFunctions();
-
 } // namespace dg
 
 #endif // _DEPENDENCE_GRAPH_H_
@@ -22,6 +22,7 @@
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #endif
 
+#include <llvm/ADT/DenseMap.h>
 #include <llvm/IR/Value.h>
 #include <llvm/IR/Type.h>
 
@@ -32,6 +33,7 @@
 #endif
 
 #include "Node.h"
+#include "ADT/DenseNodesMap.h"
 #include "llvm/analysis/old/AnalysisGeneric.h"
 #include "llvm/analysis/old/DefMap.h"
 
@@ -49,6 +51,16 @@ typedef dg::DGParameters<LLVMNode> LLVMDGParameters;
 class LLVMNode : public Node<LLVMDependenceGraph, llvm::Value *, LLVMNode>
 {
 public:
+    // the graph keeps the nodes and blocks in the order in which they
+    // were built (i. e. numbered by instructions) and finds them by
+    // a DenseMap instead of searching a tree
+    typedef ADT::DenseNodesMap<llvm::Value *, LLVMNode *,
+                               llvm::DenseMap<llvm::Value *, unsigned>>
+            NodesContainerType;
+    typedef ADT::DenseNodesMap<llvm::Value *, LLVMBBlock *,
+                               llvm::DenseMap<llvm::Value *, unsigned>>
+            BBlocksContainerType;
+
     LLVMNode(llvm::Value *val, bool owns_value = false)
         :dg::Node<LLVMDependenceGraph, llvm::Value *, LLVMNode>(val),
          operands(nullptr), operands_num(0), memoryobj(nullptr), data(nullptr)
@@ -1,6 +1,11 @@
 #ifndef _LLVM_DG_SLICER_H_
 #define _LLVM_DG_SLICER_H_
 
+#include <functional>
+#include <set>
+#include <utility>
+#include <vector>
+
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
 #pragma clang diagnostic push
@@ -62,7 +67,9 @@ static void dropAllUses(Val *V)
 class LLVMSlicer : public analysis::Slicer<LLVMNode>
 {
 public:
-    LLVMSlicer(){}
+    LLVMSlicer(uint32_t opt = 0)
+        : analysis::Slicer<LLVMNode>(opt), cloner(nullptr),
+          lazyGraphsNum(0), currentSliceId(0) {}
 
     void setCloner(Cloner *cloner) {
         this->cloner = cloner;
@@ -73,6 +80,27 @@ public:
         dont_touch.insert(n);
     }
 
+    // compute the edges of a graph only when the marking gets to it.
+    // @builder computes the edges of one graph
+    void setLazyEdges(const std::function<void(LLVMDependenceGraph *)>& builder)
+    {
+        lazyEdges = builder;
+    }
+
+    // the number of graphs whose edges were computed lazily
+    size_t getLazyGraphsNum() const { return lazyGraphsNum; }
+
+    /* virtual */
+    void prepareGraph(DependenceGraph<LLVMNode> *graph)
+    {
+        if (!lazyEdges || graph->isPrepared())
+            return;
+
+        graph->setPrepared();
+        ++lazyGraphsNum;
+        lazyEdges(static_cast<LLVMDependenceGraph *>(graph));
+    }
+
     /* virtual */
     bool removeNode(LLVMNode *node)
     {
@@ -149,7 +177,13 @@ public:
         return 0;
     }
 
-    uint32_t slice(LLVMDependenceGraph *,
+    // The clones are sliced one after another, not in parallel.
+    // Slicing deletes the nodes and blocks of the graph that all
+    // the clones share, and removing an instruction changes the
+    // use-lists of the constants and globals that it uses, which are
+    // shared by all the clones too. Nearly all the work would have
+    // to be done under one lock.
+    uint32_t slice(LLVMDependenceGraph *dg,
                    LLVMNode *start, uint32_t sl_id = 0)
     {
         currentSliceId = sl_id;
@@ -161,9 +195,7 @@ public:
 
         // take every subgraph and slice it intraprocedurally
         // this includes the main graph
-        extern std::map<const llvm::Value *,
-                        LLVMDependenceGraph *> constructedFunctions;
-        for (auto& it : constructedFunctions) {
+        for (auto& it : dg->getConstructedFunctions()) {
             if (dontTouch(it.first->getName()))
                 continue;
 
@@ -171,6 +203,36 @@ public:
             sliceGraph(subdg, sl_id);
         }
 
+        // the remembered slices have the removed nodes
+        memoized.clear();
+        return sl_id;
+    }
+
+    // slice with the k-th slice of a batch marking. The marking
+    // is done only once and then every slice is taken from it.
+    // The slices share the graph, so the nodes and blocks that
+    // are removed are dropped from the marking too and the next
+    // slice is taken from what is left (see analysis::Slicer)
+    uint32_t slice(LLVMDependenceGraph *dg,
+                   analysis::BatchMark<LLVMNode>& marks,
+                   unsigned k, uint32_t sl_id)
+    {
+        assert(k < marks.getSlicesNum() && "No such slice");
+
+        // the exit blocks that the slicing creates are in the sliced
+        // function of this slice only, the next slice must not use them
+        std::vector<std::pair<LLVMDependenceGraph *, LLVMBBlock *>> exits;
+        for (auto& it : dg->getConstructedFunctions())
+            exits.emplace_back(it.second, it.second->getExitBB());
+
+        marks.setSlice(k, sl_id);
+        batch = &marks;
+        slice(dg, nullptr, sl_id);
+        batch = nullptr;
+
+        for (auto& it : exits)
+            restoreExitBB(it.first, it.second);
+
         return sl_id;
     }
 
@@ -202,23 +264,23 @@ private:
     
     llvm::Value *getClonedValue(llvm::Function *f, llvm::Value *value, uint32_t sliceId) {
         using namespace llvm;
-        Cloner::SliceInfo *si = cloner->getSliceInfo(f, sliceId);
+        Cloner::SliceInfo *si = cloner ? cloner->getSliceInfo(f, sliceId) : nullptr;
         if (!si) {
             return value;
         }
 
         ValueToValueMapTy &vmap = *(si->v2vmap);
-        if (vmap.find(value) == vmap.end()) {
+        auto it = vmap.find(value);
+        if (it == vmap.end()) {
             return value;
         }
 
-        WeakVH &wvh = vmap[value];
-        return &*wvh;
+        return &*it->second;
     }
 
     llvm::Function *getClonedFunction(llvm::Function *f, uint32_t sliceId) {
         using namespace llvm;
-        Cloner::SliceInfo *si = cloner->getSliceInfo(f, sliceId);
+        Cloner::SliceInfo *si = cloner ? cloner->getSliceInfo(f, sliceId) : nullptr;
         if (!si) {
             return f;
         }
@@ -535,11 +597,17 @@ private:
 
             if (n->getSlice() != slice_id) {
                 removeNode(n);
+                forget(n);
                 graph->deleteNode(n);
                 ++statistics.nodesRemoved;
             }
         }
 
+        // the deleted nodes and blocks left erased entries
+        // in the containers, get rid of them
+        graph->getNodes()->compact();
+        graph->getBlocks().compact();
+
         // create new CFG edges between blocks after slicing
         reconnectLLLVMBasicBlocks(graph);
 
@@ -549,6 +617,35 @@ private:
         ensureEntryBlock(graph);
     }
 
+    // make @oldExitBB the exit of the graph again and remove the exit
+    // block that slicing created instead of it (its basic block stays
+    // in the sliced function, only the graph forgets it)
+    void restoreExitBB(LLVMDependenceGraph *graph, LLVMBBlock *oldExitBB)
+    {
+        LLVMBBlock *newExitBB = graph->getExitBB();
+        if (!oldExitBB || newExitBB == oldExitBB)
+            return;
+
+        for (auto& it : graph->getBlocks()) {
+            LLVMBBlock *BB = it.second;
+            std::vector<uint8_t> labels;
+            for (const auto& succ : BB->successors())
+                if (succ.target == newExitBB)
+                    labels.push_back(succ.label);
+
+            if (labels.empty())
+                continue;
+
+            BB->removeSuccessorsTarget(newExitBB);
+            for (uint8_t label : labels)
+                BB->addSuccessor(oldExitBB, label);
+        }
+
+        graph->setExitBB(oldExitBB);
+        graph->setExit(oldExitBB->getLastNode());
+        newExitBB->remove();
+    }
+
     bool dontTouch(const llvm::StringRef& r)
     {
         for (const char *n : dont_touch)
@@ -682,6 +779,9 @@ private:
     // do not slice these functions at all
     std::set<const char *> dont_touch;
     Cloner *cloner;
+    std::function<void(LLVMDependenceGraph *)> lazyEdges;
+    // the number of graphs whose edges were computed by lazyEdges
+    size_t lazyGraphsNum;
     uint32_t currentSliceId;
 };
 } // namespace dg
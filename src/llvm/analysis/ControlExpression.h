@@ -29,7 +29,7 @@ public:
 
         // create nodes for all basic blocks
         for (llvm::BasicBlock& B : F) {
-            mapping[&B] = new LLVMCFANode(&B);
+            mapping[&B] = cfa.createNode(&B);
         }
 
         // add successors for all basic blocks
@@ -43,13 +43,8 @@ public:
                 LLVMCFANode *succ = mapping[*S];
 
                 // add the successor
-                node->addSuccessor(succ);
+                cfa.addSuccessor(node, succ);
             }
-
-            // add the node into CFA -- we
-            // must do it now, after the node is fully
-            // initialized (when it has successors)
-            cfa.addNode(node);
         }
 
         return cfa;
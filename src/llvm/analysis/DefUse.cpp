@@ -59,9 +59,9 @@ static void handleInstruction(const Instruction *Inst, LLVMNode *node)
 
 static void addReturnEdge(LLVMNode *callNode, LLVMDependenceGraph *subgraph)
 {
-    // FIXME we may loose some accuracy here and
-    // this edges causes that we'll go into subprocedure
-    // even with summary edges
+    // the context-sensitive marking goes through this edge
+    // only in its second phase (it uses the summary edges
+    // of the subprocedure in the first one)
     if (!callNode->isVoidTy())
         subgraph->getExit()->addDataDependence(callNode);
 }
@@ -72,13 +72,26 @@ LLVMDefUseAnalysis::LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
                                        bool assume_pure_funs)
     : analysis::DataFlowAnalysis<LLVMNode>(dg->getEntryBB(),
                                            analysis::DATAFLOW_INTERPROCEDURAL),
-      dg(dg), RD(rd), PTA(pta), DL(new DataLayout(dg->getModule())),
+      dg(dg), RD(rd), MSSA(nullptr), PTA(pta), DL(new DataLayout(dg->getModule())),
       assume_pure_functions(assume_pure_funs)
 {
     assert(PTA && "Need points-to information");
     assert(RD && "Need reaching definitions");
 }
 
+LLVMDefUseAnalysis::LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
+                                       LLVMMemorySSA *mssa,
+                                       LLVMPointerAnalysis *pta,
+                                       bool assume_pure_funs)
+    : analysis::DataFlowAnalysis<LLVMNode>(dg->getEntryBB(),
+                                           analysis::DATAFLOW_INTERPROCEDURAL),
+      dg(dg), RD(nullptr), MSSA(mssa), PTA(pta), DL(new DataLayout(dg->getModule())),
+      assume_pure_functions(assume_pure_funs)
+{
+    assert(PTA && "Need points-to information");
+    assert(MSSA && "Need memory SSA");
+}
+
 void LLVMDefUseAnalysis::handleInlineAsm(LLVMNode *callNode)
 {
     CallInst *CI = cast<CallInst>(callNode->getValue());
@@ -107,7 +120,6 @@ void LLVMDefUseAnalysis::handleInlineAsm(LLVMNode *callNode)
 void LLVMDefUseAnalysis::handleIntrinsicCall(LLVMNode *callNode,
                                              CallInst *CI)
 {
-    static std::set<Instruction *> warnings;
     IntrinsicInst *I = cast<IntrinsicInst>(CI);
     Value *dest, *src = nullptr;
 
@@ -136,7 +148,7 @@ void LLVMDefUseAnalysis::handleIntrinsicCall(LLVMNode *callNode,
             return;
         case Intrinsic::stacksave:
         case Intrinsic::stackrestore:
-            if (warnings.insert(CI).second)
+            if (warnedIntrinsics.insert(CI).second)
                 llvmutils::printerr("WARN: stack save/restore not implemented", CI);
             return;
         default:
@@ -221,34 +233,33 @@ void LLVMDefUseAnalysis::handleCallInst(LLVMNode *node)
 // to memory pointed by 'pts' to 'node'
 void LLVMDefUseAnalysis::addUnknownDataDependence(LLVMNode *node, PSNode *pts)
 {
-    // iterate over all nodes from ReachingDefinitions Subgraph. It is faster than
-    // going over all llvm nodes and querying the pointer to analysis
-    for (auto& it : RD->getNodesMap()) {
-        RDNode *rdnode = it.second;
+    // gather the definitions of all the memory in pts first,
+    // so that we add every edge just once
+    std::set<RDNode *> defs;
+    for (const auto& ptr : pts->pointsTo) {
+        if (!ptr.isValid())
+            continue;
 
-        // only STORE may be a definition site
-        if (rdnode->getType() != analysis::rd::STORE)
+        llvm::Value *llvmVal = ptr.target->getUserData<llvm::Value>();
+        RDNode *target = RD->getNode(llvmVal);
+        if (!target)
             continue;
 
-        llvm::Value *rdVal = rdnode->getUserData<llvm::Value>();
-        // artificial node?
-        if (!rdVal)
+        const std::vector<RDNode *> *nodes = RD->getDefinitions(target);
+        if (!nodes)
             continue;
 
-        // does this store define some value that is in pts?
-        for (const analysis::rd::DefSite& ds : rdnode->getDefines()) {
-            llvm::Value *llvmVal = ds.target->getUserData<llvm::Value>();
-            // is this an artificial node?
-            if (!llvmVal)
+        for (RDNode *rdnode : *nodes) {
+            // only STORE may be a definition site
+            if (rdnode->getType() != analysis::rd::STORE)
                 continue;
 
-            // if these two sets have an over-lap, we must add the data dependence
-            for (const auto& ptr : pts->pointsTo)
-                if (ptr.target->getUserData<llvm::Value>() == llvmVal) {
-                    addDataDependence(node, rdVal);
-            }
+            defs.insert(rdnode);
         }
     }
+
+    for (RDNode *rdnode : defs)
+        addDataDependence(node, rdnode);
 }
 
 void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, llvm::Value *rdval)
@@ -289,7 +300,7 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
                                            RDNode *mem, uint64_t size)
 {
     using namespace dg::analysis;
-    static std::set<const llvm::Value *> reported_mappings;
+    bool unknown_definition = false;
 
     for (const pta::Pointer& ptr : pts->pointsTo) {
         if (!ptr.isValid())
@@ -300,7 +311,7 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
 
         RDNode *val = RD->getNode(llvmVal);
         if(!val) {
-            if (reported_mappings.insert(llvmVal).second)
+            if (warnedMappings.insert(llvmVal).second)
                 llvmutils::printerr("DEF-USE: no information for: ", llvmVal);
 
             // XXX: shouldn't we set val to unknown location now?
@@ -310,7 +321,8 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
         std::set<RDNode *> defs;
         // Get even reaching definitions for UNKNOWN_MEMORY.
         // Since those can be ours definitions, we must add them always
-        mem->getReachingDefinitions(rd::UNKNOWN_MEMORY, UNKNOWN_OFFSET, UNKNOWN_OFFSET, defs);
+        RD->getReachingDefinitions(mem, rd::UNKNOWN_MEMORY,
+                                   UNKNOWN_OFFSET, UNKNOWN_OFFSET, defs);
         if (!defs.empty()) {
             for (RDNode *rd : defs) {
                 assert(!rd->isUnknown() && "Unknown memory defined at unknown location?");
@@ -320,13 +332,12 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
             defs.clear();
         }
 
-        mem->getReachingDefinitions(val, ptr.offset, size, defs);
+        RD->getReachingDefinitions(mem, val, ptr.offset, size, defs);
         if (defs.empty()) {
             llvm::GlobalVariable *GV
                 = llvm::dyn_cast<llvm::GlobalVariable>(llvmVal);
             if (!GV || !GV->hasInitializer()) {
-                static std::set<const llvm::Value *> reported;
-                if (reported.insert(llvmVal).second) {
+                if (warnedNoDefs.insert(llvmVal).second) {
                     llvm::errs() << "No reaching definition for: " << *llvmVal
                                  << " off: " << *ptr.offset << "\n";
                 }
@@ -340,16 +351,18 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node, PSNode *pts,
             if (rd->isUnknown()) {
                 // we don't know what definitions reach this node,
                 // se we must add data dependence to all possible
-                // write to this memory
-                addUnknownDataDependence(node, pts);
-
-                // we can bail out, since we have added all
+                // write to this memory. Do it after the loop, once
+                // for the whole points-to set
+                unknown_definition = true;
                 break;
             }
 
             addDataDependence(node, rd);
         }
     }
+
+    if (unknown_definition)
+        addUnknownDataDependence(node, pts);
 }
 
 void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
@@ -375,6 +388,11 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
 {
     using namespace dg::analysis;
 
+    if (MSSA) {
+        addMemorySSADependence(node, where, pts, size);
+        return;
+    }
+
     // get the node from reaching definition where we have
     // all the reaching definitions
     RDNode *mem = RD->getMapping(where);
@@ -388,6 +406,35 @@ void LLVMDefUseAnalysis::addDataDependence(LLVMNode *node,
     addDataDependence(node, pts, mem, size);
 }
 
+void LLVMDefUseAnalysis::addMemorySSADependence(LLVMNode *node,
+                                                const llvm::Value *where,
+                                                PSNode *pts,
+                                                uint64_t size)
+{
+    const llvm::Instruction *I = llvm::cast<llvm::Instruction>(where);
+    std::set<llvm::Value *> defs;
+    bool has_valid = false;
+
+    for (const analysis::pta::Pointer& ptr : pts->pointsTo) {
+        if (!ptr.isValid())
+            continue;
+
+        llvm::Value *llvmVal = ptr.target->getUserData<llvm::Value>();
+        assert(llvmVal && "Don't have Value in PSNode");
+
+        MSSA->getReachingDefinitions(I, llvmVal, ptr.offset, size, defs);
+        has_valid = true;
+    }
+
+    // the definitions of unknown memory can be ours definitions too
+    if (has_valid)
+        MSSA->getReachingDefinitions(I, nullptr, UNKNOWN_OFFSET,
+                                     UNKNOWN_OFFSET, defs);
+
+    for (llvm::Value *def : defs)
+        addDataDependence(node, def);
+}
+
 static uint64_t getAllocatedSize(llvm::Type *Ty, const llvm::DataLayout *DL)
 {
     // Type can be i8 *null or similar
@@ -426,4 +473,15 @@ bool LLVMDefUseAnalysis::runOnNode(LLVMNode *node, LLVMNode *prev)
     return false;
 }
 
+void LLVMDefUseAnalysis::runOnGraph(LLVMDependenceGraph *graph)
+{
+    for (auto& it : graph->getBlocks())
+        runOnBlock(it.second);
+
+    // the unified exit block is not among the blocks of the graph
+    LLVMBBlock *exitBB = graph->getExitBB();
+    if (exitBB && graph->getBlocks().count(exitBB->getKey()) == 0)
+        runOnBlock(exitBB);
+}
+
 } // namespace dg
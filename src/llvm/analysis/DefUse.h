@@ -1,14 +1,18 @@
 #ifndef _LLVM_DEF_USE_ANALYSIS_H_
 #define _LLVM_DEF_USE_ANALYSIS_H_
 
+#include <set>
+
 #include <llvm/IR/Instruction.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/DataLayout.h>
 
 #include "analysis/DataFlowAnalysis.h"
 #include "ReachingDefinitions/ReachingDefinitions.h"
+#include "MemorySSA.h"
 
 using dg::analysis::rd::LLVMReachingDefinitions;
+using dg::analysis::mssa::LLVMMemorySSA;
 
 namespace llvm {
     class DataLayout;
@@ -24,18 +28,37 @@ class LLVMDefUseAnalysis : public analysis::DataFlowAnalysis<LLVMNode>
 {
     LLVMDependenceGraph *dg;
     LLVMReachingDefinitions *RD;
+    // if set, the data dependencies are read from memory SSA
+    // instead of reaching definitions
+    LLVMMemorySSA *MSSA;
     LLVMPointerAnalysis *PTA;
     const llvm::DataLayout *DL;
     bool assume_pure_functions;
+
+    // the values that we warned about already, so that we
+    // do not flood the terminal. They are kept per analysis,
+    // so that the analyses in different threads do not share them
+    std::set<const llvm::Value *> warnedIntrinsics;
+    std::set<const llvm::Value *> warnedMappings;
+    std::set<const llvm::Value *> warnedNoDefs;
 public:
     LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
                        LLVMReachingDefinitions *rd,
                        LLVMPointerAnalysis *pta,
                        bool assume_pure_functions = false);
+    LLVMDefUseAnalysis(LLVMDependenceGraph *dg,
+                       LLVMMemorySSA *mssa,
+                       LLVMPointerAnalysis *pta,
+                       bool assume_pure_functions = false);
     ~LLVMDefUseAnalysis() { delete DL; }
 
     /* virtual */
     bool runOnNode(LLVMNode *node, LLVMNode *prev);
+
+    // add the def-use edges only to the nodes of the graph
+    // (not to the nodes of the called functions), so that
+    // the edges can be added lazily, graph by graph
+    void runOnGraph(LLVMDependenceGraph *graph);
 private:
     void addDataDependence(LLVMNode *node,
                            analysis::pta::PSNode *pts,
@@ -52,9 +75,17 @@ private:
                            PSNode *pts, /* what memory */
                            uint64_t size);
 
+    // add data dependencies read off the use-def chains of memory SSA
+    void addMemorySSADependence(LLVMNode *node,
+                                const llvm::Value *where,
+                                PSNode *pts,
+                                uint64_t size);
+
     void addDataDependence(LLVMNode *node, analysis::rd::RDNode *rd);
     void addDataDependence(LLVMNode *node, llvm::Value *val);
 
+    // add data dependencies from all the stores that may write
+    // to memory pointed by @pts (no matter the offsets)
     void addUnknownDataDependence(LLVMNode *node, PSNode *pts);
 
     void handleLoadInst(llvm::LoadInst *, LLVMNode *);
@@ -0,0 +1,716 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <set>
+#include <unordered_set>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/DataLayout.h>
+#include <llvm/Support/raw_ostream.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "ADT/Queue.h"
+#include "analysis/Dominators.h"
+#include "analysis/PointsTo/PointerSubgraph.h"
+
+#include "llvm/LLVMNode.h"
+#include "llvm/LLVMDependenceGraph.h"
+#include "llvm/llvm-utils.h"
+
+#include "MemorySSA.h"
+
+namespace dg {
+namespace analysis {
+namespace mssa {
+
+static uint64_t getAllocatedSize(llvm::Type *Ty, const llvm::DataLayout *DL)
+{
+    // Type can be i8 *null or similar
+    if (!Ty->isSized())
+            return UNKNOWN_OFFSET;
+
+    uint64_t size = DL->getTypeAllocSize(Ty);
+    if (size == 0)
+        return UNKNOWN_OFFSET;
+
+    return size;
+}
+
+// strong update is possible only with must aliases and not for
+// the dynamically allocated memory, since one allocation site may stand
+// for many objects (reaching definitions do not strongly update
+// DYN_ALLOC nodes either, see RDMap::isOverwritten)
+static bool canStrongUpdate(const PSNode *pts, const pta::Pointer& ptr)
+{
+    return pts->pointsTo.size() == 1
+            && ptr.target->getType() != pta::DYN_ALLOC;
+}
+
+static bool overlaps(const MemoryDef *def, const Offset& off, const Offset& len)
+{
+    if (def->getOffset().isUnknown() || def->getLength().isUnknown()
+        || off.isUnknown() || len.isUnknown())
+        return true;
+
+    return *def->getOffset() < *off + *len
+            && *off < *def->getOffset() + *def->getLength();
+}
+
+static bool covers(const MemoryDef *def, const Offset& off, const Offset& len)
+{
+    if (def->getOffset().isUnknown() || def->getLength().isUnknown()
+        || off.isUnknown() || len.isUnknown())
+        return false;
+
+    return *def->getOffset() <= *off
+            && *def->getOffset() + *def->getLength() >= *off + *len;
+}
+
+LLVMMemorySSA::LLVMMemorySSA(LLVMDependenceGraph *dg,
+                             LLVMPointerAnalysis *pta,
+                             bool assume_pure_funs)
+    : dg(dg), PTA(pta), DL(new llvm::DataLayout(dg->getModule())),
+      assume_pure_functions(assume_pure_funs)
+{
+    assert(PTA && "Need points-to information");
+}
+
+LLVMMemorySSA::~LLVMMemorySSA()
+{
+    delete DL;
+}
+
+MemoryDef *LLVMMemorySSA::addDef(LLVMBBlock *B, const llvm::Instruction *I,
+                                 unsigned order, const llvm::Value *obj,
+                                 const Offset& off, const Offset& len,
+                                 bool strong_update)
+{
+    MemoryDef *def = new MemoryDef(obj, B, I, order, off, len, strong_update);
+    defs.emplace_back(def);
+
+    BlockInfo& BI = blocks[B];
+    BI.defs[obj].push_back(def);
+    functions[BI.dg].mod.insert(obj);
+
+    return def;
+}
+
+void LLVMMemorySSA::addStoreDefs(LLVMBBlock *B, const llvm::StoreInst *SI,
+                                 unsigned order)
+{
+    PSNode *pts = PTA->getPointsTo(SI->getPointerOperand());
+    if (!pts) {
+        llvmutils::printerr("ERROR: No points-to: ", SI->getPointerOperand());
+        return;
+    }
+
+    // this may happen on invalid writes to memory,
+    // better be sound then incorrect
+    if (pts->pointsTo.empty()) {
+        addDef(B, SI, order, nullptr, UNKNOWN_OFFSET, UNKNOWN_OFFSET, false);
+        return;
+    }
+
+    for (const pta::Pointer& ptr : pts->pointsTo) {
+        if (ptr.isNull())
+            continue;
+
+        if (ptr.isUnknown()) {
+            addDef(B, SI, order, nullptr, UNKNOWN_OFFSET, UNKNOWN_OFFSET, false);
+            continue;
+        }
+
+        const llvm::Value *obj = ptr.target->getUserData<llvm::Value>();
+        // this may emerge with vararg function
+        if (llvm::isa<llvm::Function>(obj))
+            continue;
+
+        uint64_t size = UNKNOWN_OFFSET;
+        if (!ptr.offset.isUnknown())
+            size = getAllocatedSize(SI->getValueOperand()->getType(), DL);
+
+        addDef(B, SI, order, obj, ptr.offset, size, canStrongUpdate(pts, ptr));
+    }
+}
+
+void LLVMMemorySSA::addUndefinedCallDefs(LLVMBBlock *B, const llvm::CallInst *CI,
+                                         unsigned order)
+{
+    using namespace llvm;
+
+    if (assume_pure_functions)
+        return;
+
+    // every pointer we pass into the undefined call may be defined
+    // in the function
+    for (unsigned int i = 0; i < CI->getNumArgOperands(); ++i) {
+        const Value *llvmOp = CI->getArgOperand(i);
+
+        // constants cannot be redefined except for global variables
+        // (that are constant, but may point to non constant memory
+        const Value *strippedValue = llvmOp->stripPointerCasts();
+        if (isa<Constant>(strippedValue)) {
+            const GlobalVariable *GV = dyn_cast<GlobalVariable>(strippedValue);
+            if (!GV || GV->isConstant())
+                continue;
+        }
+
+        PSNode *pts = PTA->getPointsTo(llvmOp);
+        if (!pts)
+            continue;
+
+        for (const pta::Pointer& ptr : pts->pointsTo) {
+            if (!ptr.isValid())
+                continue;
+
+            const llvm::Value *obj = ptr.target->getUserData<llvm::Value>();
+            if (isa<Function>(obj))
+                continue;
+
+            addDef(B, CI, order, obj, UNKNOWN_OFFSET, UNKNOWN_OFFSET, false);
+        }
+    }
+}
+
+void LLVMMemorySSA::addIntrinsicCallDefs(LLVMBBlock *B, const llvm::CallInst *CI,
+                                         unsigned order)
+{
+    using namespace llvm;
+
+    const IntrinsicInst *I = cast<IntrinsicInst>(CI);
+    switch (I->getIntrinsicID())
+    {
+        case Intrinsic::memmove:
+        case Intrinsic::memcpy:
+        case Intrinsic::memset:
+            // memcpy/set <dest>, <src/val>, <len>
+            break;
+        case Intrinsic::vastart:
+            // the call works as an allocation of the va_list
+            addDef(B, CI, order, CI, 0, UNKNOWN_OFFSET, false);
+            return;
+        default:
+            // the rest of intrinsics does not write to memory
+            return;
+    }
+
+    PSNode *pts = PTA->getPointsTo(I->getOperand(0));
+    if (!pts) {
+        llvmutils::printerr("ERROR: No points-to: ", I->getOperand(0));
+        return;
+    }
+
+    uint64_t len = UNKNOWN_OFFSET;
+    if (const ConstantInt *C = dyn_cast<ConstantInt>(I->getOperand(2)))
+        len = C->getLimitedValue();
+
+    for (const pta::Pointer& ptr : pts->pointsTo) {
+        if (!ptr.isValid())
+            continue;
+
+        const llvm::Value *obj = ptr.target->getUserData<llvm::Value>();
+        if (isa<Function>(obj))
+            continue;
+
+        addDef(B, CI, order, obj, ptr.offset,
+               ptr.offset.isUnknown() ? UNKNOWN_OFFSET : len,
+               canStrongUpdate(pts, ptr));
+    }
+}
+
+void LLVMMemorySSA::addCallDefs(LLVMBBlock *B, LLVMNode *node, unsigned order)
+{
+    using namespace llvm;
+
+    const CallInst *CI = cast<CallInst>(node->getKey());
+    if (CI->isInlineAsm()) {
+        addUndefinedCallDefs(B, CI, order);
+        return;
+    }
+
+    const Value *calledVal = CI->getCalledValue()->stripPointerCasts();
+    if (const Function *func = dyn_cast<Function>(calledVal)) {
+        // the calls of defined functions are added later,
+        // when we know what the callees may modify
+        if (func->size() > 0)
+            return;
+
+        if (func->isIntrinsic()) {
+            addIntrinsicCallDefs(B, CI, order);
+            return;
+        }
+
+        const char *name = func->getName().data();
+        if (strcmp(name, "realloc") == 0) {
+            // realloc defines itself, since it copies the values
+            // from previous memory
+            addDef(B, CI, order, CI, 0, UNKNOWN_OFFSET, false);
+        } else if (strcmp(name, "malloc") != 0 &&
+                   strcmp(name, "calloc") != 0 &&
+                   strcmp(name, "alloca") != 0) {
+            addUndefinedCallDefs(B, CI, order);
+        }
+
+        return;
+    }
+
+    // call via function pointer. If we may call
+    // an undefined function, take it as undefined call
+    PSNode *op = PTA->getPointsTo(calledVal);
+    if (!op || op->pointsTo.empty() || !node->hasSubgraphs()) {
+        addUndefinedCallDefs(B, CI, order);
+        return;
+    }
+
+    for (const pta::Pointer& ptr : op->pointsTo) {
+        if (!ptr.isValid())
+            continue;
+
+        const Function *F = dyn_cast<Function>(ptr.target->getUserData<Value>());
+        if (F && F->size() == 0 && llvmutils::callIsCompatible(F, CI)) {
+            addUndefinedCallDefs(B, CI, order);
+            return;
+        }
+    }
+}
+
+void LLVMMemorySSA::buildDefs(LLVMDependenceGraph *graph)
+{
+    using namespace llvm;
+
+    FunctionInfo& FI = functions[graph];
+    llvmutils::getLocalVariables(cast<Function>(graph->getEntry()->getKey()),
+                                 FI.locals);
+
+    for (auto& it : graph->getBlocks()) {
+        LLVMBBlock *B = it.second;
+        blocks[B].dg = graph;
+
+        unsigned order = 0;
+        for (LLVMNode *node : B->getNodes()) {
+            const Value *val = node->getKey();
+
+            if (const StoreInst *SI = dyn_cast<StoreInst>(val)) {
+                positions[val] = std::make_pair(B, order);
+                addStoreDefs(B, SI, order);
+            } else if (isa<LoadInst>(val)) {
+                positions[val] = std::make_pair(B, order);
+            } else if (isa<CallInst>(val)) {
+                positions[val] = std::make_pair(B, order);
+                addCallDefs(B, node, order);
+            } else if (isa<ReturnInst>(val)) {
+                FI.returns.push_back(B);
+            }
+
+            ++order;
+        }
+    }
+}
+
+void LLVMMemorySSA::computeDominators(LLVMDependenceGraph *graph)
+{
+    analysis::Dominators<LLVMNode> doms;
+    for (auto& it : graph->getBlocks())
+        doms.addBlock(it.second);
+
+    doms.compute(graph->getEntryBB());
+
+    FunctionInfo& FI = functions[graph];
+    for (auto& it : graph->getBlocks()) {
+        // the entry and the unreachable blocks have no idom
+        if (LLVMBBlock *idom = doms.getIDom(it.second))
+            FI.idom[it.second] = idom;
+    }
+}
+
+// the function may define everything that its callees may define,
+// except for the callees' local variables
+void LLVMMemorySSA::computeMod()
+{
+    ADT::QueueFIFO<LLVMDependenceGraph *> queue;
+    std::set<LLVMDependenceGraph *> queued;
+
+    for (auto& it : functions) {
+        queue.push(it.first);
+        queued.insert(it.first);
+    }
+
+    while (!queue.empty()) {
+        LLVMDependenceGraph *graph = queue.pop();
+        queued.erase(graph);
+
+        FunctionInfo& FI = functions[graph];
+        for (LLVMNode *callNode : graph->getCallers()) {
+            LLVMDependenceGraph *caller = callNode->getDG();
+            FunctionInfo& CFI = functions[caller];
+
+            bool changed = false;
+            for (const llvm::Value *obj : FI.mod) {
+                if (FI.locals.count(obj) == 0)
+                    changed |= CFI.mod.insert(obj).second;
+            }
+
+            if (changed && queued.insert(caller).second)
+                queue.push(caller);
+        }
+    }
+}
+
+void LLVMMemorySSA::addCallsOfDefinedFunctions(LLVMDependenceGraph *graph)
+{
+    for (auto& it : graph->getBlocks()) {
+        LLVMBBlock *B = it.second;
+        BlockInfo& BI = blocks[B];
+
+        bool added = false;
+        unsigned order = 0;
+        for (LLVMNode *node : B->getNodes()) {
+            if (!node->hasSubgraphs()) {
+                ++order;
+                continue;
+            }
+
+            const llvm::Instruction *I
+                = llvm::cast<llvm::Instruction>(node->getKey());
+
+            // the call (weakly) defines everything
+            // that any of the callees may define
+            std::unordered_map<const llvm::Value *, MemoryDef *> created;
+            for (LLVMDependenceGraph *sub : node->getSubgraphs()) {
+                FunctionInfo& SFI = functions[sub];
+                for (const llvm::Value *obj : SFI.mod) {
+                    if (SFI.locals.count(obj) != 0)
+                        continue;
+
+                    MemoryDef *& def = created[obj];
+                    if (!def) {
+                        def = addDef(B, I, order, obj,
+                                     UNKNOWN_OFFSET, UNKNOWN_OFFSET, false);
+                        added = true;
+                    }
+
+                    def->addCallee(sub);
+                }
+            }
+
+            ++order;
+        }
+
+        if (!added)
+            continue;
+
+        for (auto& dit : BI.defs)
+            std::stable_sort(dit.second.begin(), dit.second.end(),
+                             [](const MemoryDef *a, const MemoryDef *b) {
+                                return a->getOrder() < b->getOrder();
+                             });
+    }
+}
+
+void LLVMMemorySSA::placePhis(LLVMDependenceGraph *graph)
+{
+    FunctionInfo& FI = functions[graph];
+
+    // compute dominance frontiers (Cytron et al.)
+    std::unordered_map<LLVMBBlock *, std::set<LLVMBBlock *>> frontiers;
+    for (auto& it : graph->getBlocks()) {
+        LLVMBBlock *B = it.second;
+        if (B->predecessorsNum() < 2)
+            continue;
+
+        auto iit = FI.idom.find(B);
+        LLVMBBlock *idom = iit == FI.idom.end() ? nullptr : iit->second;
+        for (LLVMBBlock *pred : B->predecessors()) {
+            LLVMBBlock *runner = pred;
+            while (runner && runner != idom) {
+                frontiers[runner].insert(B);
+
+                auto rit = FI.idom.find(runner);
+                runner = rit == FI.idom.end() ? nullptr : rit->second;
+            }
+        }
+    }
+
+    // blocks with definitions of the objects
+    std::unordered_map<const llvm::Value *, std::vector<LLVMBBlock *>> defBlocks;
+    for (auto& it : graph->getBlocks()) {
+        for (auto& dit : blocks[it.second].defs) {
+            if (!dit.second.empty())
+                defBlocks[dit.first].push_back(it.second);
+        }
+    }
+
+    // place the phis into iterated dominance frontiers
+    for (auto& it : defBlocks) {
+        const llvm::Value *obj = it.first;
+        std::set<LLVMBBlock *> visited(it.second.begin(), it.second.end());
+        ADT::QueueLIFO<LLVMBBlock *> queue;
+        for (LLVMBBlock *B : it.second)
+            queue.push(B);
+
+        while (!queue.empty()) {
+            LLVMBBlock *B = queue.pop();
+
+            auto fit = frontiers.find(B);
+            if (fit == frontiers.end())
+                continue;
+
+            for (LLVMBBlock *F : fit->second) {
+                MemoryPhi *& phi = blocks[F].phis[obj];
+                if (!phi) {
+                    phi = new MemoryPhi(obj, F);
+                    phis.emplace_back(phi);
+                }
+
+                if (visited.insert(F).second)
+                    queue.push(F);
+            }
+        }
+    }
+}
+
+void LLVMMemorySSA::run()
+{
+    const auto& CF = dg->getConstructedFunctions();
+
+    for (auto& it : CF) {
+        computeDominators(it.second);
+        buildDefs(it.second);
+    }
+
+    computeMod();
+
+    for (auto& it : CF) {
+        addCallsOfDefinedFunctions(it.second);
+        placePhis(it.second);
+    }
+}
+
+MemoryAccess *LLVMMemorySSA::getLiveOnEntry(LLVMDependenceGraph *graph,
+                                            const llvm::Value *obj)
+{
+    MemoryLiveOnEntry *& acc = functions[graph].onEntry[obj];
+    if (!acc) {
+        acc = new MemoryLiveOnEntry(obj, graph);
+        liveOnEntry.emplace_back(acc);
+    }
+
+    return acc;
+}
+
+// walk up the dominator tree until we find a block
+// with a definition or a phi of the object
+MemoryAccess *LLVMMemorySSA::getEntryVersion(LLVMBBlock *B,
+                                             const llvm::Value *obj)
+{
+    std::vector<BlockInfo *> path;
+    MemoryAccess *ret = nullptr;
+
+    while (!ret) {
+        BlockInfo& BI = blocks[B];
+
+        auto it = BI.entry.find(obj);
+        if (it != BI.entry.end()) {
+            ret = it->second;
+            break;
+        }
+
+        auto pit = BI.phis.find(obj);
+        if (pit != BI.phis.end())
+            return pit->second;
+
+        path.push_back(&BI);
+
+        FunctionInfo& FI = functions[BI.dg];
+        auto iit = FI.idom.find(B);
+        if (iit == FI.idom.end()) {
+            // the entry block (or unreachable block)
+            ret = getLiveOnEntry(BI.dg, obj);
+            break;
+        }
+
+        // the version at the entry of the block
+        // is the version at the end of its idom
+        B = iit->second;
+        BlockInfo& IBI = blocks[B];
+        auto dit = IBI.defs.find(obj);
+        if (dit != IBI.defs.end() && !dit->second.empty())
+            ret = dit->second.back();
+    }
+
+    for (BlockInfo *BI : path)
+        BI->entry[obj] = ret;
+
+    return ret;
+}
+
+MemoryAccess *LLVMMemorySSA::getExitVersion(LLVMBBlock *B,
+                                            const llvm::Value *obj)
+{
+    BlockInfo& BI = blocks[B];
+    auto it = BI.defs.find(obj);
+    if (it != BI.defs.end() && !it->second.empty())
+        return it->second.back();
+
+    return getEntryVersion(B, obj);
+}
+
+// the previous version of the object
+MemoryAccess *LLVMMemorySSA::getDefiningAccess(MemoryDef *def)
+{
+    const std::vector<MemoryDef *>& bdefs
+        = blocks[def->getBBlock()].defs[def->getObject()];
+
+    auto I = std::find(bdefs.begin(), bdefs.end(), def);
+    assert(I != bdefs.end() && "Do not have the definition in its block");
+    if (I != bdefs.begin())
+        return *(I - 1);
+
+    return getEntryVersion(def->getBBlock(), def->getObject());
+}
+
+MemoryAccess *LLVMMemorySSA::getVersionBefore(const llvm::Value *I,
+                                              const llvm::Value *obj)
+{
+    auto it = positions.find(I);
+    if (it == positions.end())
+        return nullptr;
+
+    LLVMBBlock *B = it->second.first;
+    unsigned order = it->second.second;
+
+    BlockInfo& BI = blocks[B];
+    auto dit = BI.defs.find(obj);
+    if (dit != BI.defs.end()) {
+        const std::vector<MemoryDef *>& bdefs = dit->second;
+        // the first definition that is not before the instruction
+        auto D = std::lower_bound(bdefs.begin(), bdefs.end(), order,
+                                  [](const MemoryDef *def, unsigned o) {
+                                    return def->getOrder() < o;
+                                  });
+        if (D != bdefs.begin())
+            return *(D - 1);
+    }
+
+    return getEntryVersion(B, obj);
+}
+
+const std::vector<MemoryAccess *>& LLVMMemorySSA::getIncoming(MemoryPhi *phi)
+{
+    if (!phi->resolved) {
+        for (LLVMBBlock *pred : phi->getBBlock()->predecessors())
+            phi->incoming.push_back(getExitVersion(pred, phi->getObject()));
+
+        phi->resolved = true;
+    }
+
+    return phi->incoming;
+}
+
+MemoryUse *LLVMMemorySSA::getUse(const llvm::Instruction *I,
+                                 const llvm::Value *obj)
+{
+    std::unique_ptr<MemoryUse>& use = uses[std::make_pair(I, obj)];
+    if (!use) {
+        MemoryAccess *def = getVersionBefore(I, obj);
+        if (!def)
+            return nullptr;
+
+        use.reset(new MemoryUse(I, def));
+    }
+
+    return use.get();
+}
+
+size_t LLVMMemorySSA::getReachingDefinitions(const llvm::Instruction *I,
+                                             const llvm::Value *obj,
+                                             const Offset& off, const Offset& len,
+                                             std::set<llvm::Value *>& ret)
+{
+    MemoryUse *use = getUse(I, obj);
+    if (!use) {
+        llvmutils::printerr("ERROR: No memory SSA for: ", I);
+        return 0;
+    }
+
+    std::unordered_set<MemoryAccess *> visited;
+    ADT::QueueLIFO<MemoryAccess *> queue;
+    size_t num = ret.size();
+
+    queue.push(use->getDefiningAccess());
+    visited.insert(use->getDefiningAccess());
+
+    auto push = [&visited, &queue](MemoryAccess *acc) {
+        if (visited.insert(acc).second)
+            queue.push(acc);
+    };
+
+    while (!queue.empty()) {
+        MemoryAccess *acc = queue.pop();
+
+        switch (acc->getKind()) {
+            case MemoryAccess::DEF: {
+                MemoryDef *def = static_cast<MemoryDef *>(acc);
+                if (def->isCall()) {
+                    // the definitions come from the callees. If the object
+                    // may not be defined on some path, we get to
+                    // the callees' entry and from there to the call-sites
+                    for (LLVMDependenceGraph *callee : def->getCallees()) {
+                        for (LLVMBBlock *B : functions[callee].returns)
+                            push(getExitVersion(B, obj));
+                    }
+                    break;
+                }
+
+                if (overlaps(def, off, len))
+                    ret.insert(const_cast<llvm::Instruction *>(def->getInstruction()));
+
+                // nothing from before gets through this definition
+                if (def->isStrongUpdate() && covers(def, off, len))
+                    break;
+
+                push(getDefiningAccess(def));
+                break;
+            }
+            case MemoryAccess::PHI:
+                for (MemoryAccess *in : getIncoming(static_cast<MemoryPhi *>(acc)))
+                    push(in);
+                break;
+            case MemoryAccess::LIVE_ON_ENTRY: {
+                LLVMDependenceGraph *graph
+                    = static_cast<MemoryLiveOnEntry *>(acc)->getDG();
+                for (LLVMNode *callNode : graph->getCallers()) {
+                    if (MemoryAccess *before
+                            = getVersionBefore(callNode->getKey(), obj))
+                        push(before);
+                }
+                break;
+            }
+        }
+    }
+
+    return ret.size() - num;
+}
+
+} // namespace mssa
+} // namespace analysis
+} // namespace dg
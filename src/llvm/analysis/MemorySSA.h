@@ -0,0 +1,250 @@
+#ifndef _LLVM_DG_MEMORY_SSA_H_
+#define _LLVM_DG_MEMORY_SSA_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+// ignore unused parameters in LLVM libraries
+#if (__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-parameter"
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/DataLayout.h>
+
+#if (__clang__)
+#pragma clang diagnostic pop // ignore -Wunused-parameter
+#else
+#pragma GCC diagnostic pop
+#endif
+
+#include "analysis/Offset.h"
+#include "llvm/LLVMDependenceGraph.h"
+#include "llvm/analysis/PointsTo/PointsTo.h"
+
+namespace dg {
+namespace analysis {
+namespace mssa {
+
+// Memory SSA is built over abstract memory objects given by the points-to
+// analysis (the objects are the llvm values that allocate the memory).
+// nullptr stands for the unknown memory
+
+class MemoryAccess
+{
+public:
+    enum Kind {
+        // an instruction that may write to the object
+        DEF,
+        // merge of versions of the object at a join point of the CFG
+        PHI,
+        // the version of the object at the entry of a function
+        LIVE_ON_ENTRY,
+    };
+
+    MemoryAccess(Kind k, const llvm::Value *obj, LLVMBBlock *B)
+        : kind(k), object(obj), block(B) {}
+
+    Kind getKind() const { return kind; }
+    const llvm::Value *getObject() const { return object; }
+    LLVMBBlock *getBBlock() const { return block; }
+
+private:
+    Kind kind;
+    const llvm::Value *object;
+    LLVMBBlock *block;
+};
+
+class MemoryDef : public MemoryAccess
+{
+public:
+    MemoryDef(const llvm::Value *obj, LLVMBBlock *B,
+              const llvm::Instruction *I, unsigned ord,
+              const Offset& off, const Offset& l, bool strong_upd)
+        : MemoryAccess(DEF, obj, B), inst(I), order(ord),
+          offset(off), len(l), strong_update(strong_upd) {}
+
+    const llvm::Instruction *getInstruction() const { return inst; }
+    unsigned getOrder() const { return order; }
+    const Offset& getOffset() const { return offset; }
+    const Offset& getLength() const { return len; }
+    bool isStrongUpdate() const { return strong_update; }
+
+    // is this a call of defined function(s)? Then the definitions
+    // come from the callees and not from the call itself
+    bool isCall() const { return !callees.empty(); }
+    const std::vector<LLVMDependenceGraph *>& getCallees() const { return callees; }
+    void addCallee(LLVMDependenceGraph *graph) { callees.push_back(graph); }
+
+private:
+    const llvm::Instruction *inst;
+    // position of the instruction in the block
+    unsigned order;
+    Offset offset;
+    Offset len;
+    bool strong_update;
+
+    std::vector<LLVMDependenceGraph *> callees;
+};
+
+class MemoryPhi : public MemoryAccess
+{
+public:
+    MemoryPhi(const llvm::Value *obj, LLVMBBlock *B)
+        : MemoryAccess(PHI, obj, B), resolved(false) {}
+
+    const std::vector<MemoryAccess *>& getIncoming() const { return incoming; }
+
+private:
+    // the incoming versions are filled lazily
+    // by LLVMMemorySSA::getIncoming()
+    std::vector<MemoryAccess *> incoming;
+    bool resolved;
+
+    friend class LLVMMemorySSA;
+};
+
+class MemoryLiveOnEntry : public MemoryAccess
+{
+public:
+    MemoryLiveOnEntry(const llvm::Value *obj, LLVMDependenceGraph *graph)
+        : MemoryAccess(LIVE_ON_ENTRY, obj, graph->getEntryBB()), dg(graph) {}
+
+    LLVMDependenceGraph *getDG() const { return dg; }
+
+private:
+    LLVMDependenceGraph *dg;
+};
+
+// a read of the object by an instruction
+class MemoryUse
+{
+public:
+    MemoryUse(const llvm::Instruction *I, MemoryAccess *def)
+        : inst(I), defining(def) {}
+
+    const llvm::Instruction *getInstruction() const { return inst; }
+    MemoryAccess *getDefiningAccess() const { return defining; }
+
+private:
+    const llvm::Instruction *inst;
+    MemoryAccess *defining;
+};
+
+///
+// Memory SSA form of the program. Every write to memory creates a new
+// version (MemoryDef) of the objects that it may write to and MemoryPhis
+// are placed into the iterated dominance frontiers of the blocks with
+// the definitions of the object. A call of a defined function is a (weak)
+// definition of every object that the callee may modify, the versions
+// at the function's entry are given by the versions before its call-sites.
+//
+// The uses are not renamed eagerly, the version of an object at an
+// instruction is found by walking up the dominator tree when somebody
+// asks for it. The reaching definitions are then found by walking
+// the use-def chains, without computing any data-flow maps.
+class LLVMMemorySSA
+{
+public:
+    LLVMMemorySSA(LLVMDependenceGraph *dg,
+                  LLVMPointerAnalysis *pta,
+                  bool assume_pure_funs = false);
+    ~LLVMMemorySSA();
+
+    void run();
+
+    // the version of the object that is read by the instruction @I
+    MemoryUse *getUse(const llvm::Instruction *I, const llvm::Value *obj);
+
+    // gather the instructions that may define memory
+    // [obj + off, obj + off + len] and whose definitions reach the
+    // instruction @I. Store them to @ret
+    size_t getReachingDefinitions(const llvm::Instruction *I,
+                                  const llvm::Value *obj,
+                                  const Offset& off, const Offset& len,
+                                  std::set<llvm::Value *>& ret);
+
+    size_t getDefsNum() const { return defs.size(); }
+    size_t getPhisNum() const { return phis.size(); }
+
+private:
+    struct BlockInfo {
+        BlockInfo() : dg(nullptr) {}
+
+        LLVMDependenceGraph *dg;
+        // definitions of the objects in the block, in the order
+        // of the instructions
+        std::unordered_map<const llvm::Value *, std::vector<MemoryDef *>> defs;
+        std::unordered_map<const llvm::Value *, MemoryPhi *> phis;
+        // the version of the object at the beginning of the block
+        std::unordered_map<const llvm::Value *, MemoryAccess *> entry;
+    };
+
+    struct FunctionInfo {
+        // immediate dominators of the blocks
+        std::unordered_map<LLVMBBlock *, LLVMBBlock *> idom;
+        // blocks that end with a return
+        std::vector<LLVMBBlock *> returns;
+        // objects that the function (or its callees) may define
+        std::set<const llvm::Value *> mod;
+        // local variables that are not address taken,
+        // every call of the function has its own
+        std::set<const llvm::Value *> locals;
+        std::unordered_map<const llvm::Value *, MemoryLiveOnEntry *> onEntry;
+    };
+
+    LLVMDependenceGraph *dg;
+    LLVMPointerAnalysis *PTA;
+    const llvm::DataLayout *DL;
+    bool assume_pure_functions;
+
+    std::unordered_map<LLVMDependenceGraph *, FunctionInfo> functions;
+    std::unordered_map<LLVMBBlock *, BlockInfo> blocks;
+    // block and position in the block of the instructions
+    // that read or write memory
+    std::unordered_map<const llvm::Value *,
+                       std::pair<LLVMBBlock *, unsigned>> positions;
+
+    std::vector<std::unique_ptr<MemoryDef>> defs;
+    std::vector<std::unique_ptr<MemoryPhi>> phis;
+    std::vector<std::unique_ptr<MemoryLiveOnEntry>> liveOnEntry;
+    std::map<std::pair<const llvm::Value *, const llvm::Value *>,
+             std::unique_ptr<MemoryUse>> uses;
+
+    MemoryDef *addDef(LLVMBBlock *B, const llvm::Instruction *I, unsigned order,
+                      const llvm::Value *obj, const Offset& off, const Offset& len,
+                      bool strong_update);
+    void addStoreDefs(LLVMBBlock *B, const llvm::StoreInst *SI, unsigned order);
+    void addCallDefs(LLVMBBlock *B, LLVMNode *node, unsigned order);
+    void addUndefinedCallDefs(LLVMBBlock *B, const llvm::CallInst *CI,
+                              unsigned order);
+    void addIntrinsicCallDefs(LLVMBBlock *B, const llvm::CallInst *CI,
+                              unsigned order);
+
+    void buildDefs(LLVMDependenceGraph *graph);
+    void computeDominators(LLVMDependenceGraph *graph);
+    void computeMod();
+    void addCallsOfDefinedFunctions(LLVMDependenceGraph *graph);
+    void placePhis(LLVMDependenceGraph *graph);
+
+    MemoryAccess *getLiveOnEntry(LLVMDependenceGraph *graph,
+                                 const llvm::Value *obj);
+    MemoryAccess *getEntryVersion(LLVMBBlock *B, const llvm::Value *obj);
+    MemoryAccess *getExitVersion(LLVMBBlock *B, const llvm::Value *obj);
+    MemoryAccess *getDefiningAccess(MemoryDef *def);
+    MemoryAccess *getVersionBefore(const llvm::Value *I, const llvm::Value *obj);
+    const std::vector<MemoryAccess *>& getIncoming(MemoryPhi *phi);
+};
+
+} // namespace mssa
+} // namespace analysis
+} // namespace dg
+
+#endif // _LLVM_DG_MEMORY_SSA_H_
@@ -1,3 +1,7 @@
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
 // ignore unused parameters in LLVM libraries
 #if (__clang__)
 #pragma clang diagnostic push
@@ -8,7 +12,6 @@
 #endif
 
 #include <llvm/IR/Function.h>
-#include <llvm/Analysis/PostDominators.h>
 
 #if (__clang__)
 #pragma clang diagnostic pop // ignore -Wunused-parameter
@@ -16,97 +19,74 @@
 #pragma GCC diagnostic pop
 #endif
 
-#include "analysis/BFS.h"
-#include "analysis/PostDominanceFrontiers.h"
+#include "ADT/ThreadPool.h"
+#include "analysis/PostDominators.h"
 
 #include "llvm/LLVMDependenceGraph.h"
 
 namespace dg {
 
-void LLVMDependenceGraph::computePostDominators(bool addPostDomFrontiers)
+void LLVMDependenceGraph::computePostDominators(bool addPostDomFrontiers,
+                                                unsigned threads)
 {
-    using namespace llvm;
-    // iterate over all functions
-    for (auto& F : getConstructedFunctions()) {
-        analysis::PostDominanceFrontiers<LLVMNode> pdfrontiers;
-
-        // root of post-dominator tree
-        LLVMBBlock *root = nullptr;
-        Value *val = const_cast<Value *>(F.first);
-        Function& f = *cast<Function>(val);
-        PostDominatorTree *pdtree;
-
-#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 9))
-        pdtree = new PostDominatorTree();
-        // compute post-dominator tree for this function
-        pdtree->runOnFunction(f);
-#else
-        PostDominatorTreeAnalysis PDT;
-        FunctionAnalysisManager DummyFAM;
-        pdtree = new PostDominatorTree(PDT.run(f, DummyFAM));
-#endif
+    std::vector<LLVMDependenceGraph *> graphs;
+    for (auto& F : getConstructedFunctions())
+        graphs.push_back(F.second);
+
+    // the post-dominators are intraprocedural,
+    // so we can compute the functions in parallel
+    ADT::ThreadPool pool(threads);
+    pool.parallelFor(graphs.size(), [&graphs, addPostDomFrontiers](size_t i) {
+        graphs[i]->computeFunctionPostDominators(addPostDomFrontiers);
+    });
+}
+
+void LLVMDependenceGraph::computeFunctionPostDominators(bool addPostDomFrontiers)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    analysis::PostDominators<LLVMNode> pdoms;
+    auto& our_blocks = getBlocks();
+    for (auto& it : our_blocks)
+        pdoms.addBlock(it.second);
 
-        // add immediate post-dominator edges
-        auto& our_blocks = F.second->getBlocks();
-        bool built = false;
-        for (auto& it : our_blocks) {
-            LLVMBBlock *BB = it.second;
-            BasicBlock *B = cast<BasicBlock>(const_cast<Value *>(it.first));
-            DomTreeNode *N = pdtree->getNode(B);
-            // when function contains infinite loop, we're screwed
-            // and we don't have anything
-            // FIXME: just check for the root,
-            // don't iterate over all blocks, stupid...
-            if (!N)
-                continue;
-
-            DomTreeNode *idom = N->getIDom();
-            BasicBlock *idomBB = idom ? idom->getBlock() : nullptr;
-            built = true;
-
-            if (idomBB) {
-                LLVMBBlock *pb = our_blocks[idomBB];
-                assert(pb && "Do not have constructed BB");
-                BB->setIPostDom(pb);
-                assert(cast<BasicBlock>(BB->getKey())->getParent()
-                        == cast<BasicBlock>(pb->getKey())->getParent()
-                        && "BBs are from diferent functions");
-            // if we do not have idomBB, then the idomBB is a root BB
-            } else {
-                // PostDominatorTree may has special root without BB set
-                // or it is the node without immediate post-dominator
-                if (!root) {
-                    root = new LLVMBBlock();
-                    root->setKey(nullptr);
-                    F.second->setPostDominatorTreeRoot(root);
-                }
-
-                BB->setIPostDom(root);
-            }
-        }
-
-        // well, if we haven't built the pdtree, this is probably infinite loop
-        // that has no pdtree. Until we have anything better, just add sound control
-        // edges that are not so precise - to predecessors.
-        if (!built && addPostDomFrontiers) {
-            for (auto& it : our_blocks) {
-                LLVMBBlock *BB = it.second;
-                for (const LLVMBBlock::BBlockEdge& succ : BB->successors()) {
-                    // in this case we add only the control dependencies,
-                    // since we have no pd frontiers
-                    BB->addControlDependence(succ.target);
-                }
-            }
-        }
-
-        if (addPostDomFrontiers) {
-            // assert(root && "BUG: must have root");
-            if (root)
-                pdfrontiers.compute(root, true /* store also control depend. */);
-        }
-
-        delete pdtree;
+    pdoms.compute();
+
+    // root of post-dominator tree
+    LLVMBBlock *root = getPostDominatorTreeRoot();
+    if (!root && !our_blocks.empty()) {
+        root = new LLVMBBlock();
+        root->setKey(nullptr);
+        setPostDominatorTreeRoot(root);
+    }
+
+    // add immediate post-dominator edges
+    for (auto& it : our_blocks) {
+        LLVMBBlock *BB = it.second;
+        LLVMBBlock *pb = pdoms.getIPostDom(BB);
+        // if we do not have the post-dominator,
+        // then the block is a root of the tree
+        BB->setIPostDom(pb ? pb : root);
     }
+
+    if (addPostDomFrontiers) {
+        // pd-frontiers are the reverse control dependencies.
+        // Gather the frontiers of the blocks first, so that we
+        // add the edges to every block at once
+        std::unordered_map<LLVMBBlock *, std::vector<LLVMBBlock *>> frontiers;
+        pdoms.computeFrontiers([&frontiers](LLVMBBlock *BB,
+                                            const std::vector<LLVMBBlock *>& deps) {
+            BB->addControlDependencies(deps.begin(), deps.end());
+            for (LLVMBBlock *dep : deps)
+                frontiers[dep].push_back(BB);
+        });
+
+        for (auto& it : frontiers)
+            it.first->addPostDomFrontiers(it.second.begin(), it.second.end());
+    }
+
+    cdTime += std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
 }
 
 } // namespace dg
@@ -199,44 +199,10 @@ RDNode *LLVMRDBuilder::createRealloc(const llvm::Instruction *Inst)
     // from previous memory
     node->addDef(node, 0, size, false /* strong update */);
 
+    indexDefinitions(node);
     return node;
 }
 
-static void getLocalVariables(const llvm::Function *F,
-                              std::set<const llvm::Value *>& ret)
-{
-    using namespace llvm;
-
-    // get all alloca insts that are not address taken
-    // (are not stored into a pointer)
-    // -- that means that they can not be used outside of
-    // this function
-    for (const BasicBlock& block : *F) {
-        for (const Instruction& Inst : block) {
-            if (isa<AllocaInst>(&Inst)) {
-                bool is_address_taken = false;
-                for (auto I = Inst.use_begin(), E = Inst.use_end();
-                     I != E; ++I) {
-#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
-                    const llvm::Value *use = *I;
-#else
-                    const llvm::Value *use = I->getUser();
-#endif
-                    const StoreInst *SI = dyn_cast<StoreInst>(use);
-                    // is the value operand our alloca?
-                    if (SI && SI->getValueOperand() == &Inst) {
-                        is_address_taken = true;
-                        break;
-                    }
-                }
-
-                if (!is_address_taken)
-                    ret.insert(&Inst);
-            }
-        }
-    }
-}
-
 RDNode *LLVMRDBuilder::createReturn(const llvm::Instruction *Inst)
 {
     RDNode *node = new RDNode(RETURN);
@@ -245,8 +211,7 @@ RDNode *LLVMRDBuilder::createReturn(const llvm::Instruction *Inst)
     // FIXME: don't do that for every return instruction,
     // compute it only once for a function
     std::set<const llvm::Value *> locals;
-    getLocalVariables(Inst->getParent()->getParent(),
-                      locals);
+    llvmutils::getLocalVariables(Inst->getParent()->getParent(), locals);
 
     for (const llvm::Value *ptrVal : locals) {
         RDNode *ptrNode = getOperand(ptrVal);
@@ -317,6 +282,7 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
         // NOTE: maybe this is a bit strong to say unknown memory,
         // but better be sound then incorrect
         node->addDef(UNKNOWN_MEMORY);
+        indexDefinitions(node);
         return node;
     }
 
@@ -340,7 +306,6 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
         if (!ptrNode) {
             // keeping such set is faster then printing it all to terminal
             // ... and we don't flood the terminal that way
-            static std::set<const llvm::Value *> warned;
             if (warned.insert(ptrVal).second) {
                 llvm::errs() << *ptrVal << "\n";
                 llvm::errs() << "Don't have created node for pointer's target\n";
@@ -382,6 +347,7 @@ RDNode *LLVMRDBuilder::createStore(const llvm::Instruction *Inst)
     }
 
     assert(node);
+    indexDefinitions(node);
     return node;
 }
 
@@ -561,6 +527,8 @@ LLVMRDBuilder::createCallToFunction(const llvm::Function *F)
     callNode->addSuccessor(root);
     ret->addSuccessor(returnNode);
 
+    callsites.emplace_back(callNode, returnNode, root);
+
     return std::make_pair(callNode, returnNode);
 }
 
@@ -677,6 +645,7 @@ RDNode *LLVMRDBuilder::createUndefinedCall(const llvm::CallInst *CInst)
     // of all global variables, so we should perform a write to
     // unknown memory instead of the loop above
 
+    indexDefinitions(node);
     return node;
 }
 
@@ -705,6 +674,7 @@ RDNode *LLVMRDBuilder::createIntrinsicCall(const llvm::CallInst *CInst)
             // as ALLOC in points-to, so we can have
             // reaching definitions to that
             ret->addDef(ret, 0, UNKNOWN_OFFSET);
+            indexDefinitions(ret);
             return ret;
         default:
             return createUndefinedCall(CInst);
@@ -747,6 +717,7 @@ RDNode *LLVMRDBuilder::createIntrinsicCall(const llvm::CallInst *CInst)
         ret->addDef(target, from, to, true /* strong update */);
     }
 
+    indexDefinitions(ret);
     return ret;
 }
 
@@ -933,6 +904,25 @@ std::pair<RDNode *, RDNode *> LLVMRDBuilder::buildGlobals()
     return std::pair<RDNode *, RDNode *>(first, cur);
 }
 
+void LLVMReachingDefinitions::computeSummaries()
+{
+    summaries = std::unique_ptr<RDSummaries>(
+        new RDSummaries(strong_update_unknown, max_set_size));
+
+    for (const auto& it : builder->getSubgraphs())
+        summaries->addProcedure(it.second.root, it.second.ret);
+
+    for (const LLVMRDBuilder::CallSite& cs : builder->getCallSites())
+        summaries->addCallSite(cs.call, cs.ret, cs.callee);
+
+    // the fixpoint processes only the nodes reachable from the root,
+    // we must not seed definitions anywhere else
+    std::set<RDNode *> reachable;
+    RDA->getNodes(reachable);
+
+    summaries->run(reachable, threads);
+}
+
 } // namespace rd
 } // namespace analysis
 } // namespace dg
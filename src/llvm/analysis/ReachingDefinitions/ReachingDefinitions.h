@@ -1,6 +1,7 @@
 #ifndef _LLVM_DG_RD_H_
 #define _LLVM_DG_RD_H_
 
+#include <set>
 #include <unordered_map>
 #include <memory>
 
@@ -9,12 +10,21 @@
 #include <llvm/IR/Constants.h>
 
 #include "analysis/ReachingDefinitions/ReachingDefinitions.h"
+#include "analysis/ReachingDefinitions/RDSummaries.h"
+#include "analysis/ReachingDefinitions/RDDemand.h"
 #include "llvm/analysis/PointsTo/PointsTo.h"
 
 namespace dg {
 namespace analysis {
 namespace rd {
 
+enum RD_ALG {
+    // compute the reaching definitions for the whole program
+    EAGER,
+    // compute the reaching definitions only when asked for them
+    DEMAND,
+};
+
 class LLVMRDBuilder
 {
     const llvm::Module *M;
@@ -22,6 +32,7 @@ class LLVMRDBuilder
     std::string entryFunction;
     bool assume_pure_functions;
 
+public:
     struct Subgraph {
         Subgraph(RDNode *r1, RDNode *r2)
             : root(r1), ret(r2) {}
@@ -31,6 +42,18 @@ class LLVMRDBuilder
         RDNode *ret;
     };
 
+    // call of a defined function: the call node has an edge
+    // to the callee's root and the callee returns to the ret node
+    struct CallSite {
+        CallSite(RDNode *c, RDNode *r, RDNode *cl)
+            : call(c), ret(r), callee(cl) {}
+
+        RDNode *call;
+        RDNode *ret;
+        RDNode *callee;
+    };
+
+private:
     // points-to information
     dg::LLVMPointerAnalysis *PTA;
 
@@ -45,9 +68,16 @@ class LLVMRDBuilder
 
     // map of all built subgraphs - the value type is a pair (root, return)
     std::unordered_map<const llvm::Value *, Subgraph> subgraphs_map;
+    // all calls of defined functions
+    std::vector<CallSite> callsites;
+    // inverted index: memory object -> nodes that define it
+    // (stores and calls of undefined functions and intrinsics)
+    std::unordered_map<const RDNode *, std::vector<RDNode *>> definitions;
     // list of dummy nodes (used just to keep the track of memory,
     // so that we can delete it later)
     std::vector<RDNode *> dummy_nodes;
+    // the pointers without a node that we warned about
+    std::set<const llvm::Value *> warned;
 public:
     LLVMRDBuilder(const llvm::Module *m,
                   dg::LLVMPointerAnalysis *p,
@@ -84,6 +114,29 @@ public:
         return it->second;
     }
 
+    const std::unordered_map<const llvm::Value *, Subgraph>&
+                                getSubgraphs() const { return subgraphs_map; }
+    const std::vector<CallSite>& getCallSites() const { return callsites; }
+
+    const Subgraph *getSubgraph(const llvm::Value *F) const
+    {
+        auto it = subgraphs_map.find(F);
+        if (it == subgraphs_map.end())
+            return nullptr;
+
+        return &it->second;
+    }
+
+    // get the nodes that may define the memory object @target
+    const std::vector<RDNode *> *getDefinitions(const RDNode *target) const
+    {
+        auto it = definitions.find(target);
+        if (it == definitions.end())
+            return nullptr;
+
+        return &it->second;
+    }
+
     RDNode *getOperand(const llvm::Value *val);
     RDNode *createNode(const llvm::Instruction& Inst);
 
@@ -94,6 +147,19 @@ private:
         node->setUserData(const_cast<llvm::Value *>(val));
     }
 
+    // put the node into the index of definitions
+    // (call this once the node has all its def-sites)
+    void indexDefinitions(RDNode *node)
+    {
+        // def-sites are sorted by the target,
+        // so we won't add the node twice
+        for (const DefSite& ds : node->getDefines()) {
+            std::vector<RDNode *>& defs = definitions[ds.target];
+            if (defs.empty() || defs.back() != node)
+                defs.push_back(node);
+        }
+    }
+
     RDNode *createStore(const llvm::Instruction *Inst);
     RDNode *createAlloc(const llvm::Instruction *Inst);
     RDNode *createDynAlloc(const llvm::Instruction *Inst, int type);
@@ -119,10 +185,18 @@ class LLVMReachingDefinitions
 {
     std::unique_ptr<LLVMRDBuilder> builder;
     std::unique_ptr<ReachingDefinitionsAnalysis> RDA;
+    std::unique_ptr<RDSummaries> summaries;
+    std::unique_ptr<DemandReachingDefinitions> demand;
     RDNode *root;
     bool strong_update_unknown;
     uint32_t max_set_size;
     bool assume_pure_functions;
+    // number of threads for computing the summaries,
+    // 0 means that we do not use summaries at all
+    unsigned threads;
+    RD_ALG algorithm;
+
+    void computeSummaries();
 
 public:
     LLVMReachingDefinitions(const llvm::Module *m,
@@ -130,24 +204,73 @@ public:
                             bool strong_updt_unknown = false,
                             bool pure_funs = false,
                             uint32_t max_set_sz = ~((uint32_t) 0),
+                            unsigned thrds = 0,
+                            RD_ALG alg = EAGER,
                             std::string entryFunction = "main")
         : builder(std::unique_ptr<LLVMRDBuilder>(new LLVMRDBuilder(m, pta, entryFunction, pure_funs))),
-          strong_update_unknown(strong_updt_unknown), max_set_size(max_set_sz) {}
+          strong_update_unknown(strong_updt_unknown), max_set_size(max_set_sz),
+          threads(thrds), algorithm(alg) {}
 
     void run()
     {
         root = builder->build();
+
+        // just build the graph, the definitions
+        // are computed when somebody asks for them
+        if (algorithm == DEMAND) {
+            demand = std::unique_ptr<DemandReachingDefinitions>(
+                new DemandReachingDefinitions(root, strong_update_unknown, max_set_size)
+                );
+            return;
+        }
+
         RDA = std::unique_ptr<ReachingDefinitionsAnalysis>(
             new ReachingDefinitionsAnalysis(root, strong_update_unknown, max_set_size)
             );
+
+        // compute the definitions function-wise, then we do not
+        // need the fixpoint over the whole program.
+        // The summaries do not work with bounded sets
+        if (threads > 0 && max_set_size == ~((uint32_t) 0)) {
+            computeSummaries();
+            return;
+        }
+
         RDA->run();
     }
 
+    // mod/ref summary of a function, available only when
+    // the analysis was run with summaries
+    const RDSummary *getSummary(const llvm::Function *F) const
+    {
+        if (!summaries)
+            return nullptr;
+
+        const LLVMRDBuilder::Subgraph *subg = builder->getSubgraph(F);
+        if (!subg)
+            return nullptr;
+
+        return summaries->getSummary(subg->root);
+    }
+
     RDNode *getNode(const llvm::Value *val)
     {
         return builder->getNode(val);
     }
 
+    // the root and the return node of the function
+    const LLVMRDBuilder::Subgraph *getSubgraph(const llvm::Function *F) const
+    {
+        return builder->getSubgraph(F);
+    }
+
+    const std::unordered_map<const llvm::Value *, LLVMRDBuilder::Subgraph>&
+                                getSubgraphs() const
+    { return builder->getSubgraphs(); }
+
+    const std::vector<LLVMRDBuilder::CallSite>& getCallSites() const
+    { return builder->getCallSites(); }
+
     // let the user get the nodes map, so that we can
     // map the points-to informatio back to LLVM nodes
     const std::unordered_map<const llvm::Value *, RDNode *>&
@@ -163,6 +286,12 @@ public:
         return builder->getMapping(val);
     }
 
+    // nodes that may define the memory object
+    const std::vector<RDNode *> *getDefinitions(const RDNode *target) const
+    {
+        return builder->getDefinitions(target);
+    }
+
     void getNodes(std::set<RDNode *>& cont)
     {
         assert(RDA);
@@ -171,6 +300,21 @@ public:
         RDA->getNodes(cont);
     }
 
+    RD_ALG getAlgorithm() const { return algorithm; }
+
+    // gather definitions of memory [target + off, target + off + len]
+    // that reach the node @where and store them to @ret.
+    // This works with both eager and demand-driven algorithm
+    size_t getReachingDefinitions(RDNode *where, RDNode *target,
+                                  const Offset& off, const Offset& len,
+                                  std::set<RDNode *>& ret)
+    {
+        if (demand)
+            return demand->get(where, target, off, len, ret);
+
+        return where->getReachingDefinitions(target, off, len, ret);
+    }
+
     const RDMap& getReachingDefinitions(RDNode *n) const { return n->getReachingDefinitions(); }
     RDMap& getReachingDefinitions(RDNode *n) { return n->getReachingDefinitions(); }
     size_t getReachingDefinitions(RDNode *n, const Offset& off,
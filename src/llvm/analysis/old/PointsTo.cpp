@@ -522,10 +522,9 @@ bool LLVMPointsToAnalysis::handleFunctionPtrCall(LLVMNode *calledFuncNode,
         // differently
         // NOTE: must call it before buildSubgraph, because buildSubgraph
         // will add it to constructedFunctions
-        auto cf = getConstructedFunctions();
-        bool isnew = cf.count(func) == 0;
-
         LLVMDependenceGraph *dg = node->getDG();
+        bool isnew = dg->getConstructedFunctions().count(func) == 0;
+
         LLVMDependenceGraph *subg = dg->buildSubgraph(node, func);
         LLVMNode *entry = subg->getEntry();
         dg->addGlobalNode(entry);
@@ -1,6 +1,9 @@
 #ifndef _DG_LLVM_UTILS_H_
 #define _DG_LLVM_UTILS_H_
 
+#include <set>
+
+#include <llvm/Config/llvm-config.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Instructions.h>
@@ -75,6 +78,42 @@ inline bool callIsCompatible(const Function *F, const CallInst *CI)
     return true;
 }
 
+/* ----------------------------------------------
+ * -- MEMORY
+ * ---------------------------------------------- */
+
+// get all alloca insts of the function that are not address taken
+// (are not stored into a pointer) -- that means that they can not
+// be used outside of this function
+inline void getLocalVariables(const Function *F,
+                              std::set<const Value *>& ret)
+{
+    for (const BasicBlock& block : *F) {
+        for (const Instruction& Inst : block) {
+            if (!isa<AllocaInst>(&Inst))
+                continue;
+
+            bool is_address_taken = false;
+            for (auto I = Inst.use_begin(), E = Inst.use_end(); I != E; ++I) {
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+                const llvm::Value *use = *I;
+#else
+                const llvm::Value *use = I->getUser();
+#endif
+                const StoreInst *SI = dyn_cast<StoreInst>(use);
+                // is the value operand our alloca?
+                if (SI && SI->getValueOperand() == &Inst) {
+                    is_address_taken = true;
+                    break;
+                }
+            }
+
+            if (!is_address_taken)
+                ret.insert(&Inst);
+        }
+    }
+}
+
 } // namespace llvmutils
 } // namespace dg
 
@@ -1,10 +1,16 @@
+#include <algorithm>
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <vector>
 
 #include "test-runner.h"
 
 #include "ADT/Queue.h"
+#include "ADT/Bitvector.h"
+#include "ADT/SmallBitvector.h"
+#include "ADT/DenseNodesMap.h"
+#include "ADT/DGContainer.h"
 
 using namespace dg::ADT;
 
@@ -99,6 +105,287 @@ public:
     }
 };
 
+class TestDenseNodesMap : public Test
+{
+public:
+    TestDenseNodesMap() : Test("test dense nodes map")
+    {}
+
+    void test()
+    {
+        DenseNodesMap<int, int> map;
+        check(map.empty(), "empty map not empty");
+
+        check(map.insert(std::make_pair(13, 1)).second, "insert failed");
+        check(map.insert(std::make_pair(4, 2)).second, "insert failed");
+        check(map.emplace(7, 3).second, "emplace failed");
+        check(!map.insert(std::make_pair(4, 5)).second, "inserted twice");
+        check(map.size() == 3, "BUG in size");
+        check(map[4] == 2, "Wrong value");
+        check(map.count(7) == 1, "Do not have an element");
+        check(map.find(8) == map.end(), "Found a non-existing element");
+
+        // iterate in the order of insertion
+        int order[] = {13, 4, 7};
+        int i = 0;
+        for (auto& it : map)
+            check(it.first == order[i++], "Wrong iteration order");
+        check(i == 3, "Wrong number of iterated elements");
+
+        // the entries are numbered in the order of insertion
+        check(map.at(1)->first == 4, "Wrong entry with a number");
+        check(map.at(3) == map.end(), "Have a non-existing number");
+
+        // erasing while iterating must keep the iterators valid
+        for (auto I = map.begin(), E = map.end(); I != E; ++I) {
+            if (I->first == 4)
+                map.erase(I);
+        }
+
+        check(map.at(1) == map.end(), "Have an erased number");
+
+        check(map.size() == 2, "BUG in size after erase");
+        check(map.count(4) == 0, "Did not erase an element");
+        check(map.erase(4) == 0, "Erased an element twice");
+        check(map.erase(13) == 1, "Did not erase an element");
+
+        i = 0;
+        for (auto& it : map) {
+            check(it.first == 7, "Iterated over an erased element");
+            ++i;
+        }
+        check(i == 1, "Wrong number of iterated elements");
+
+        // operator[] creates the element
+        map[4] = 10;
+        check(map.size() == 2, "BUG in size after re-insert");
+        check(map.find(4)->second == 10, "Wrong value");
+
+        // erase returns the next element
+        auto it = map.erase(map.find(7));
+        check(it->first == 4, "Wrong iterator after erase");
+        check(map.erase(it) == map.end(), "Wrong iterator after erase");
+        check(map.empty(), "BUG in size after erase");
+
+        // the erased entries stay until compact() drops them
+        for (int n = 0; n < 100; ++n) {
+            map[n] = n;
+            if (n % 2)
+                map.erase(n);
+        }
+
+        check(map.size() == 50, "BUG in size");
+        check(map.getErasedNum() == 54, "Wrong number of erased entries");
+        map.compact();
+        check(map.getErasedNum() == 0, "Did not drop erased entries");
+        check(map.size() == 50, "BUG in size after compact");
+
+        i = 0;
+        for (auto& it : map) {
+            check(it.first == 2 * i, "Wrong order after compact");
+            check(map.at(i)->first == 2 * i, "Wrong number after compact");
+            check(map.find(2 * i)->second == 2 * i, "Wrong value after compact");
+            ++i;
+        }
+        check(i == 50, "Wrong number of iterated elements");
+        check(map.at(50) == map.end(), "Have a non-existing number");
+    }
+};
+
+class TestDGContainer : public Test
+{
+public:
+    TestDGContainer() : Test("test DGContainer")
+    {}
+
+    void test()
+    {
+        // 4 elements are stored inline, the rest on the heap
+        DGContainer<int, 4> cont;
+        check(cont.empty(), "empty container not empty");
+
+        int elems[] = {8, 3, 5, 1, 9, 7, 2, 6, 4, 0};
+        for (int i = 0; i < 10; ++i) {
+            check(cont.insert(elems[i]), "insert failed");
+            check(!cont.insert(elems[i]), "inserted twice");
+            check(cont.size() == (size_t) i + 1, "BUG in size");
+
+            // the elements must be sorted all the time
+            int last = -1;
+            for (int n : cont) {
+                check(n > last, "Wrong iteration order");
+                last = n;
+            }
+        }
+
+        for (int i = 0; i < 10; ++i)
+            check(cont.contains(i), "Do not have an element");
+        check(!cont.contains(10), "Have a non-existing element");
+
+        check(cont.erase(5) == 1, "Did not erase an element");
+        check(cont.erase(5) == 0, "Erased an element twice");
+        check(!cont.contains(5), "Have an erased element");
+        check(cont.size() == 9, "BUG in size after erase");
+
+        DGContainer<int, 4> cont2;
+        cont2.insert(0);
+        cont2.insert(5);
+        cont2.insert(9);
+        cont2.insert(11);
+
+        cont.intersect(cont2);
+        check(cont.size() == 2, "BUG in intersect");
+        check(cont.contains(0) && cont.contains(9), "BUG in intersect");
+
+        cont.swap(cont2);
+        check(cont.size() == 4 && cont2.size() == 2, "BUG in swap");
+        check(cont.contains(11) && !cont2.contains(11), "BUG in swap");
+
+        DGContainer<int, 4> cont3;
+        cont3.insert(9);
+        cont3.insert(0);
+        check(cont2 == cont3, "containers with same content does not equal");
+
+        cont.clear();
+        check(cont.empty(), "cleared container not empty");
+        check(cont.begin() == cont.end(), "cleared container not empty");
+
+        // insert a range, the duplicates are skipped
+        int range[] = {7, 1, 3, 1, 5};
+        check(cont.insert(range, range + 5) == 4, "BUG in range insert");
+        check(cont.size() == 4, "BUG in size after range insert");
+        check(cont.insert(range, range + 5) == 0, "inserted a range twice");
+
+        check(cont.insert(elems, elems + 10) == 6, "BUG in range insert");
+        check(cont.size() == 10, "BUG in size after range insert");
+        int last = -1;
+        for (int n : cont) {
+            check(n == last + 1, "Wrong content after range insert");
+            last = n;
+        }
+
+        // copies own their elements, both inline and on the heap
+        DGContainer<int, 4> copy(cont), small(cont3);
+        check(copy == cont && small == cont3, "BUG in copy");
+        copy.erase(3);
+        check(cont.contains(3), "copy shares the elements");
+        small = copy;
+        check(small == copy && small.size() == 9, "BUG in assignment");
+
+        DGContainer<int, 4> moved(std::move(small));
+        check(moved.size() == 9 && moved.contains(9), "BUG in move");
+
+        // a frozen container refers to the storage until it is modified
+        std::vector<int> storage;
+        storage.reserve(moved.size() + cont3.size());
+        moved.freeze(storage);
+        cont3.freeze(storage);
+        check(moved.isFrozen() && moved.size() == 9 && moved.contains(9),
+              "BUG in freeze");
+        check(moved.insert(3) && !moved.isFrozen() && moved.size() == 10,
+              "BUG in thaw");
+        check(cont3.erase(9) == 1 && cont3.size() == 1 && cont3.contains(0),
+              "BUG in thaw of inline elements");
+        check(storage.size() == 11 && storage[10] == 9,
+              "modified the frozen storage");
+    }
+};
+
+class TestBitvector : public Test
+{
+public:
+    TestBitvector() : Test("test Bitvector")
+    {}
+
+    void test()
+    {
+        ADT::Bitvector B(200);
+        check(B.empty(), "new bitvector not empty");
+        check(B.size() == 200, "BUG in size");
+
+        size_t bits[] = {199, 0, 64, 63, 130, 1};
+        for (size_t i : bits) {
+            check(B.set(i), "set failed");
+            check(!B.set(i), "set twice");
+            check(B.test(i), "do not have a set bit");
+        }
+
+        check(!B.test(2) && !B.test(65), "have a bit that was not set");
+        check(B.count() == 6, "BUG in count");
+
+        std::vector<size_t> found;
+        B.forEach([&found](size_t i) { found.push_back(i); });
+        size_t expected[] = {0, 1, 63, 64, 130, 199};
+        check(found.size() == 6 && std::equal(found.begin(), found.end(),
+                                              expected),
+              "Wrong iteration");
+
+        B.reset(64);
+        check(!B.test(64) && B.count() == 5, "BUG in reset");
+
+        // shrinking drops the bits
+        B.resize(100);
+        check(B.count() == 3, "BUG in resize");
+        B.resize(200);
+        check(!B.test(130) && !B.test(199), "have a dropped bit");
+
+        B.clear();
+        check(B.empty() && B.size() == 200, "BUG in clear");
+
+        // merging a bigger vector makes this one bigger
+        ADT::Bitvector C(10), D(300);
+        C.set(5);
+        D.set(5);
+        D.set(299);
+        check(C.merge(D) && C.size() == 300, "BUG in merge");
+        check(C.test(5) && C.test(299) && C.count() == 2, "BUG in merge");
+        check(!C.merge(D), "merge added bits twice");
+
+        D.set(100);
+        C.intersect(D);
+        check(C.test(5) && C.test(299) && !C.test(100) && C.count() == 2,
+              "BUG in intersect");
+        D.resize(64);
+        C.intersect(D);
+        check(C.test(5) && !C.test(299) && C.size() == 300,
+              "BUG in intersect with a smaller set");
+    }
+};
+
+class TestSmallBitvector : public Test
+{
+public:
+    TestSmallBitvector() : Test("test SmallBitvector")
+    {}
+
+    void test()
+    {
+        ADT::SmallBitvector A, B;
+        check(A.empty(), "new bitvector not empty");
+
+        check(A.set(3) && A.set(63), "set failed");
+        check(!A.set(3), "set twice");
+        check(!A.test(64) && !A.test(1000), "have a bit that was not set");
+
+        // the bits above 64 are allocated on demand
+        check(B.set(200) && B.set(3) && B.set(64), "set failed");
+        check(B.test(200) && B.test(64), "do not have a set bit");
+        check(B.count() == 3, "BUG in count");
+
+        check(A.merge(B), "merge did not add bits");
+        check(!A.merge(B), "merge added bits twice");
+        check(!B.merge(ADT::SmallBitvector()), "merged an empty set");
+        check(A.count() == 4, "BUG in merge");
+
+        std::vector<size_t> found;
+        A.forEach([&found](size_t i) { found.push_back(i); });
+        size_t expected[] = {3, 63, 64, 200};
+        check(found.size() == 4 && std::equal(found.begin(), found.end(),
+                                              expected),
+              "Wrong iteration");
+    }
+};
+
 }; // namespace tests
 }; // namespace dg
 
@@ -110,6 +397,10 @@ int main()
     Runner.add(new TestLIFO());
     Runner.add(new TestFIFO());
     Runner.add(new TestPrioritySet());
+    Runner.add(new TestDenseNodesMap());
+    Runner.add(new TestDGContainer());
+    Runner.add(new TestBitvector());
+    Runner.add(new TestSmallBitvector());
 
     return Runner();
 }
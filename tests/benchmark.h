@@ -0,0 +1,171 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace dg {
+namespace tests {
+
+// measures only the part of a benchmark run between start() and stop(),
+// so that preparing the workload is not counted
+class Stopwatch
+{
+    std::chrono::steady_clock::time_point s;
+    std::chrono::nanoseconds total{0};
+
+public:
+    void start() { s = std::chrono::steady_clock::now(); }
+    void stop() { total += std::chrono::steady_clock::now() - s; }
+
+    double nanoseconds() const { return (double) total.count(); }
+};
+
+// the benchmarks get a random generator seeded with the seed
+// and the number of the repetition, so that the workloads are the
+// same for every run of the benchmarks (with the same seed)
+typedef std::mt19937_64 RandomT;
+
+// the body of a benchmark. It prepares the workload, measures
+// the interesting part with the stopwatch and returns the number
+// of operations that it measured
+typedef std::function<uint64_t(RandomT&, Stopwatch&)> BenchmarkT;
+
+struct BenchmarkResult
+{
+    std::string name;
+    std::string params;
+    uint64_t ops;
+    // nanoseconds per operation in every repetition
+    std::vector<double> samples;
+
+    double min() const { return *std::min_element(samples.begin(), samples.end()); }
+    double max() const { return *std::max_element(samples.begin(), samples.end()); }
+
+    double mean() const
+    {
+        double sum = 0;
+        for (double s : samples)
+            sum += s;
+
+        return sum / samples.size();
+    }
+
+    double median() const
+    {
+        std::vector<double> tmp(samples);
+        std::sort(tmp.begin(), tmp.end());
+
+        size_t n = tmp.size();
+        if (n % 2 == 0)
+            return (tmp[n / 2 - 1] + tmp[n / 2]) / 2;
+
+        return tmp[n / 2];
+    }
+
+    double stddev() const
+    {
+        if (samples.size() < 2)
+            return 0;
+
+        double m = mean();
+        double sum = 0;
+        for (double s : samples)
+            sum += (s - m) * (s - m);
+
+        return std::sqrt(sum / (samples.size() - 1));
+    }
+};
+
+class BenchmarkRunner
+{
+    unsigned repetitions;
+    uint64_t seed;
+    // run only the benchmarks whose name contains this string
+    std::string filter;
+
+    std::vector<BenchmarkResult> results;
+
+public:
+    BenchmarkRunner(unsigned reps = 10, uint64_t sd = 0,
+                    const std::string& flt = "")
+        : repetitions(reps), seed(sd), filter(flt) {}
+
+    void run(const std::string& name, const std::string& params,
+             const BenchmarkT& bench)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+
+        BenchmarkResult res;
+        res.name = name;
+        res.params = params;
+        res.ops = 0;
+
+        // warm-up, not counted
+        {
+            RandomT rng(seed);
+            Stopwatch sw;
+            bench(rng, sw);
+        }
+
+        for (unsigned i = 0; i < repetitions; ++i) {
+            RandomT rng(seed + i);
+            Stopwatch sw;
+
+            uint64_t ops = bench(rng, sw);
+            if (ops == 0)
+                ops = 1;
+
+            res.ops = ops;
+            res.samples.push_back(sw.nanoseconds() / ops);
+        }
+
+        fprintf(stderr, "%-28s %-28s %10.2f ns/op (min %.2f, stddev %.2f)\n",
+                name.c_str(), params.c_str(), res.median(), res.min(),
+                res.stddev());
+
+        results.push_back(std::move(res));
+    }
+
+    void dumpJSON(FILE *out) const
+    {
+        fprintf(out, "{\n");
+        fprintf(out, "  \"seed\": %lu,\n", (unsigned long) seed);
+        fprintf(out, "  \"repetitions\": %u,\n", repetitions);
+        fprintf(out, "  \"benchmarks\": [");
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& r = results[i];
+            fprintf(out, "%s\n    {\"name\": \"%s\", \"params\": \"%s\", "
+                         "\"ops\": %lu, \"unit\": \"ns/op\",\n"
+                         "     \"min\": %.3f, \"max\": %.3f, \"mean\": %.3f, "
+                         "\"median\": %.3f, \"stddev\": %.3f}",
+                    i == 0 ? "" : ",", r.name.c_str(), r.params.c_str(),
+                    (unsigned long) r.ops, r.min(), r.max(), r.mean(),
+                    r.median(), r.stddev());
+        }
+
+        fprintf(out, "\n  ]\n}\n");
+    }
+};
+
+// keep the compiler from optimizing away the results
+static volatile uint64_t benchmark_sink;
+
+inline void doNotOptimize(uint64_t val)
+{
+    benchmark_sink = benchmark_sink + val;
+}
+
+} // namespace tests
+} // namespace dg
+
+#endif // _BENCHMARK_H_
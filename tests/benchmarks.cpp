@@ -0,0 +1,411 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "benchmark.h"
+
+#include "ADT/Queue.h"
+#include "ADT/DGContainer.h"
+#include "analysis/ReachingDefinitions/RDMap.h"
+#include "analysis/ReachingDefinitions/ReachingDefinitions.h"
+#include "analysis/PointsTo/PointerSubgraph.h"
+
+namespace dg {
+namespace tests {
+
+using analysis::Offset;
+using analysis::rd::DefSite;
+using analysis::rd::DefSiteSetT;
+using analysis::rd::RDMap;
+using analysis::rd::RDNode;
+using analysis::pta::MemoryObject;
+using analysis::pta::Pointer;
+using analysis::pta::PSNode;
+
+// the workloads try to resemble what we see in real programs:
+// small structures accessed on small offsets, few definitions
+// of the same memory and small points-to sets with a long tail
+
+static uint64_t randomNum(RandomT& rng, uint64_t max)
+{
+    return std::uniform_int_distribution<uint64_t>(0, max - 1)(rng);
+}
+
+static bool randomChance(RandomT& rng, double p)
+{
+    return std::bernoulli_distribution(p)(rng);
+}
+
+// mostly small sets, sometimes a big one
+static unsigned randomSetSize(RandomT& rng, unsigned max)
+{
+    if (randomChance(rng, 0.02))
+        return max;
+
+    unsigned size = 1 + std::geometric_distribution<unsigned>(0.5)(rng);
+    return size < max ? size : max;
+}
+
+static Offset randomOffset(RandomT& rng, double unknown = 0.05)
+{
+    if (randomChance(rng, unknown))
+        return UNKNOWN_OFFSET;
+
+    return 4 * randomNum(rng, 16);
+}
+
+static void fillRDMap(RandomT& rng, RDMap& map,
+                      std::vector<RDNode>& objects,
+                      std::vector<RDNode>& definitions)
+{
+    for (RDNode& obj : objects) {
+        unsigned sites = randomSetSize(rng, 8);
+        for (unsigned i = 0; i < sites; ++i) {
+            DefSite ds(&obj, randomOffset(rng), randomChance(rng, 0.5) ? 4 : 8);
+            unsigned defs = randomSetSize(rng, 16);
+            for (unsigned j = 0; j < defs; ++j)
+                map.update(ds, &definitions[randomNum(rng, definitions.size())]);
+        }
+    }
+}
+
+static void benchRDMapMerge(BenchmarkRunner& runner, unsigned objects)
+{
+    runner.run("rdmap-merge", "objects=" + std::to_string(objects),
+               [objects](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        std::vector<RDNode> objs(objects);
+        std::vector<RDNode> defs(4 * objects);
+        const unsigned merges = 200;
+
+        std::vector<RDMap> to(merges), from(merges);
+        std::vector<DefSiteSetT> overwrites(merges);
+        for (unsigned i = 0; i < merges; ++i) {
+            fillRDMap(rng, to[i], objs, defs);
+            fillRDMap(rng, from[i], objs, defs);
+
+            // the node strong-updates some of the memory
+            for (const auto& it : to[i]) {
+                if (!it.first.offset.isUnknown() && randomChance(rng, 0.25))
+                    overwrites[i].insert(it.first);
+            }
+        }
+
+        uint64_t changed = 0;
+        sw.start();
+        for (unsigned i = 0; i < merges; ++i)
+            changed += to[i].merge(&from[i], &overwrites[i]);
+        sw.stop();
+
+        doNotOptimize(changed);
+        return merges;
+    });
+}
+
+static void benchRDMapGet(BenchmarkRunner& runner, unsigned objects)
+{
+    runner.run("rdmap-get", "objects=" + std::to_string(objects),
+               [objects](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        std::vector<RDNode> objs(objects);
+        std::vector<RDNode> defs(4 * objects);
+        RDMap map;
+        fillRDMap(rng, map, objs, defs);
+
+        const unsigned queries = 20000;
+        std::vector<DefSite> what;
+        what.reserve(queries);
+        for (unsigned i = 0; i < queries; ++i)
+            what.emplace_back(&objs[randomNum(rng, objects)],
+                              randomOffset(rng, 0.1), 4);
+
+        uint64_t found = 0;
+        std::set<RDNode *> ret;
+        sw.start();
+        for (DefSite& ds : what) {
+            ret.clear();
+            found += map.get(ds.target, ds.offset, ds.len, ret);
+        }
+        sw.stop();
+
+        doNotOptimize(found);
+        return queries;
+    });
+}
+
+static std::vector<PSNode *> createAllocs(unsigned num)
+{
+    std::vector<PSNode *> nodes;
+    nodes.reserve(num);
+    for (unsigned i = 0; i < num; ++i)
+        nodes.push_back(new PSNode(analysis::pta::ALLOC));
+
+    return nodes;
+}
+
+static void deleteNodes(std::vector<PSNode *>& nodes)
+{
+    for (PSNode *n : nodes)
+        delete n;
+}
+
+static std::set<Pointer> randomPointsTo(RandomT& rng, std::vector<PSNode *>& targets)
+{
+    std::set<Pointer> pts;
+    unsigned size = randomSetSize(rng, 64);
+    for (unsigned i = 0; i < size; ++i)
+        pts.insert(Pointer(targets[randomNum(rng, targets.size())],
+                           randomOffset(rng)));
+
+    return pts;
+}
+
+static void benchPSNodeAddPointsTo(BenchmarkRunner& runner, unsigned targets)
+{
+    runner.run("psnode-addpointsto", "targets=" + std::to_string(targets),
+               [targets](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        std::vector<PSNode *> allocs = createAllocs(targets);
+        std::vector<PSNode *> nodes;
+        for (unsigned i = 0; i < 256; ++i)
+            nodes.push_back(new PSNode(analysis::pta::NOOP));
+
+        // the points-to sets are propagated
+        // to the nodes repeatedly, as in the fixpoint
+        const unsigned unions = 20000;
+        std::vector<std::pair<PSNode *, std::set<Pointer>>> work;
+        work.reserve(unions);
+        for (unsigned i = 0; i < unions; ++i)
+            work.emplace_back(nodes[randomNum(rng, nodes.size())],
+                              randomPointsTo(rng, allocs));
+
+        uint64_t changed = 0;
+        sw.start();
+        for (auto& it : work)
+            changed += it.first->addPointsTo(it.second);
+        sw.stop();
+
+        doNotOptimize(changed);
+        deleteNodes(nodes);
+        deleteNodes(allocs);
+        return unions;
+    });
+}
+
+static void benchMemoryObjectAddPointsTo(BenchmarkRunner& runner, unsigned targets)
+{
+    runner.run("memobj-addpointsto", "targets=" + std::to_string(targets),
+               [targets](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        std::vector<PSNode *> allocs = createAllocs(targets);
+        std::vector<std::unique_ptr<MemoryObject>> objects;
+        for (unsigned i = 0; i < 256; ++i)
+            objects.emplace_back(new MemoryObject(allocs[randomNum(rng, targets)]));
+
+        const unsigned stores = 50000;
+        std::vector<std::pair<MemoryObject *, std::pair<Offset, Pointer>>> work;
+        work.reserve(stores);
+        for (unsigned i = 0; i < stores; ++i)
+            work.emplace_back(objects[randomNum(rng, objects.size())].get(),
+                              std::make_pair(randomOffset(rng),
+                                             Pointer(allocs[randomNum(rng, targets)],
+                                                     randomOffset(rng))));
+
+        uint64_t changed = 0;
+        sw.start();
+        for (auto& it : work)
+            changed += it.first->addPointsTo(it.second.first, it.second.second);
+        sw.stop();
+
+        doNotOptimize(changed);
+        deleteNodes(allocs);
+        return stores;
+    });
+}
+
+static void benchDGContainer(BenchmarkRunner& runner, unsigned maxsize)
+{
+    runner.run("dgcontainer-insert-contains", "max-size=" + std::to_string(maxsize),
+               [maxsize](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        // the containers hold edges, so use pointer-like values
+        const unsigned containers = 2000;
+        std::vector<std::vector<uintptr_t>> inserts(containers);
+        std::vector<std::vector<uintptr_t>> queries(containers);
+        uint64_t ops = 0;
+        for (unsigned i = 0; i < containers; ++i) {
+            unsigned size = randomSetSize(rng, maxsize);
+            for (unsigned j = 0; j < size; ++j)
+                inserts[i].push_back(8 * randomNum(rng, 4 * maxsize));
+            for (unsigned j = 0; j < 2 * size; ++j)
+                queries[i].push_back(8 * randomNum(rng, 4 * maxsize));
+
+            ops += inserts[i].size() + queries[i].size();
+        }
+
+        std::vector<DGContainer<uintptr_t>> cont(containers);
+        uint64_t found = 0;
+        sw.start();
+        for (unsigned i = 0; i < containers; ++i) {
+            for (uintptr_t v : inserts[i])
+                cont[i].insert(v);
+            for (uintptr_t v : queries[i])
+                found += cont[i].contains(v);
+        }
+        sw.stop();
+
+        doNotOptimize(found);
+        return ops;
+    });
+}
+
+static void benchQueueFIFO(BenchmarkRunner& runner, unsigned branching)
+{
+    runner.run("queue-fifo", "branching=" + std::to_string(branching),
+               [branching](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        // simulate BFS over a graph with the given branching
+        const unsigned steps = 100000;
+        std::vector<unsigned> succs(steps);
+        for (unsigned i = 0; i < steps; ++i)
+            succs[i] = randomNum(rng, branching + 1);
+
+        ADT::QueueFIFO<unsigned> queue;
+        uint64_t ops = 0, sum = 0;
+        sw.start();
+        queue.push(0);
+        for (unsigned i = 0; i < steps && !queue.empty(); ++i) {
+            sum += queue.pop();
+            ++ops;
+
+            // do not let the queue die out
+            unsigned num = queue.empty() && succs[i] == 0 ? 1 : succs[i];
+            for (unsigned j = 0; j < num; ++j) {
+                queue.push(i + j);
+                ++ops;
+            }
+        }
+        sw.stop();
+
+        doNotOptimize(sum);
+        return ops;
+    });
+}
+
+struct PriorityItem {
+    unsigned priority;
+    unsigned id;
+};
+
+struct PriorityCmp {
+    bool operator()(const PriorityItem& a, const PriorityItem& b) const
+    {
+        return a.priority == b.priority ? a.id < b.id : a.priority < b.priority;
+    }
+};
+
+static void benchPrioritySet(BenchmarkRunner& runner, unsigned size)
+{
+    runner.run("priority-set", "size=" + std::to_string(size),
+               [size](RandomT& rng, Stopwatch& sw) -> uint64_t {
+        // keep around @size elements in the set, like a worklist
+        // ordered by (e.g.) the reverse postorder of nodes
+        const unsigned steps = 100000;
+        std::vector<PriorityItem> items(steps + size);
+        for (unsigned i = 0; i < items.size(); ++i)
+            items[i] = PriorityItem{(unsigned) randomNum(rng, 4 * size), i};
+
+        ADT::PrioritySet<PriorityItem, PriorityCmp> set;
+        uint64_t sum = 0;
+        sw.start();
+        for (unsigned i = 0; i < size; ++i)
+            set.push(items[i]);
+        for (unsigned i = 0; i < steps; ++i) {
+            sum += set.pop().id;
+            set.push(items[size + i]);
+        }
+        sw.stop();
+
+        doNotOptimize(sum);
+        return 2 * steps + size;
+    });
+}
+
+} // namespace tests
+} // namespace dg
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [-r repetitions] [-s seed] [-f filter] [-o file.json]\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace dg::tests;
+
+    unsigned repetitions = 10;
+    uint64_t seed = 0;
+    std::string filter;
+    const char *output = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:s:f:o:h")) != -1) {
+        switch (opt) {
+            case 'r':
+                repetitions = strtoul(optarg, nullptr, 10);
+                break;
+            case 's':
+                seed = strtoull(optarg, nullptr, 10);
+                break;
+            case 'f':
+                filter = optarg;
+                break;
+            case 'o':
+                output = optarg;
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (repetitions == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    BenchmarkRunner runner(repetitions, seed, filter);
+
+    for (unsigned objects : {8, 64, 512}) {
+        benchRDMapMerge(runner, objects);
+        benchRDMapGet(runner, objects);
+    }
+
+    for (unsigned targets : {16, 256, 4096}) {
+        benchPSNodeAddPointsTo(runner, targets);
+        benchMemoryObjectAddPointsTo(runner, targets);
+    }
+
+    for (unsigned maxsize : {8, 64, 512})
+        benchDGContainer(runner, maxsize);
+
+    for (unsigned branching : {1, 2, 4})
+        benchQueueFIFO(runner, branching);
+
+    for (unsigned size : {16, 1024, 65536})
+        benchPrioritySet(runner, size);
+
+    FILE *out = stdout;
+    if (output) {
+        out = fopen(output, "w");
+        if (!out) {
+            perror(output);
+            return 1;
+        }
+    }
+
+    runner.dumpJSON(out);
+
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
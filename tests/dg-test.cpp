@@ -1,11 +1,18 @@
+#include <algorithm>
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
 
 #include "test-runner.h"
 
 #include "test-dg.h"
 
+#include "analysis/ControlExpression/CFA.h"
+#include "analysis/Dominators.h"
+#include "analysis/PostDominators.h"
 #include "analysis/Slicing.h"
 #include "DG2Dot.h"
 
@@ -504,6 +511,978 @@ private:
     }
 };
 
+class TestFreeze : public Test
+{
+public:
+    TestFreeze() : Test("freezing graph test")
+    {}
+
+    template <typename IterT>
+    static bool hasEdge(IterT I, IterT E, TestNode *n)
+    {
+        return std::find(I, E, n) != E;
+    }
+
+    #define FREEZE_NODES_NUM 20
+    void test()
+    {
+        TestDG d;
+        TestNode *nodes[FREEZE_NODES_NUM];
+
+        for (int i = 0; i < FREEZE_NODES_NUM; ++i) {
+            nodes[i] = new TestNode(i);
+            d.addNode(nodes[i]);
+        }
+
+        // the nodes with even keys depend on all other nodes
+        // and the first few nodes have a control dependence edge
+        // from the next one
+        for (int i = 0; i < FREEZE_NODES_NUM; ++i) {
+            for (int j = 0; j < FREEZE_NODES_NUM; j += 2)
+                if (i != j)
+                    nodes[i]->addDataDependence(nodes[j]);
+
+            if (i < 5)
+                nodes[i + 1]->addControlDependence(nodes[i]);
+        }
+
+        check(!d.isFrozen(), "graph is frozen after construction");
+        d.freeze();
+        check(d.isFrozen(), "graph is not frozen");
+
+        for (int i = 0; i < FREEZE_NODES_NUM; ++i) {
+            unsigned rdnum = i % 2 == 0 ? FREEZE_NODES_NUM - 1 : 0;
+            check(nodes[i]->getRevDataDependenciesNum() == rdnum,
+                  "node[%d]: should have %u but have %u",
+                  i, rdnum, nodes[i]->getRevDataDependenciesNum());
+
+            for (auto I = nodes[i]->data_begin(), E = nodes[i]->data_end();
+                 I != E; ++I) {
+                check((*I)->getKey() % 2 == 0, "wrong frozen edge");
+                check(hasEdge((*I)->rev_data_begin(), (*I)->rev_data_end(), nodes[i]),
+                      "frozen edge without the reverse edge");
+            }
+        }
+
+        check(hasEdge(nodes[3]->control_begin(), nodes[3]->control_end(), nodes[2]), "lost frozen CD edge");
+        check(hasEdge(nodes[2]->rev_control_begin(), nodes[2]->rev_control_end(), nodes[3]), "lost frozen CD edge");
+
+        // modifying the frozen graph thaws the modified nodes
+        check(nodes[1]->removeDataDependence(nodes[4]), "did not remove edge");
+        check(!hasEdge(nodes[1]->data_begin(), nodes[1]->data_end(), nodes[4]), "edge not removed");
+        check(nodes[4]->getRevDataDependenciesNum() == FREEZE_NODES_NUM - 2,
+              "wrong number of edges after removing");
+        check(nodes[1]->addDataDependence(nodes[4]), "did not add edge");
+
+        // freezing again must keep the edges
+        d.freeze();
+        for (int i = 0; i < FREEZE_NODES_NUM; i += 2)
+            check(nodes[i]->getRevDataDependenciesNum() == FREEZE_NODES_NUM - 1,
+                  "node[%d] lost edges after freezing again", i);
+
+        d.deleteNode(nodes[0]->getKey());
+        check(nodes[1]->getDataDependenciesNum() == FREEZE_NODES_NUM / 2 - 1,
+              "node was not removed from frozen edges");
+
+        for (int i = 1; i < FREEZE_NODES_NUM; ++i)
+            d.deleteNode(nodes[i]->getKey());
+
+#ifdef ENABLE_CFG
+        TestNode n1(1), n2(2), n3(3);
+        TestDG d2;
+
+        TestBBlock *B1 = new TestBBlock(&n1, &d2);
+        TestBBlock *B2 = new TestBBlock(&n2, &d2);
+        TestBBlock *B3 = new TestBBlock(&n3, &d2);
+        d2.addBlock(1, B1);
+        d2.addBlock(2, B2);
+        d2.addBlock(3, B3);
+
+        B1->addSuccessor(B2, 0);
+        B1->addSuccessor(B3, 1);
+        B2->addSuccessor(B3, 0);
+
+        d2.freeze();
+
+        check(B1->successorsNum() == 2, "claims: %u", B1->successorsNum());
+        check(B3->predecessorsNum() == 2, "claims: %u", B3->predecessorsNum());
+        check(*B2->predecessors().begin() == B1, "wrong frozen predecessor");
+
+        B1->removeSuccessors();
+        check(B1->successorsNum() == 0, "has successors after removing");
+        check(B3->predecessorsNum() == 1, "claims: %u", B3->predecessorsNum());
+        check(*B3->predecessors().begin() == B2, "wrong predecessor after removing");
+#endif // ENABLE_CFG
+    }
+};
+
+class TestPostDominators : public Test
+{
+public:
+    TestPostDominators() : Test("post-dominators test")
+    {}
+
+#ifdef ENABLE_CFG
+    static bool dependsOn(TestBBlock *B, TestBBlock *on)
+    {
+        for (TestBBlock *cd : on->controlDependence())
+            if (cd == B)
+                return true;
+
+        return false;
+    }
+
+    static void computeCD(analysis::PostDominators<TestNode>& pdoms)
+    {
+        pdoms.compute();
+        pdoms.computeFrontiers([](TestBBlock *B,
+                                  const std::vector<TestBBlock *>& deps) {
+            B->addControlDependencies(deps.begin(), deps.end());
+        });
+    }
+
+    void diamond()
+    {
+        TestBBlock B1, B2, B3, B4;
+        B1.addSuccessor(&B2, 0);
+        B1.addSuccessor(&B3, 1);
+        B2.addSuccessor(&B4);
+        B3.addSuccessor(&B4);
+
+        analysis::PostDominators<TestNode> pdoms;
+        pdoms.addBlock(&B1);
+        pdoms.addBlock(&B2);
+        pdoms.addBlock(&B3);
+        pdoms.addBlock(&B4);
+        computeCD(pdoms);
+
+        check(pdoms.getIPostDom(&B1) == &B4, "wrong ipostdom of B1");
+        check(pdoms.getIPostDom(&B2) == &B4, "wrong ipostdom of B2");
+        check(pdoms.getIPostDom(&B3) == &B4, "wrong ipostdom of B3");
+        check(pdoms.getIPostDom(&B4) == nullptr, "B4 should be the exit");
+
+        check(dependsOn(&B2, &B1), "B2 should depend on B1");
+        check(dependsOn(&B3, &B1), "B3 should depend on B1");
+        check(!dependsOn(&B4, &B1), "B4 should not depend on B1");
+        check(B2.controlDependence().empty(), "B2 has dependencies");
+    }
+
+    void loops()
+    {
+        // B1 -> B2 -> B3 -> B2 (loop with the exit in B3)
+        //    -> B4 -> B4 (infinite loop)
+        TestBBlock B1, B2, B3, B4, B5;
+        B1.addSuccessor(&B2, 0);
+        B1.addSuccessor(&B4, 1);
+        B2.addSuccessor(&B3);
+        B3.addSuccessor(&B2, 0);
+        B3.addSuccessor(&B5, 1);
+
+        B4.addSuccessor(&B4);
+
+        analysis::PostDominators<TestNode> pdoms;
+        pdoms.addBlock(&B1);
+        pdoms.addBlock(&B2);
+        pdoms.addBlock(&B3);
+        pdoms.addBlock(&B4);
+        // B5 is not added, so it is taken as the exit
+        computeCD(pdoms);
+
+        check(pdoms.getIPostDom(&B2) == &B3, "wrong ipostdom of B2");
+        check(pdoms.getIPostDom(&B3) == nullptr, "B3 should go to the exit");
+        check(pdoms.getIPostDom(&B4) == nullptr,
+              "the infinite loop should be connected to the exit");
+        check(pdoms.getIPostDom(&B1) == nullptr, "wrong ipostdom of B1");
+
+        check(dependsOn(&B2, &B1), "B2 should depend on B1");
+        check(dependsOn(&B3, &B1), "B3 should depend on B1");
+        check(dependsOn(&B4, &B1), "B4 should depend on B1");
+        check(dependsOn(&B2, &B3), "the loop should depend on B3");
+        check(dependsOn(&B3, &B3), "B3 should depend on itself");
+        check(dependsOn(&B4, &B4), "B4 should depend on itself");
+        check(!dependsOn(&B1, &B3), "B1 should not depend on B3");
+    }
+
+    void switchBlocks()
+    {
+        // B0 -> cases -> End, every case falls through to the next one
+        const unsigned N = 200;
+        TestBBlock B0, End;
+        std::vector<TestBBlock> cases(N);
+
+        analysis::PostDominators<TestNode> pdoms;
+        pdoms.addBlock(&B0);
+        for (unsigned i = 0; i < N; ++i) {
+            B0.addSuccessor(&cases[i], i);
+            cases[i].addSuccessor(i + 1 < N ? &cases[i + 1] : &End);
+            pdoms.addBlock(&cases[i]);
+        }
+        pdoms.addBlock(&End);
+        computeCD(pdoms);
+
+        check(B0.controlDependence().size() == N - 1,
+              "wrong number of dependencies on the switch");
+        check(!dependsOn(&cases[N - 1], &B0),
+              "the last case post-dominates the switch");
+        for (unsigned i = 0; i + 1 < N; ++i) {
+            check(dependsOn(&cases[i], &B0), "a case should depend on B0");
+            check(cases[i].revControlDependence().size() == 1,
+                  "a case depends on more blocks");
+        }
+    }
+#endif // ENABLE_CFG
+
+    void test()
+    {
+#ifdef ENABLE_CFG
+        diamond();
+        loops();
+        switchBlocks();
+#endif // ENABLE_CFG
+    }
+};
+
+class TestDominators : public Test
+{
+public:
+    TestDominators() : Test("dominators test")
+    {}
+
+    void test()
+    {
+#ifdef ENABLE_CFG
+        // B1 -> B2 -> B3 -> B2 (loop)
+        //    -> B4 -> B5 <- B3
+        // B6 -> B5 (unreachable)
+        TestBBlock B1, B2, B3, B4, B5, B6;
+        B1.addSuccessor(&B2, 0);
+        B1.addSuccessor(&B4, 1);
+        B2.addSuccessor(&B3);
+        B3.addSuccessor(&B2, 0);
+        B3.addSuccessor(&B5, 1);
+        B4.addSuccessor(&B5);
+        B6.addSuccessor(&B5);
+
+        analysis::Dominators<TestNode> doms;
+        // the entry does not need to be added first
+        doms.addBlock(&B3);
+        doms.addBlock(&B1);
+        doms.addBlock(&B2);
+        doms.addBlock(&B4);
+        doms.addBlock(&B5);
+        doms.addBlock(&B6);
+        doms.compute(&B1);
+
+        check(doms.getIDom(&B1) == nullptr, "the entry has an idom");
+        check(doms.getIDom(&B2) == &B1, "wrong idom of B2");
+        check(doms.getIDom(&B3) == &B2, "wrong idom of B3");
+        check(doms.getIDom(&B4) == &B1, "wrong idom of B4");
+        check(doms.getIDom(&B5) == &B1, "wrong idom of B5");
+        check(doms.getIDom(&B6) == nullptr, "unreachable block has an idom");
+#endif // ENABLE_CFG
+    }
+};
+
+class TestControlExpression : public Test
+{
+public:
+    TestControlExpression() : Test("control expression test")
+    {}
+
+    static std::set<int> getScope(ControlExpression& CE, int label,
+                                  bool termination_sensitive = false)
+    {
+        std::set<int> ret;
+        for (CENode *n : CE.getControlScope(label, termination_sensitive))
+            ret.insert(static_cast<CELabel<int> *>(n)->getLabel());
+        return ret;
+    }
+
+    // a random CFG of nodes 1..n, node 1 has no predecessors
+    struct RandomCFG {
+        std::vector<std::vector<int>> succs;
+        unsigned seed;
+
+        unsigned rnd(unsigned n)
+        {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 16) % n;
+        }
+
+        RandomCFG(unsigned s, int n) : succs(n + 1), seed(s)
+        {
+            for (int i = 1; i <= n; ++i) {
+                unsigned num = rnd(3);
+                for (unsigned j = 0; j < num; ++j) {
+                    int succ = 2 + rnd(n - 1);
+                    if (std::find(succs[i].begin(), succs[i].end(), succ)
+                        == succs[i].end())
+                        succs[i].push_back(succ);
+                }
+            }
+        }
+
+        int size() const { return succs.size() - 1; }
+
+        ControlExpression compute(CFAEliminationOrder order) const
+        {
+            CFA<int> cfa;
+            std::vector<CFANode<int> *> N(succs.size(), nullptr);
+            for (int i = 1; i <= size(); ++i)
+                N[i] = cfa.createNode(i);
+            for (int i = 1; i <= size(); ++i)
+                for (int succ : succs[i])
+                    cfa.addSuccessor(N[i], N[succ]);
+
+            ControlExpression CE = cfa.compute(order);
+            CE.computeSets();
+            return CE;
+        }
+
+        // the nodes reachable from @from without going through @avoid
+        std::set<int> reachable(int from, int avoid = 0) const
+        {
+            std::set<int> ret{from};
+            std::vector<int> queue{from};
+            while (!queue.empty()) {
+                int n = queue.back();
+                queue.pop_back();
+                for (int succ : succs[n])
+                    if (succ != avoid && ret.insert(succ).second)
+                        queue.push_back(succ);
+            }
+            return ret;
+        }
+
+        bool onCycle(int n) const
+        {
+            for (int succ : succs[n])
+                if (reachable(succ).count(n))
+                    return true;
+            return false;
+        }
+
+        // the control scope computed on the paths of the CFG
+        std::set<int> getScope(int L, bool termination_sensitive) const
+        {
+            // the paths start in the nodes without predecessors
+            std::set<int> starts;
+            for (int i = 1; i <= size(); ++i)
+                starts.insert(i);
+            for (int i = 1; i <= size(); ++i)
+                for (int succ : succs[i])
+                    starts.erase(succ);
+
+            bool isReachable = false;
+            for (int st : starts)
+                isReachable |= reachable(st).count(L) != 0;
+            if (!isReachable)
+                return {};
+
+            // the paths end in the nodes without successors
+            // and in the nodes that cannot get to such a node
+            std::set<int> ends;
+            for (int i = 1; i <= size(); ++i) {
+                bool getsToSink = false;
+                for (int r : reachable(i))
+                    getsToSink |= succs[r].empty();
+                if (!getsToSink || succs[i].empty())
+                    ends.insert(i);
+            }
+
+            std::set<int> scope;
+            for (int X : reachable(L)) {
+                if (X == L)
+                    continue;
+
+                // is there a path from L that avoids X and that
+                // ends or stays in a loop forever?
+                bool avoided = termination_sensitive && onCycle(X);
+                for (int r : reachable(L, X)) {
+                    avoided |= ends.count(r) != 0;
+                    for (int succ : succs[r])
+                        if (succ != X && reachable(succ, X).count(r))
+                            avoided = true;
+                }
+
+                if (avoided)
+                    scope.insert(X);
+            }
+
+            return scope;
+        }
+    };
+
+    // the elimination order must not change the control scopes
+    void randomCFGs()
+    {
+        for (unsigned seed = 1; seed <= 200; ++seed) {
+            RandomCFG cfg(seed, 4 + seed % 7);
+            ControlExpression byDegree
+                = cfg.compute(CFAEliminationOrder::MIN_DEGREE);
+            ControlExpression byCreation
+                = cfg.compute(CFAEliminationOrder::CREATION);
+
+            for (int L = 1; L <= cfg.size(); ++L) {
+                for (bool ts : {false, true}) {
+                    std::set<int> expected = cfg.getScope(L, ts);
+                    check(getScope(byDegree, L, ts) == expected,
+                          "seed %u: wrong scope of %d with min-degree order",
+                          seed, L);
+                    check(getScope(byCreation, L, ts) == expected,
+                          "seed %u: wrong scope of %d with creation order",
+                          seed, L);
+                }
+            }
+        }
+    }
+
+    void test()
+    {
+        // 1 -> 2 -> 4 -> 5 -> 6
+        //   -> 3 ---^    ^-- 5 (self-loop)
+        // 7 -> 8 -> 7 (unreachable)
+        //   -> 6
+        CFA<int> cfa;
+        std::vector<CFANode<int> *> N(9, nullptr);
+        for (int i = 1; i <= 8; ++i)
+            N[i] = cfa.createNode(i);
+
+        cfa.addSuccessor(N[1], N[2]);
+        cfa.addSuccessor(N[1], N[3]);
+        cfa.addSuccessor(N[2], N[4]);
+        cfa.addSuccessor(N[3], N[4]);
+        cfa.addSuccessor(N[4], N[5]);
+        cfa.addSuccessor(N[5], N[5]);
+        cfa.addSuccessor(N[5], N[6]);
+        cfa.addSuccessor(N[7], N[8]);
+        cfa.addSuccessor(N[7], N[6]);
+        cfa.addSuccessor(N[8], N[7]);
+
+        check(N[1]->successorsNum() == 2, "wrong number of successors");
+        check(N[5]->hasSelfLoop(), "lost the self-loop");
+
+        ControlExpression CE = cfa.compute();
+        check(CE.getRoot() != nullptr, "no expression");
+        check(CE.size() > 0, "the expression has no nodes");
+        CE.computeSets();
+
+        std::set<int> scope = getScope(CE, 1);
+        check(scope.count(2) && scope.count(3), "1 should control 2 and 3");
+        check(!scope.count(4), "4 is always visited after 1");
+
+        // the loop may not terminate
+        scope = getScope(CE, 5);
+        check(scope.count(6), "5 should control 6");
+
+        check(getScope(CE, 7).empty(), "unreachable 7 has a control scope");
+
+        // the expression is moved with its nodes
+        ControlExpression CE2 = std::move(CE);
+        check(CE.getRoot() == nullptr && CE.size() == 0, "BUG in move");
+        check(getScope(CE2, 1).count(2), "lost the expression when moved");
+
+        randomCFGs();
+    }
+};
+
+class TestContextSensitiveSlicing : public Test
+{
+public:
+    TestContextSensitiveSlicing() : Test("context-sensitive slicing test")
+    {}
+
+    // main calls f twice: r1 = f(a1); r2 = f(a2); and the criterion
+    // uses only r1. f returns a value computed from its parameter p
+    void test()
+    {
+        TestDG main, f;
+        TestNode mentry(1), a1(2), a2(3), c1(4), c2(5), crit(6);
+        TestNode fentry(10), x(11), fexit(12);
+
+        main.setEntry(&mentry);
+        main.addNode(&a1);
+        main.addNode(&a2);
+        main.addNode(&c1);
+        main.addNode(&c2);
+        main.addNode(&crit);
+
+        f.setEntry(&fentry);
+        fentry.setDG(&f);
+        f.addNode(&x);
+        f.addNode(&fexit);
+        f.setExit(&fexit);
+
+        DGParameters<TestNode> *formal = new DGParameters<TestNode>();
+        TestNode *pin = new TestNode(13), *pout = new TestNode(13);
+        pin->setDG(&f);
+        pout->setDG(&f);
+        formal->add(13, pin, pout);
+        f.setParameters(formal);
+        fentry.addControlDependence(pin);
+        fentry.addControlDependence(pout);
+        fentry.addControlDependence(&x);
+        fentry.addControlDependence(&fexit);
+
+        pin->addDataDependence(&x);
+        x.addDataDependence(&fexit);
+
+        TestNode *calls[] = { &c1, &c2 };
+        TestNode *args[] = { &a1, &a2 };
+        for (int i = 0; i < 2; ++i) {
+            TestNode *c = calls[i];
+            DGParameters<TestNode> *actual = new DGParameters<TestNode>(c);
+            TestNode *ain = new TestNode(20 + i), *aout = new TestNode(20 + i);
+            ain->setDG(&main);
+            aout->setDG(&main);
+            actual->add(20 + i, ain, aout);
+            c->setParameters(actual);
+
+            c->addSubgraph(&f);
+            c->addControlDependence(&fentry);
+            c->addControlDependence(ain);
+            c->addControlDependence(aout);
+            ain->addDataDependence(pin);
+            pout->addDataDependence(aout);
+
+            args[i]->addDataDependence(c);
+            fexit.addDataDependence(c);
+        }
+
+        c1.addDataDependence(&crit);
+
+        analysis::Slicer<TestNode> slicer(analysis::SLICER_CONTEXT_SENSITIVE);
+        uint32_t sid = slicer.mark(&crit);
+
+        check(crit.getSlice() == sid, "criterion not in slice");
+        check(c1.getSlice() == sid, "call-site not in slice");
+        check(a1.getSlice() == sid, "argument not in slice");
+        check(c1.getParameters()->find(20)->in->getSlice() == sid,
+              "actual parameter not in slice");
+        check(x.getSlice() == sid, "node in procedure not in slice");
+        check(fexit.getSlice() == sid, "exit not in slice");
+        check(pin->getSlice() == sid, "formal parameter not in slice");
+        check(fentry.getSlice() == sid, "entry not in slice");
+        check(c2.getSlice() != sid, "unrelated call-site is in slice");
+        check(a2.getSlice() != sid, "unrelated argument is in slice");
+        check(c2.getParameters()->find(21)->in->getSlice() != sid,
+              "unrelated actual parameter in slice");
+
+        // every graph is counted once, even though
+        // the walk marked more nodes in it
+        analysis::MarkStatistics ms = slicer.getMarkStatistics(sid);
+        check(ms.graphs == 2, "counted %lu graphs", ms.graphs);
+        check(ms.nodes >= 8, "counted %lu nodes", ms.nodes);
+
+        // the context-insensitive marking keeps both call-sites
+        analysis::Slicer<TestNode> ci_slicer;
+        sid = ci_slicer.mark(&crit, sid + 1);
+        check(c2.getSlice() == sid, "context-insensitive slice lost call");
+
+        ms = ci_slicer.getMarkStatistics(sid);
+        check(ms.graphs == 2, "counted %lu graphs", ms.graphs);
+        check(ci_slicer.getMarkStatistics(sid + 1).nodes == 0,
+              "have statistics of a slice that was not marked");
+
+        // the graphs do not own the parameters
+        delete c1.getParameters();
+        delete c2.getParameters();
+        delete formal;
+    }
+};
+
+// A graph with random edges, the tests of the marking walks
+// compare the slices of the walks in it with the slices of Slicer.
+// The graph owns its nodes, nodes[0] is the entry
+class RandomGraph
+{
+    unsigned seed;
+
+public:
+    TestDG dg;
+    std::vector<TestNode *> nodes;
+    analysis::Slicer<TestNode> slicer;
+
+    RandomGraph(int nodes_num, unsigned s, int first_key = 1)
+        : seed(s)
+    {
+        for (int i = 0; i < nodes_num; ++i)
+            nodes.push_back(new TestNode(first_key + i));
+
+        dg.setEntry(nodes[0]);
+        nodes[0]->setDG(&dg);
+        for (int i = 1; i < nodes_num; ++i)
+            dg.addNode(nodes[i]);
+    }
+
+    ~RandomGraph()
+    {
+        for (TestNode *n : nodes)
+            delete n;
+    }
+
+    unsigned rnd(unsigned n)
+    {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % n;
+    }
+
+    // a random node from nodes[from] on
+    TestNode *randomNode(unsigned from = 0)
+    {
+        return nodes[from + rnd(nodes.size() - from)];
+    }
+
+    // add @num random dependencies (a third of them control
+    // dependencies) between the nodes from nodes[from] on
+    void addRandomEdges(int num, unsigned from = 0)
+    {
+        for (int i = 0; i < num; ++i) {
+            TestNode *a = randomNode(from), *b = randomNode(from);
+            if (rnd(3) == 0)
+                a->addControlDependence(b);
+            else
+                a->addDataDependence(b);
+        }
+    }
+
+    // mark the slice of @criteria with Slicer and return the first
+    // node for which @inSlice says something else (or nullptr)
+    template <typename FuncT>
+    TestNode *differsFromSlicer(const std::vector<TestNode *>& criteria,
+                                uint32_t sid, FuncT inSlice)
+    {
+        for (TestNode *c : criteria)
+            slicer.mark(c, sid);
+
+        for (TestNode *n : nodes) {
+            if (inSlice(n) != (n->getSlice() == sid))
+                return n;
+        }
+
+        return nullptr;
+    }
+};
+
+static int keyOf(TestNode *n)
+{
+    return n ? n->getKey() : 0;
+}
+
+class TestBatchSlicing : public Test
+{
+public:
+    TestBatchSlicing() : Test("batch slicing test")
+    {}
+
+    enum { GRAPH_NODES = 40, CRITERIA_NUM = 70 };
+
+    // the batch marking must give the same slices as marking
+    // every criterion on its own. There is more than 64 criteria,
+    // so that the wider masks are used too
+    void test()
+    {
+        RandomGraph main(GRAPH_NODES, 7);
+        main.addRandomEdges(2 * GRAPH_NODES);
+        std::vector<TestNode *>& nodes = main.nodes;
+
+        // some slices get to the other graph
+        TestDG g;
+        TestNode gentry(100), gnode(101);
+        g.setEntry(&gentry);
+        gentry.setDG(&g);
+        g.addNode(&gnode);
+        gentry.addControlDependence(&gnode);
+        gnode.addDataDependence(nodes[GRAPH_NODES - 1]);
+
+        std::vector<std::vector<TestNode *>> criteria(CRITERIA_NUM);
+        for (int k = 0; k < CRITERIA_NUM; ++k) {
+            criteria[k].push_back(nodes[k % GRAPH_NODES]);
+            if (k >= GRAPH_NODES)
+                criteria[k].push_back(main.randomNode());
+        }
+
+        analysis::BatchMark<TestNode> batch;
+        batch.mark(criteria);
+        check(batch.getSlicesNum() == CRITERIA_NUM, "wrong number of slices");
+
+        for (int k = 0; k < CRITERIA_NUM; ++k) {
+            uint32_t sid = k + 1;
+            TestNode *diff = main.differsFromSlicer(criteria[k], sid,
+                                [&batch, k](TestNode *n) {
+                                    return batch.inSlice(n, k);
+                                });
+            check(!diff, "slice %d differs in node %d", k, keyOf(diff));
+            check(batch.inSlice(&gnode, k) == (gnode.getSlice() == sid),
+                  "slice %d differs in the other graph", k);
+
+            // setting the batch slice gives the same marks
+            bool inG = g.getSlice() == sid;
+            batch.setSlice(k, 1000 + k);
+            for (TestNode *n : nodes)
+                check(batch.inSlice(n, k) == (n->getSlice() == 1000u + k),
+                      "setSlice() differs in node %d", n->getKey());
+            check(inG == (g.getSlice() == 1000u + k),
+                  "setSlice() differs in the graph");
+        }
+
+        sliceInSequence();
+    }
+
+    // slice the batch slices one after another. They are all in one
+    // graph, so every slice keeps what is in it and was not removed
+    // by the slices before. The removed (deleted) nodes must not be
+    // touched by the next slices
+    void sliceInSequence()
+    {
+        // few edges, so that the slices differ
+        RandomGraph main(GRAPH_NODES, 17);
+        main.addRandomEdges(GRAPH_NODES / 2);
+
+        // the slices have a common part, so that something stays
+        TestNode *common = main.randomNode(1);
+        std::vector<std::vector<TestNode *>> criteria(4);
+        for (auto& c : criteria) {
+            c.push_back(common);
+            c.push_back(main.randomNode(1));
+        }
+
+        analysis::BatchMark<TestNode> batch;
+        batch.mark(criteria);
+
+        // the entry is not in the nodes of the graph, it stays
+        std::set<TestNode *> left(main.nodes.begin() + 1, main.nodes.end());
+        for (unsigned k = 0; k < criteria.size(); ++k) {
+            std::set<TestNode *> expected;
+            for (TestNode *n : left)
+                if (batch.inSlice(n, k))
+                    expected.insert(n);
+
+            main.slicer.slice(&main.dg, batch, k, 100 + k);
+
+            std::set<TestNode *> kept;
+            for (auto& it : main.dg)
+                kept.insert(it.second);
+            check(kept == expected, "slice %u kept wrong nodes", k);
+
+            left.swap(kept);
+        }
+
+        // the graph deleted the other nodes
+        main.nodes.erase(std::remove_if(main.nodes.begin() + 1,
+                                        main.nodes.end(),
+                                        [&left](TestNode *n) {
+                                            return left.count(n) == 0;
+                                        }),
+                         main.nodes.end());
+    }
+};
+
+class TestMemoizedSlicing : public Test
+{
+public:
+    TestMemoizedSlicing() : Test("memoized slicing test")
+    {}
+
+    enum { GRAPH_NODES = 30 };
+
+    // count how many times the marking asks for a graph
+    struct PrepareCounter : public analysis::Slicer<TestNode>
+    {
+        std::map<DependenceGraph<TestNode> *, int> prepared;
+
+        void prepareGraph(DependenceGraph<TestNode> *graph)
+        {
+            ++prepared[graph];
+        }
+    };
+
+    // the remembered slices must give the same
+    // slices as marking the criteria from scratch
+    void test()
+    {
+        RandomGraph graph(GRAPH_NODES, 11);
+        graph.addRandomEdges(GRAPH_NODES + GRAPH_NODES / 2);
+
+        analysis::MemoizedMark<TestNode> memo;
+        uint32_t sid = 0;
+        for (int i = 0; i < 40; ++i) {
+            // the criteria overlap with the previous ones
+            std::vector<TestNode *> criteria;
+            for (unsigned j = 0, e = 1 + graph.rnd(3); j < e; ++j)
+                criteria.push_back(graph.randomNode());
+
+            ADT::Bitvector slice = memo.getSlice(criteria);
+            check(slice.size() >= memo.getNodesNum(), "the set is too small");
+            TestNode *diff = graph.differsFromSlicer(criteria, ++sid,
+                                [&memo, &slice](TestNode *n) {
+                                    return memo.inSet(slice, n);
+                                });
+            check(!diff, "request %d differs in node %d", i, keyOf(diff));
+
+            // marking with the remembered slice gives the same marks
+            memo.mark(criteria, sid + 1000);
+            for (TestNode *n : graph.nodes)
+                check(memo.inSet(slice, n) == (n->getSlice() == sid + 1000),
+                      "mark() differs in node %d", n->getKey());
+        }
+
+        check(memo.getMemoizedNum() <= GRAPH_NODES, "remembered too much");
+
+        // the walk from a criterion gives every graph
+        // to the slicer once (the graphs are stamped by the walk)
+        PrepareCounter counter;
+        analysis::MemoizedMark<TestNode> prepMemo(&counter);
+        for (int i = 0; i < 10; ++i) {
+            counter.prepared.clear();
+            prepMemo.getSlice({graph.randomNode()});
+            check(!counter.prepared.empty(), "did not prepare any graph");
+            for (auto& it : counter.prepared)
+                check(it.second == 1, "prepared a graph %d times", it.second);
+        }
+
+        // the slicer with memoized slices marks the same nodes
+        analysis::Slicer<TestNode> memoSlicer(analysis::SLICER_MEMOIZE);
+        for (int i = 0; i < 20; ++i) {
+            std::vector<TestNode *> criteria{graph.randomNode(),
+                                             graph.randomNode()};
+            uint32_t msid = 2000 + i;
+            for (TestNode *c : criteria)
+                memoSlicer.mark(c, msid);
+
+            std::set<TestNode *> marked;
+            for (TestNode *n : graph.nodes)
+                if (n->getSlice() == msid)
+                    marked.insert(n);
+
+            analysis::MarkStatistics ms = memoSlicer.getMarkStatistics(msid);
+            check(ms.graphs == 2, "counted %lu graphs", ms.graphs);
+
+            TestNode *diff = graph.differsFromSlicer(criteria, ++sid,
+                                [&marked](TestNode *n) {
+                                    return marked.count(n) > 0;
+                                });
+            check(!diff, "memoizing slicer differs in node %d", keyOf(diff));
+        }
+
+        check(memoSlicer.getMemoizedNum() > 0, "slicer did not remember slices");
+
+        memo.clear();
+        check(memo.getNodesNum() == 0 && memo.getMemoizedNum() == 0,
+              "BUG in clear");
+    }
+};
+
+class TestForwardSlicing : public Test
+{
+public:
+    TestForwardSlicing() : Test("forward slicing and chopping test")
+    {}
+
+    enum { GRAPH_NODES = 30 };
+
+    // the nodes that depend on @from. Every node
+    // of a graph depends on the entry of the graph
+    static std::set<TestNode *> reachable(TestNode *from)
+    {
+        std::set<TestNode *> ret;
+        std::vector<TestNode *> stack;
+        auto add = [&ret, &stack](TestNode *n) {
+            if (ret.insert(n).second)
+                stack.push_back(n);
+        };
+
+        add(from);
+        while (!stack.empty()) {
+            TestNode *n = stack.back();
+            stack.pop_back();
+            if (n->getDG()->getEntry() == n) {
+                for (auto& it : *n->getDG())
+                    add(it.second);
+            }
+            for (auto I = n->control_begin(), E = n->control_end(); I != E; ++I)
+                add(*I);
+            for (auto I = n->data_begin(), E = n->data_end(); I != E; ++I)
+                add(*I);
+        }
+
+        return ret;
+    }
+
+    static bool contains(const std::set<TestNode *>& S, TestNode *n)
+    {
+        return S.count(n) > 0;
+    }
+
+    void test()
+    {
+        // the graphs are shaped as the LLVM graphs: the entry controls
+        // only the first node, the call-site controls the entry of the
+        // called graph and the called graph returns a value to it
+        RandomGraph main(GRAPH_NODES, 7), callee(GRAPH_NODES, 13, 100);
+        main.nodes[0]->addControlDependence(main.nodes[1]);
+        callee.nodes[0]->addControlDependence(callee.nodes[1]);
+        main.addRandomEdges(GRAPH_NODES, 1);
+        callee.addRandomEdges(GRAPH_NODES, 1);
+
+        TestNode *call = main.nodes[GRAPH_NODES / 2];
+        call->addControlDependence(callee.nodes[0]);
+        callee.nodes[GRAPH_NODES - 1]->addDataDependence(call);
+
+        std::vector<TestNode *> nodes(main.nodes);
+        nodes.insert(nodes.end(), callee.nodes.begin(), callee.nodes.end());
+
+        analysis::ChopMark<TestNode> chop;
+
+        // the chop from the call-site gets to every node
+        // of the called graph whose slice has the call-site
+        for (int i = 2; i < GRAPH_NODES; ++i) {
+            TestNode *sink = callee.nodes[i];
+            ADT::Bitvector ch = chop.chop({call}, {sink});
+            check(chop.inSet(ch, sink) && chop.inSet(ch, call),
+                  "chop from the call-site misses node %d", sink->getKey());
+        }
+
+        uint32_t sid = 0;
+        for (int i = 0; i < 30; ++i) {
+            TestNode *src = nodes[main.rnd(nodes.size())];
+            TestNode *sink = nodes[main.rnd(nodes.size())];
+
+            std::set<TestNode *> fwd = reachable(src);
+            ADT::Bitvector forward = chop.forward({src});
+            for (TestNode *n : nodes)
+                check(chop.inSet(forward, n) == contains(fwd, n),
+                      "forward slice %d differs in node %d", i, n->getKey());
+
+            // the backward walk gives the slice of the slicer
+            ADT::Bitvector backward = chop.backward({sink});
+            TestNode *diff = main.differsFromSlicer({sink}, ++sid,
+                                [&chop, &backward](TestNode *n) {
+                                    return chop.inSet(backward, n);
+                                });
+            check(!diff, "backward slice %d differs in node %d", i, keyOf(diff));
+            for (TestNode *n : callee.nodes)
+                check(chop.inSet(backward, n) == (n->getSlice() == sid),
+                      "backward slice %d differs in node %d", i, n->getKey());
+
+            ADT::Bitvector ch = chop.chop({src}, {sink});
+            for (TestNode *n : nodes) {
+                bool expected = contains(fwd, n) && contains(reachable(n), sink);
+                check(chop.inSet(ch, n) == expected,
+                      "chop %d differs in node %d", i, n->getKey());
+            }
+
+            chop.markNodes(ch, sid + 1000);
+            for (TestNode *n : nodes)
+                check(chop.inSet(ch, n) == (n->getSlice() == sid + 1000),
+                      "markNodes() differs in node %d", n->getKey());
+        }
+
+        chop.clear();
+        check(chop.getNodesNum() == 0, "BUG in clear");
+    }
+};
+
 class TestSlicingCFG : public Test
 {
 public:
@@ -667,6 +1646,62 @@ public:
                                          "but has %u", B1->predecessorsNum());
         check (B1->successors().begin()->target == B1, "Succ of BB1 should be itself");
     }
+
+    // the walk marks every block once, but counts all nodes
+    void test4()
+    {
+        TestDG d;
+        TestNode *n1 = new TestNode(1);
+        TestNode *n2 = new TestNode(2);
+        TestNode *n3 = new TestNode(3);
+        TestNode *n4 = new TestNode(4);
+        d.setEntry(n1);
+        n1->setDG(&d);
+        d.addNode(n2);
+        d.addNode(n3);
+        d.addNode(n4);
+
+        TestBBlock *B1 = new TestBBlock(n1, &d);
+        B1->append(n2);
+        TestBBlock *B2 = new TestBBlock(n3, &d);
+        B2->append(n4);
+        B1->setKey(1);
+        B2->setKey(2);
+        d.addBlock(1, B1);
+        d.addBlock(2, B2);
+
+        n2->addDataDependence(n3);
+        n3->addDataDependence(n4);
+
+        analysis::Slicer<TestNode> slicer;
+        uint32_t sid = slicer.mark(n4);
+        check(B1->getSlice() == sid && B2->getSlice() == sid,
+              "blocks not in slice");
+
+        analysis::MarkStatistics ms = slicer.getMarkStatistics(sid);
+        check(ms.nodes == 4, "counted %lu nodes", ms.nodes);
+        check(ms.blocks == 2, "counted %lu blocks", ms.blocks);
+        check(ms.graphs == 1, "counted %lu graphs", ms.graphs);
+
+        // the next walk marks the blocks again
+        sid = slicer.mark(n4);
+        check(B1->getSlice() == sid, "block not in the next slice");
+        check(slicer.getMarkStatistics(sid).blocks == 2, "wrong count");
+
+        // marking a set of nodes stamps every block only once too
+        analysis::MemoizedMark<TestNode> memo;
+        memo.mark({n4}, sid + 1);
+        ms = memo.getMarkStatistics();
+        check(B2->getSlice() == sid + 1, "block not in the set");
+        check(ms.nodes == 4 && ms.blocks == 2 && ms.graphs == 1,
+              "counted %lu nodes, %lu blocks", ms.nodes, ms.blocks);
+
+        // the graph deletes only the blocks
+        delete n1;
+        delete n2;
+        delete n3;
+        delete n4;
+    }
 #endif // ENABLE_CFG
 
     void test()
@@ -674,6 +1709,7 @@ public:
         test1();
         test2();
         test3();
+        test4();
     }
 };
 
@@ -689,6 +1725,14 @@ int main(void)
     Runner.add(new TestContainer());
     Runner.add(new TestAdd());
     Runner.add(new TestRemove());
+    Runner.add(new TestFreeze());
+    Runner.add(new TestPostDominators());
+    Runner.add(new TestDominators());
+    Runner.add(new TestControlExpression());
+    Runner.add(new TestContextSensitiveSlicing());
+    Runner.add(new TestBatchSlicing());
+    Runner.add(new TestMemoizedSlicing());
+    Runner.add(new TestForwardSlicing());
     Runner.add(new TestSlicingCFG());
 
     return Runner();
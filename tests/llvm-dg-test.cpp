@@ -1,6 +1,16 @@
 #include <assert.h>
 #include <cstdarg>
 #include <cstdio>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/Support/SourceMgr.h>
 
 #include "llvm/LLVMDependenceGraph.h"
 #include "analysis/DFS.h"
@@ -55,6 +65,210 @@ struct TestRefcount : public Test
     }
 };
 
+
+// a module with a recursive function that uses a global
+// after the recursive call and with mutually recursive
+// functions that use a global and allocate memory
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 7))
+#define LOAD(ty) "load " ty "* "
+#else
+#define LOAD(ty) "load " ty ", " ty "* "
+#endif
+static const char *recursiveModule =
+    "@g = global i32 0\n"
+    "@h = global i32 0\n"
+    "declare i8* @malloc(i64)\n"
+    "define i32 @rec(i32 %n) {\n"
+    "entry:\n"
+    "  %c = icmp sgt i32 %n, 0\n"
+    "  br i1 %c, label %call, label %out\n"
+    "call:\n"
+    "  %m = sub i32 %n, 1\n"
+    "  %r = call i32 @rec(i32 %m)\n"
+    "  store i32 %r, i32* @g\n"
+    "  %o = call i32 @odd(i32 %m)\n"
+    "  br label %out\n"
+    "out:\n"
+    "  %v = " LOAD("i32") "@g\n"
+    "  ret i32 %v\n"
+    "}\n"
+    "define i32 @odd(i32 %n) {\n"
+    "entry:\n"
+    "  %m = sub i32 %n, 1\n"
+    "  %r = call i32 @even(i32 %m)\n"
+    "  %p = call i8* @malloc(i64 4)\n"
+    "  %y = " LOAD("i32") "@h\n"
+    "  ret i32 %r\n"
+    "}\n"
+    "define i32 @even(i32 %n) {\n"
+    "entry:\n"
+    "  %c = icmp eq i32 %n, 0\n"
+    "  br i1 %c, label %zero, label %next\n"
+    "zero:\n"
+    "  ret i32 1\n"
+    "next:\n"
+    "  %r = call i32 @odd(i32 %n)\n"
+    "  store i32 %r, i32* @h\n"
+    "  ret i32 %r\n"
+    "}\n"
+    "define i32 @main() {\n"
+    "entry:\n"
+    "  %r = call i32 @rec(i32 5)\n"
+    "  ret i32 %r\n"
+    "}\n";
+#undef LOAD
+
+struct TestParallelBuild : public Test
+{
+    TestParallelBuild()
+        : Test("parallel and sequential build give the same graphs") {}
+
+    // node -> name that does not depend on the build
+    typedef std::map<const LLVMNode *, std::string> NamesT;
+    // name of a node -> its edges described by the names of the nodes
+    typedef std::map<std::string, std::set<std::string>> EdgesT;
+
+    static std::string valueName(const llvm::Value *val)
+    {
+        if (!val)
+            return "(null)";
+        if (val->hasName())
+            return val->getName().str();
+
+        char buf[32];
+        snprintf(buf, sizeof buf, "%p", static_cast<const void *>(val));
+        return buf;
+    }
+
+    static void nameParams(NamesT& names, LLVMDGParameters *params,
+                           const std::string& prefix)
+    {
+        if (!params)
+            return;
+
+        for (auto& it : *params) {
+            names[it.second.in] = prefix + "in " + valueName(it.first);
+            names[it.second.out] = prefix + "out " + valueName(it.first);
+        }
+
+        for (auto I = params->global_begin(), E = params->global_end();
+             I != E; ++I) {
+            names[I->second.in] = prefix + "glob in " + valueName(I->first);
+            names[I->second.out] = prefix + "glob out " + valueName(I->first);
+        }
+    }
+
+    static NamesT nameNodes(LLVMDependenceGraph& dg)
+    {
+        NamesT names;
+        for (auto& global : *dg.getGlobalNodes())
+            names[global.second] = "global " + valueName(global.first);
+
+        for (auto& F : dg.getConstructedFunctions()) {
+            LLVMDependenceGraph *graph = F.second;
+            const std::string fun = valueName(F.first) + ": ";
+
+            names[graph->getEntry()] = fun + "entry";
+            names[graph->getExit()] = fun + "exit";
+            for (auto& it : *graph)
+                names[it.second] = fun + valueName(it.first);
+
+            nameParams(names, graph->getParameters(), fun + "formal ");
+            for (LLVMNode *call : graph->getCallNodes())
+                nameParams(names, call->getParameters(),
+                           fun + valueName(call->getKey()) + " actual ");
+        }
+
+        return names;
+    }
+
+    static std::string getName(const NamesT& names, const LLVMNode *n)
+    {
+        auto it = names.find(n);
+        if (it == names.end())
+            return "unknown node " + valueName(n->getKey());
+        return it->second;
+    }
+
+    static EdgesT getEdges(LLVMDependenceGraph& dg)
+    {
+        NamesT names = nameNodes(dg);
+        EdgesT edges;
+
+        for (auto& it : names) {
+            const LLVMNode *n = it.first;
+            std::set<std::string>& E = edges[it.second];
+
+            for (auto I = n->control_begin(), X = n->control_end(); I != X; ++I)
+                E.insert("control -> " + getName(names, *I));
+            for (auto I = n->data_begin(), X = n->data_end(); I != X; ++I)
+                E.insert("data -> " + getName(names, *I));
+            for (auto I = n->rev_control_begin(), X = n->rev_control_end(); I != X; ++I)
+                E.insert("control <- " + getName(names, *I));
+            for (auto I = n->rev_data_begin(), X = n->rev_data_end(); I != X; ++I)
+                E.insert("data <- " + getName(names, *I));
+            for (LLVMDependenceGraph *sub : n->getSubgraphs())
+                E.insert("calls " + getName(names, sub->getEntry()));
+        }
+
+        return edges;
+    }
+
+    void test()
+    {
+        llvm::LLVMContext ctx;
+        llvm::SMDiagnostic SMD;
+#if ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 6))
+        std::unique_ptr<llvm::Module> M(
+            llvm::ParseAssemblyString(recursiveModule, nullptr, SMD, ctx));
+#else
+        std::unique_ptr<llvm::Module> M
+            = llvm::parseAssemblyString(recursiveModule, SMD, ctx);
+#endif
+        check(M, "failed parsing the module: %s",
+              SMD.getMessage().str().c_str());
+        if (!M)
+            return;
+
+        LLVMDependenceGraph seq, par;
+        check(seq.build(M.get(), CalledFunctionsMapT(), nullptr, 1),
+              "sequential build failed");
+        check(par.build(M.get(), CalledFunctionsMapT(), nullptr, 4),
+              "parallel build failed");
+
+        check(seq.verify(), "sequentially built graph is not valid");
+        check(par.verify(), "parallel built graph is not valid");
+
+        EdgesT seqEdges = getEdges(seq);
+        EdgesT parEdges = getEdges(par);
+        check(seqEdges.size() == parEdges.size(),
+              "the graphs have different number of nodes (%zu and %zu)",
+              seqEdges.size(), parEdges.size());
+
+        for (auto& it : seqEdges) {
+            auto pit = parEdges.find(it.first);
+            if (pit == parEdges.end()) {
+                fail("node '%s' is only in the sequential build",
+                     it.first.c_str());
+                continue;
+            }
+
+            for (const std::string& e : it.second)
+                check(pit->second.count(e) > 0,
+                      "'%s': edge '%s' is only in the sequential build",
+                      it.first.c_str(), e.c_str());
+            for (const std::string& e : pit->second)
+                check(it.second.count(e) > 0,
+                      "'%s': edge '%s' is only in the parallel build",
+                      it.first.c_str(), e.c_str());
+        }
+
+        for (auto& it : parEdges)
+            check(seqEdges.count(it.first) > 0,
+                  "node '%s' is only in the parallel build", it.first.c_str());
+    }
+};
+
 }
 }
 
@@ -65,6 +279,7 @@ int main(void)
     TestRunner Runner;
 
     Runner.add(new TestRefcount());
+    Runner.add(new TestParallelBuild());
 
     return Runner();
 }
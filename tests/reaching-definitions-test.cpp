@@ -2,12 +2,19 @@
 #include <cstdarg>
 #include <cstdio>
 #include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
 
 #include "test-runner.h"
 #include "test-dg.h"
 
 #include "analysis/ReachingDefinitions/ReachingDefinitions.h"
 #include "analysis/ReachingDefinitions/RDMap.h"
+#include "analysis/ReachingDefinitions/RDSummaries.h"
+#include "analysis/ReachingDefinitions/RDDemand.h"
 
 namespace dg {
 namespace tests {
@@ -237,12 +244,374 @@ public:
         //dumpMap(&S2);
     }
 
+    void summaries1()
+    {
+        // main: AL1 -> S1 -> call foo -> S3
+        // foo: S2
+        RDNode MROOT(NOOP), MRET(NOOP);
+        RDNode FROOT(NOOP), FRET(NOOP);
+        RDNode AL1(ALLOC);
+        RDNode S1(STORE), S2(STORE), S3(STORE);
+        RDNode CALLN(CALL), CRET(CALL_RETURN);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 4, 4, true /* strong update */);
+        S3.addDef(&AL1, 0, 4, true /* strong update */);
+
+        MROOT.addSuccessor(&AL1);
+        AL1.addSuccessor(&S1);
+        S1.addSuccessor(&CALLN);
+        CALLN.addSuccessor(&FROOT);
+        FROOT.addSuccessor(&S2);
+        S2.addSuccessor(&FRET);
+        FRET.addSuccessor(&CRET);
+        CRET.addSuccessor(&S3);
+        S3.addSuccessor(&MRET);
+
+        ReachingDefinitionsAnalysis RD(&MROOT);
+        RDSummaries summaries;
+        summaries.addProcedure(&MROOT, &MRET);
+        summaries.addProcedure(&FROOT, &FRET);
+        summaries.addCallSite(&CALLN, &CRET, &FROOT);
+
+        std::set<RDNode *> reachable;
+        RD.getNodes(reachable);
+        summaries.run(reachable, 2);
+
+        const RDSummary *foo = summaries.getSummary(&FROOT);
+        check(foo && foo->defines.size() == 1, "foo defines one def-site");
+        const RDSummary *mainS = summaries.getSummary(&MROOT);
+        check(mainS->defines.size() == 2, "main should define also what foo defines");
+
+        // the summary of foo was applied at the call-site
+        std::set<RDNode *> rd;
+        CRET.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+        rd.clear();
+        CRET.getReachingDefinitions(&AL1, 4, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S2, "Should be S2");
+
+        // the summaries compute everything, the fixpoint is not needed
+        // (and it does not change anything)
+        for (int i = 0; i < 2; ++i) {
+            rd.clear();
+            MRET.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S3, "Should be S3");
+            rd.clear();
+            MRET.getReachingDefinitions(&AL1, 4, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S2, "Should be S2");
+            // the definitions from the caller
+            rd.clear();
+            S2.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+
+            // and the fixpoint gives the same results
+            RD.run();
+        }
+    }
+
+    void summaries2()
+    {
+        // main: AL1 -> S1 -> call foo -> L
+        // foo: B -> S2 -> FRET
+        //       \---------/
+        // S2 overwrites S1, but only on one path through foo
+        RDNode MROOT(NOOP), MRET(NOOP);
+        RDNode FROOT(NOOP), FRET(NOOP), B(NOOP);
+        RDNode AL1(ALLOC);
+        RDNode S1(STORE), S2(STORE), L(NOOP);
+        RDNode CALLN(CALL), CRET(CALL_RETURN);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+
+        MROOT.addSuccessor(&AL1);
+        AL1.addSuccessor(&S1);
+        S1.addSuccessor(&CALLN);
+        CALLN.addSuccessor(&FROOT);
+        FROOT.addSuccessor(&B);
+        B.addSuccessor(&S2);
+        B.addSuccessor(&FRET);
+        S2.addSuccessor(&FRET);
+        FRET.addSuccessor(&CRET);
+        CRET.addSuccessor(&L);
+        L.addSuccessor(&MRET);
+
+        ReachingDefinitionsAnalysis RD(&MROOT);
+        RDSummaries summaries;
+        summaries.addProcedure(&MROOT, &MRET);
+        summaries.addProcedure(&FROOT, &FRET);
+        summaries.addCallSite(&CALLN, &CRET, &FROOT);
+
+        std::set<RDNode *> reachable;
+        RD.getNodes(reachable);
+        summaries.run(reachable, 2);
+
+        const RDSummary *foo = summaries.getSummary(&FROOT);
+        check(foo->overwrites.size() == 1, "foo may overwrite AL1");
+
+        std::set<RDNode *> rd;
+        L.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 2 && rd.count(&S1) && rd.count(&S2),
+              "Should be S1 and S2");
+        rd.clear();
+        B.getReachingDefinitions(&AL1, 0, 4, rd);
+        check(rd.size() == 1 && *rd.begin() == &S1, "Should be S1");
+    }
+
+    void summaries3()
+    {
+        // main: AL1 -> S1 -> call foo -> MRET
+        // foo: S2 -> B -> FRET
+        //             \-> call foo -/
+        RDNode MROOT(NOOP), MRET(NOOP);
+        RDNode FROOT(NOOP), FRET(NOOP), B(NOOP);
+        RDNode AL1(ALLOC);
+        RDNode S1(STORE), S2(STORE);
+        RDNode CALLM(CALL), CRETM(CALL_RETURN);
+        RDNode CALLF(CALL), CRETF(CALL_RETURN);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL1, 0, 4, true /* strong update */);
+
+        MROOT.addSuccessor(&AL1);
+        AL1.addSuccessor(&S1);
+        S1.addSuccessor(&CALLM);
+        CALLM.addSuccessor(&FROOT);
+        FRET.addSuccessor(&CRETM);
+        CRETM.addSuccessor(&MRET);
+
+        FROOT.addSuccessor(&S2);
+        S2.addSuccessor(&B);
+        B.addSuccessor(&FRET);
+        B.addSuccessor(&CALLF);
+        CALLF.addSuccessor(&FROOT);
+        FRET.addSuccessor(&CRETF);
+        CRETF.addSuccessor(&FRET);
+
+        ReachingDefinitionsAnalysis RD(&MROOT);
+        RDSummaries summaries;
+        summaries.addProcedure(&MROOT, &MRET);
+        summaries.addProcedure(&FROOT, &FRET);
+        summaries.addCallSite(&CALLM, &CRETM, &FROOT);
+        summaries.addCallSite(&CALLF, &CRETF, &FROOT);
+
+        std::set<RDNode *> reachable;
+        RD.getNodes(reachable);
+        summaries.run(reachable, 2);
+
+        const RDSummary *foo = summaries.getSummary(&FROOT);
+        check(foo->overwrites.size() == 1, "foo may overwrite AL1");
+
+        // the same results as the fixpoint gives
+        for (int i = 0; i < 2; ++i) {
+            std::set<RDNode *> rd;
+            MRET.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 1 && *rd.begin() == &S2, "Should be S2");
+            rd.clear();
+            FROOT.getReachingDefinitions(&AL1, 0, 4, rd);
+            check(rd.size() == 2 && rd.count(&S1) && rd.count(&S2),
+                  "Should be S1 and S2");
+
+            RD.run();
+        }
+    }
+
+    // a random program with procedures that store to two objects
+    // and call each other (also recursively). Built twice from the same
+    // seed, so that we can compare the summaries with the fixpoint
+    struct RandomProgram
+    {
+        std::vector<RDNode *> nodes;
+        std::vector<std::pair<RDNode *, RDNode *>> procedures;
+        // (call, return, callee's root)
+        std::vector<std::tuple<RDNode *, RDNode *, RDNode *>> calls;
+        RDNode *root;
+        unsigned seed;
+
+        unsigned rnd(unsigned mod)
+        {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 16) % mod;
+        }
+
+        RDNode *create(RDNodeType type)
+        {
+            nodes.push_back(new RDNode(type));
+            return nodes.back();
+        }
+
+        RandomProgram(unsigned s, unsigned procs = 5, unsigned len = 8)
+            : seed(s)
+        {
+            RDNode *AL1 = create(ALLOC);
+            RDNode *AL2 = create(ALLOC);
+            AL1->addSuccessor(AL2);
+            root = AL1;
+
+            for (unsigned p = 0; p < procs; ++p)
+                procedures.emplace_back(create(NOOP), create(NOOP));
+
+            AL2->addSuccessor(procedures[0].first);
+
+            for (unsigned p = 0; p < procs; ++p) {
+                // the body is a chain with random jumps
+                std::vector<RDNode *> body{procedures[p].first};
+                for (unsigned i = 0; i < len; ++i) {
+                    RDNode *prev = body.back();
+                    if (rnd(3) == 0) {
+                        unsigned callee = rnd(procs);
+                        RDNode *call = create(CALL);
+                        RDNode *ret = create(CALL_RETURN);
+                        prev->addSuccessor(call);
+                        call->addSuccessor(procedures[callee].first);
+                        procedures[callee].second->addSuccessor(ret);
+                        calls.emplace_back(call, ret, procedures[callee].first);
+                        body.push_back(call);
+                        body.push_back(ret);
+                    } else {
+                        RDNode *S = create(STORE);
+                        S->addDef(rnd(2) ? AL1 : AL2, 4 * rnd(2), 4,
+                                  rnd(2) /* strong update */);
+                        prev->addSuccessor(S);
+                        body.push_back(S);
+                    }
+
+                    if (rnd(4) == 0) {
+                        RDNode *from = body[rnd(body.size())];
+                        RDNode *to = body[1 + rnd(body.size() - 1)];
+                        from->addSuccessor(to);
+                    }
+                }
+
+                body.back()->addSuccessor(procedures[p].second);
+            }
+        }
+
+        ~RandomProgram()
+        {
+            for (RDNode *n : nodes)
+                delete n;
+        }
+
+        // the reaching definitions of every node, with
+        // the nodes given by their numbers
+        std::vector<std::set<std::string>> getDefinitions() const
+        {
+            std::map<const RDNode *, size_t> numbers;
+            for (size_t i = 0; i < nodes.size(); ++i)
+                numbers[nodes[i]] = i;
+
+            std::vector<std::set<std::string>> ret;
+            for (RDNode *n : nodes) {
+                std::set<std::string> defs;
+                for (const auto& it : n->def_map) {
+                    for (RDNode *site : it.second) {
+                        char buf[128];
+                        snprintf(buf, sizeof buf, "%lu+%lu:%lu by %lu",
+                                 (unsigned long) numbers[it.first.target],
+                                 (unsigned long) *it.first.offset,
+                                 (unsigned long) *it.first.len,
+                                 (unsigned long) numbers[site]);
+                        defs.insert(buf);
+                    }
+                }
+                ret.push_back(std::move(defs));
+            }
+
+            return ret;
+        }
+    };
+
+    void summaries4()
+    {
+        for (unsigned seed = 1; seed <= 50; ++seed) {
+            RandomProgram withSummaries(seed), withFixpoint(seed);
+
+            ReachingDefinitionsAnalysis RD(withSummaries.root);
+            RDSummaries summaries;
+            for (auto& p : withSummaries.procedures)
+                summaries.addProcedure(p.first, p.second);
+            for (auto& cs : withSummaries.calls)
+                summaries.addCallSite(std::get<0>(cs), std::get<1>(cs),
+                                      std::get<2>(cs));
+
+            std::set<RDNode *> reachable;
+            RD.getNodes(reachable);
+            summaries.run(reachable, 3);
+
+            ReachingDefinitionsAnalysis FRD(withFixpoint.root);
+            FRD.run();
+
+            auto sdefs = withSummaries.getDefinitions();
+            auto fdefs = withFixpoint.getDefinitions();
+            for (size_t i = 0; i < sdefs.size(); ++i)
+                check(sdefs[i] == fdefs[i],
+                      "seed %u: node %lu differs from the fixpoint",
+                      seed, (unsigned long) i);
+        }
+    }
+
+    void demand1()
+    {
+        // AL1 -> AL2 -> S1 -> S2 -> S3 -> L
+        //                ^            |
+        //                 \-----------
+        RDNode AL1(ALLOC), AL2(ALLOC);
+        RDNode S1(STORE), S2(STORE), S3(STORE), L(NOOP);
+
+        S1.addDef(&AL1, 0, 4, true /* strong update */);
+        S2.addDef(&AL2, 0, 4, true /* strong update */);
+        S3.addDef(&AL1, 2, 2, false /* weak update */);
+
+        AL1.addSuccessor(&AL2);
+        AL2.addSuccessor(&S1);
+        S1.addSuccessor(&S2);
+        S2.addSuccessor(&S3);
+        S3.addSuccessor(&S1);
+        S3.addSuccessor(&L);
+
+        DemandReachingDefinitions DRD(&AL1);
+        std::set<RDNode *> rd1, rd2, rd3, rd4;
+        DRD.get(&L, &AL1, 0, 2, rd1);
+        DRD.get(&L, &AL1, 2, 4, rd2);
+        DRD.get(&S2, &AL1, 2, 2, rd3);
+        DRD.get(&L, &AL2, 0, 4, rd4);
+
+        check(rd1.size() == 1 && *rd1.begin() == &S1, "Should be S1");
+        check(rd2.size() == 2, "Should be S1 and S3");
+        check(rd3.size() == 1 && *rd3.begin() == &S1, "S1 kills S3");
+        check(rd4.size() == 1 && *rd4.begin() == &S2, "Should be S2");
+
+        // we must get the same results as the eager analysis
+        ReachingDefinitionsAnalysis RD(&AL1);
+        RD.run();
+
+        std::set<RDNode *> rd;
+        L.getReachingDefinitions(&AL1, 0, 2, rd);
+        check(rd == rd1, "Demand and eager differ");
+        rd.clear();
+        L.getReachingDefinitions(&AL1, 2, 4, rd);
+        check(rd == rd2, "Demand and eager differ");
+        rd.clear();
+        S2.getReachingDefinitions(&AL1, 2, 2, rd);
+        check(rd == rd3, "Demand and eager differ");
+        rd.clear();
+        L.getReachingDefinitions(&AL2, 0, 4, rd);
+        check(rd == rd4, "Demand and eager differ");
+    }
+
     void test()
     {
         basic1();
         basic2();
         basic3();
         basic4();
+        summaries1();
+        summaries2();
+        summaries3();
+        summaries4();
+        demand1();
     }
 };
 
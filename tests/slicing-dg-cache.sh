@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Slice a program with the cache stored for the program
+# before a function changed. The slice must be the same
+# as without the cache and the sliced program must still pass.
+
+TESTS_DIR=`dirname $0`
+source "$TESTS_DIR/test-runner.sh"
+
+compare_slices()
+{
+	CODE="$TESTS_DIR/$1"
+	NAME=${CODE%.*}
+	BCFILE="$NAME.bc"
+	EDITEDFILE="$NAME.edited.bc"
+	CACHEFILE="$NAME.dg-cache"
+	SLICEDFILE="$NAME.edited.sliced"
+	LINKEDFILE="$NAME.edited.sliced.linked"
+
+	rm -f $BCFILE $EDITEDFILE $CACHEFILE $SLICEDFILE $LINKEDFILE \
+		"$NAME.info" "$NAME.cached-info"
+
+	compile "$CODE" "$BCFILE"
+	TESTS_CFLAGS="$TESTS_CFLAGS -DEDIT" compile "$CODE" "$EDITEDFILE"
+
+	llvm-slicer -c test_assert -dg-cache "$CACHEFILE" -slice-info /dev/null "$BCFILE" \
+		|| errmsg "Slicing $1 and storing the cache failed"
+	llvm-slicer -c test_assert -dg-cache "$CACHEFILE" -slice-info "$NAME.cached-info" "$EDITEDFILE" \
+		|| errmsg "Slicing the changed $1 with the cache failed"
+	llvm-slicer -c test_assert -slice-info "$NAME.info" "$EDITEDFILE" \
+		|| errmsg "Slicing the changed $1 failed"
+
+	diff "$NAME.info" "$NAME.cached-info" \
+		|| errmsg "The cache gives a different slice of the changed $1"
+
+	llvm-slicer -c test_assert -dg-cache "$CACHEFILE" "$EDITEDFILE"
+	link_with_assert "$SLICEDFILE" "$LINKEDFILE"
+	get_result "$LINKEDFILE"
+}
+
+set_environment
+
+compare_slices "sources/dg-cache1.c"
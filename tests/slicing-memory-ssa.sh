@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Slice the programs with the def-use edges computed from the memory SSA
+# and from the reaching definitions. The slices must be the same
+# and the program sliced with the memory SSA must still pass.
+
+TESTS_DIR=`dirname $0`
+source "$TESTS_DIR/test-runner.sh"
+
+compare_slices()
+{
+	CODE="$TESTS_DIR/$1"
+	NAME=${CODE%.*}
+	BCFILE="$NAME.bc"
+	SLICEDFILE="$NAME.sliced"
+	LINKEDFILE="$NAME.sliced.linked"
+
+	rm -f $BCFILE $SLICEDFILE $LINKEDFILE "$NAME.rd-info" "$NAME.mssa-info"
+
+	compile "$CODE" "$BCFILE"
+
+	llvm-slicer -c test_assert -slice-info "$NAME.rd-info" "$BCFILE" \
+		|| errmsg "Slicing $1 with reaching definitions failed"
+	llvm-slicer -memory-ssa -c test_assert -slice-info "$NAME.mssa-info" "$BCFILE" \
+		|| errmsg "Slicing $1 with memory SSA failed"
+
+	diff "$NAME.rd-info" "$NAME.mssa-info" \
+		|| errmsg "Memory SSA and reaching definitions give different slices of $1"
+
+	llvm-slicer -memory-ssa -c test_assert "$BCFILE"
+	link_with_assert "$SLICEDFILE" "$LINKEDFILE"
+	get_result "$LINKEDFILE"
+}
+
+set_environment
+
+# heap
+compare_slices "sources/dynalloc1.c"
+compare_slices "sources/dynalloc8.c"
+compare_slices "sources/dynalloc9.c"
+compare_slices "sources/list1.c"
+# loops
+compare_slices "sources/loop1.c"
+compare_slices "sources/loop3.c"
+compare_slices "sources/sum1.c"
+# calls
+compare_slices "sources/interprocedural1.c"
+compare_slices "sources/interprocedural5.c"
+compare_slices "sources/recursive1.c"
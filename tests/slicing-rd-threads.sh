@@ -0,0 +1,49 @@
+#!/bin/bash
+
+# Slice the programs with the reaching definitions computed
+# function-wise in more threads and on the whole program at once.
+# The slices must be the same and the sliced program must still pass.
+
+TESTS_DIR=`dirname $0`
+source "$TESTS_DIR/test-runner.sh"
+
+compare_slices()
+{
+	CODE="$TESTS_DIR/$1"
+	NAME=${CODE%.*}
+	BCFILE="$NAME.bc"
+	SLICEDFILE="$NAME.sliced"
+	LINKEDFILE="$NAME.sliced.linked"
+
+	rm -f $BCFILE $SLICEDFILE $LINKEDFILE "$NAME.rd-info" "$NAME.rdt-info"
+
+	compile "$CODE" "$BCFILE"
+
+	llvm-slicer -c test_assert -slice-info "$NAME.rd-info" "$BCFILE" \
+		|| errmsg "Slicing $1 with reaching definitions failed"
+	llvm-slicer -rd-threads=4 -c test_assert -slice-info "$NAME.rdt-info" "$BCFILE" \
+		|| errmsg "Slicing $1 with reaching definitions in threads failed"
+
+	diff "$NAME.rd-info" "$NAME.rdt-info" \
+		|| errmsg "Reaching definitions in threads give a different slice of $1"
+
+	llvm-slicer -rd-threads=4 -c test_assert "$BCFILE"
+	link_with_assert "$SLICEDFILE" "$LINKEDFILE"
+	get_result "$LINKEDFILE"
+}
+
+set_environment
+
+# heap
+compare_slices "sources/dynalloc1.c"
+compare_slices "sources/dynalloc8.c"
+compare_slices "sources/list1.c"
+# loops
+compare_slices "sources/loop1.c"
+compare_slices "sources/sum1.c"
+# calls
+compare_slices "sources/interprocedural1.c"
+compare_slices "sources/interprocedural3.c"
+compare_slices "sources/interprocedural5.c"
+compare_slices "sources/recursive1.c"
+compare_slices "sources/funcptr1.c"
@@ -0,0 +1,27 @@
+/* the program is compiled also with EDIT defined,
+ * then only the function change() is different */
+
+int g, h;
+
+void set_h(int v)
+{
+	h = v;
+}
+
+void change(void)
+{
+#ifdef EDIT
+	g = 5;
+#endif
+	set_h(2);
+}
+
+int main(void)
+{
+	g = 5;
+	change();
+
+	test_assert(g == 5);
+	test_assert(h == 2);
+	return 0;
+}
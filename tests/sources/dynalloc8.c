@@ -0,0 +1,18 @@
+int *alloc(void)
+{
+	return malloc(sizeof(int));
+}
+
+int main(void)
+{
+	/* the same allocation site, but two objects,
+	 * the second store must not overwrite the first one */
+	int *p = alloc();
+	int *q = alloc();
+
+	*p = 1;
+	*q = 2;
+
+	test_assert(*p == 1);
+	return 0;
+}
@@ -0,0 +1,14 @@
+int main(void)
+{
+	int *arr[2];
+	int i;
+
+	for (i = 0; i < 2; ++i)
+		arr[i] = malloc(sizeof(int));
+
+	*arr[0] = 1;
+	*arr[1] = 2;
+
+	test_assert(*arr[0] == 1);
+	return 0;
+}
@@ -1,5 +1,8 @@
+#include <algorithm>
+#include <chrono>
 #include <set>
 #include <string>
+#include <vector>
 
 #include <cassert>
 #include <cstdlib>
@@ -40,6 +43,15 @@
 #include <llvm/Bitcode/ReaderWriter.h>
 #endif
 
+#if ((LLVM_VERSION_MAJOR > 3)\
+      || ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR > 6)))
+ #include <llvm/IR/DebugInfoMetadata.h>
+#elif ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR < 5))
+ #include <llvm/DebugInfo.h>
+#else // 3.5 and 3.6
+ #include <llvm/IR/DebugInfo.h>
+#endif
+
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Instructions.h>
@@ -63,6 +75,7 @@
 #include "llvm/LLVMDependenceGraph.h"
 #include "llvm/Slicer.h"
 #include "llvm/LLVMDG2Dot.h"
+#include "llvm/LLVMDGCache.h"
 #include "TimeMeasure.h"
 
 #include "llvm/analysis/old/PointsTo.h"
@@ -113,12 +126,14 @@ llvm::cl::opt<std::string> output("o",
 llvm::cl::opt<std::string> llvmfile(llvm::cl::Positional, llvm::cl::Required,
     llvm::cl::desc("<input file>"), llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
 
-llvm::cl::opt<std::string> slicing_criterion("c", llvm::cl::Required,
+llvm::cl::opt<std::string> slicing_criterion("c",
     llvm::cl::desc("Slice with respect to the call-sites of a given function\n"
                    "i. e.: '-c foo' or '-c __assert_fail'. Special value is a 'ret'\n"
                    "in which case the slice is taken with respect to the return value\n"
                    "of the main() function. You can use comma separated list of more\n"
-                   "function calls, e.g. -c foo,bar\n"), llvm::cl::value_desc("func"),
+                   "function calls, e.g. -c foo,bar\n"
+                   "Required unless -chop-from and -chop-to are given.\n"),
+                   llvm::cl::value_desc("func"),
                    llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
 
 llvm::cl::opt<uint64_t> pta_field_sensitivie("pta-field-sensitive",
@@ -138,6 +153,112 @@ llvm::cl::opt<bool> undefined_are_pure("undefined-are-pure",
     llvm::cl::desc("Assume that undefined functions have no side-effects\n"),
                    llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
 
+llvm::cl::opt<unsigned> rd_threads("rd-threads",
+    llvm::cl::desc("Compute reaching definitions function-wise using mod/ref summaries\n"
+                   "of functions, with N threads. 0 (default) runs the analysis\n"
+                   "on the whole program at once. The results are the same\n"
+                   "as with the whole-program analysis.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<unsigned> dg_threads("dg-threads",
+    llvm::cl::desc("Build the dependence graphs of functions (and compute\n"
+                   "their post-dominators) in parallel with N threads.\n"
+                   "0 (default) builds them sequentially.\n"),
+                   llvm::cl::value_desc("N"), llvm::cl::init(0),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_dg("lazy-dg",
+    llvm::cl::desc("Compute the def-use edges and control dependencies only\n"
+                   "in the functions that the slice gets to (while searching\n"
+                   "for the slice). The graphs of all functions are still built\n"
+                   "and the pointer analysis and reaching definitions (or memory\n"
+                   "SSA) still run on the whole program, so it saves only the\n"
+                   "time of the edges. The dumped graph contains only these edges.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> lazy_cd("lazy-cd",
+    llvm::cl::desc("Compute the post-dominators and control dependencies\n"
+                   "only in the functions that the slice gets to.\n"
+                   "The def-use edges are still computed for the whole\n"
+                   "program (see also -lazy-dg).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> dg_cache("dg-cache",
+    llvm::cl::desc("Store the dependence graph with all its edges to the file.\n"
+                   "If the file was stored for the same module and options,\n"
+                   "build the graph from it instead of running the analyses.\n"
+                   "If only some functions changed, reuse the control\n"
+                   "dependencies of the other functions and the def-use edges\n"
+                   "of the functions whose points-to sets and reaching\n"
+                   "definitions did not change either (not with -memory-ssa\n"
+                   "and -rd=demand). The pointer analysis and reaching\n"
+                   "definitions still run on the whole module then.\n"),
+                   llvm::cl::value_desc("file"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> slice_info("slice-info",
+    llvm::cl::desc("Do not slice the module, only write what is in the slice\n"
+                   "to the file. For every function with some instructions\n"
+                   "in the slice, there is the number of its instructions\n"
+                   "and a bitset in hex (the lowest bit of the first digit\n"
+                   "is the first instruction), then the source lines\n"
+                   "as file:line.\n"),
+                   llvm::cl::value_desc("file"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> batch_slices("batch",
+    llvm::cl::desc("Compute one slice for every criterion given by -c\n"
+                   "(all of them in one walk). Needs -slice-info.\n"
+                   "The slices are not context-sensitive.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> forward_slice("forward",
+    llvm::cl::desc("Compute the forward slice of the criteria given by -c,\n"
+                   "i.e. the instructions that depend on them. Needs -slice-info.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> chop_from("chop-from",
+    llvm::cl::desc("Compute the chop of the call-sites of the given functions\n"
+                   "and the call-sites given by -chop-to, i.e. the instructions\n"
+                   "that depend on the former and that the latter depend on.\n"
+                   "Needs -slice-info.\n"), llvm::cl::value_desc("func"),
+                   llvm::cl::init(""), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<std::string> chop_to("chop-to",
+    llvm::cl::desc("The sink of the chop (see -chop-from).\n"),
+                   llvm::cl::value_desc("func"), llvm::cl::init(""),
+                   llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> memoize_slices("memoize",
+    llvm::cl::desc("Remember the slice of every call-site of the criteria,\n"
+                   "so that the parts of the graph that are shared by more\n"
+                   "call-sites are walked only once. Not used with -summary-edges.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> summary_edges("summary-edges",
+    llvm::cl::desc("Use summary edges for the called functions, so that\n"
+                   "the slice keeps only the call-sites that can affect\n"
+                   "the slicing criterion (context-sensitive slicing).\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<analysis::rd::RD_ALG> rd_alg("rd",
+    llvm::cl::desc("Choose reaching definitions algorithm to use:"),
+    llvm::cl::values(
+        clEnumValN(analysis::rd::EAGER, "eager", "Compute definitions for the whole program (default)"),
+        clEnumValN(analysis::rd::DEMAND, "demand", "Compute definitions only where they are used")
+#if LLVM_VERSION_MAJOR < 4
+        , nullptr
+#endif
+        ),
+    llvm::cl::init(analysis::rd::EAGER), llvm::cl::cat(SlicingOpts));
+
+llvm::cl::opt<bool> memory_ssa("memory-ssa",
+    llvm::cl::desc("Compute data dependencies from memory SSA instead of\n"
+                   "reaching definitions. It does not compute the data-flow maps,\n"
+                   "so it scales to larger programs.\n"),
+                   llvm::cl::init(false), llvm::cl::cat(SlicingOpts));
+
 llvm::cl::opt<PtaType> pta("pta",
     llvm::cl::desc("Choose pointer analysis to use:"),
     llvm::cl::values(
@@ -164,6 +285,7 @@ llvm::cl::opt<CD_ALG> CdAlgorithm("cd-alg",
 
 class CommentDBG : public llvm::AssemblyAnnotationWriter
 {
+    LLVMDependenceGraph *dg;
     LLVMReachingDefinitions *RD;
     uint32_t opts;
 
@@ -397,9 +519,10 @@ class CommentDBG : public llvm::AssemblyAnnotationWriter
     }
 
 public:
-    CommentDBG(uint32_t o = ANNOTATE_DD,
+    CommentDBG(LLVMDependenceGraph *dg,
+               uint32_t o = ANNOTATE_DD,
                LLVMReachingDefinitions *rd = nullptr)
-        :RD(rd), opts(o) {}
+        :dg(dg), RD(rd), opts(o) {}
 
     virtual void emitFunctionAnnot (const llvm::Function *,
                                     llvm::formatted_raw_ostream &os)
@@ -433,7 +556,7 @@ public:
             return;
 
         LLVMNode *node = nullptr;
-        for (auto& it : getConstructedFunctions()) {
+        for (auto& it : dg->getConstructedFunctions()) {
             LLVMDependenceGraph *sub = it.second;
             node = sub->getNode(const_cast<llvm::Instruction *>(I));
             if (node)
@@ -452,7 +575,7 @@ public:
         if (opts == 0)
             return;
 
-        for (auto& it : getConstructedFunctions()) {
+        for (auto& it : dg->getConstructedFunctions()) {
             LLVMDependenceGraph *sub = it.second;
             auto cb = sub->getBlocks();
             LLVMBBlock *BB = cb[const_cast<llvm::BasicBlock *>(B)];
@@ -478,8 +601,8 @@ public:
     }
 };
 
-static void annotate(llvm::Module *M, uint32_t opts,
-                     LLVMReachingDefinitions *rd = nullptr)
+static void annotate(llvm::Module *M, LLVMDependenceGraph *dg,
+                     uint32_t opts, LLVMReachingDefinitions *rd = nullptr)
 {
     // compose name
     std::string fl(llvmfile);
@@ -490,7 +613,7 @@ static void annotate(llvm::Module *M, uint32_t opts,
     llvm::raw_os_ostream outputstream(ofs);
 
     errs() << "INFO: Saving IR with annotations to " << fl << "\n";
-    llvm::AssemblyAnnotationWriter *annot = new CommentDBG(opts, rd);
+    llvm::AssemblyAnnotationWriter *annot = new CommentDBG(dg, opts, rd);
     M->print(outputstream, annot);
 
     delete annot;
@@ -558,37 +681,162 @@ protected:
     uint32_t opts = 0;
     std::unique_ptr<LLVMPointerAnalysis> PTA;
     std::unique_ptr<LLVMReachingDefinitions> RD;
+    std::unique_ptr<LLVMMemorySSA> MSSA;
+    std::unique_ptr<LLVMDefUseAnalysis> DUA;
     LLVMDependenceGraph dg;
     LLVMSlicer slicer;
-
-    virtual void computeEdges()
+    // the slices of the criteria with -batch
+    analysis::BatchMark<LLVMNode> batch{&slicer};
+    // the forward slice or the chop with -forward and -chop-from
+    analysis::ChopMark<LLVMNode> chop;
+    std::unique_ptr<LLVMDGCache> cache;
+    // the edges were loaded from the cache
+    bool cached_edges = false;
+    // compute the control dependencies while marking
+    bool lazy_control_deps = false;
+    // the time spent computing the edges while marking (in microseconds)
+    uint64_t lazy_edges_time = 0;
+
+    // compute the reaching definitions (or memory SSA)
+    // and create the def-use analysis on top of them
+    void computeDataFlow()
     {
         debug::TimeMeasure tm;
         assert(PTA && "BUG: No PTA");
         assert(RD && "BUG: No RD");
 
-        tm.start();
-        RD->run();
-        tm.stop();
-        tm.report("INFO: Reaching defs analysis took");
+        // annotations dump the reaching definitions,
+        // so compute them even with memory SSA
+        if (!memory_ssa || (opts & ANNOTATE_RD)) {
+            tm.start();
+            RD->run();
+            tm.stop();
+            tm.report("INFO: Reaching defs analysis took");
+        }
+
+        if (memory_ssa) {
+            tm.start();
+            MSSA = std::unique_ptr<LLVMMemorySSA>(
+                new LLVMMemorySSA(&dg, PTA.get(), undefined_are_pure));
+            MSSA->run();
+            tm.stop();
+            tm.report("INFO: Building memory SSA took");
+        }
+
+        if (memory_ssa)
+            DUA = std::unique_ptr<LLVMDefUseAnalysis>(
+                new LLVMDefUseAnalysis(&dg, MSSA.get(), PTA.get(), undefined_are_pure));
+        else
+            DUA = std::unique_ptr<LLVMDefUseAnalysis>(
+                new LLVMDefUseAnalysis(&dg, RD.get(), PTA.get(), undefined_are_pure));
+    }
+
+    virtual void computeEdges()
+    {
+        debug::TimeMeasure tm;
+
+        computeDataFlow();
 
-        LLVMDefUseAnalysis DUA(&dg, RD.get(),
-                               PTA.get(), undefined_are_pure);
         tm.start();
-        DUA.run(); // add def-use edges according that
+        // take the def-use edges of the functions whose inputs
+        // did not change from the cache and compute the rest
+        std::set<llvm::Function *> reusedDefUse;
+        if (cache && !memory_ssa
+            && cache->loadDataDependencies(&dg, RD.get(), PTA.get(), reusedDefUse)) {
+            for (auto& F : dg.getConstructedFunctions()) {
+                if (reusedDefUse.count(llvm::cast<llvm::Function>(F.first)) == 0)
+                    DUA->runOnGraph(F.second);
+            }
+
+            errs() << "INFO: Reused the def-use edges of " << reusedDefUse.size()
+                   << " from " << dg.getConstructedFunctions().size()
+                   << " functions\n";
+        } else
+            DUA->run(); // add def-use edges according that
         tm.stop();
         tm.report("INFO: Adding Def-Use edges took");
 
+        // the control dependencies are computed while marking
+        if (lazy_control_deps)
+            return;
+
         tm.start();
-        // add post-dominator frontiers
-        dg.computeControlDependencies(CdAlgorithm);
+        // take the control dependencies of the functions that
+        // did not change from the cache and compute the rest
+        std::set<llvm::Function *> reused;
+        if (cache && cache->loadControlDependencies(&dg, reused)) {
+            for (auto& F : dg.getConstructedFunctions()) {
+                if (reused.count(llvm::cast<llvm::Function>(F.first)) == 0)
+                    F.second->computeFunctionControlDependencies(CdAlgorithm);
+            }
+
+            errs() << "INFO: Reused the control dependencies of " << reused.size()
+                   << " from " << dg.getConstructedFunctions().size()
+                   << " functions\n";
+        } else
+            // add post-dominator frontiers
+            dg.computeControlDependencies(CdAlgorithm, dg_threads);
         tm.stop();
         tm.report("INFO: Computing control dependencies took");
     }
 
+    // set up the slicer to compute the def-use edges and control
+    // dependencies of a function only once the marking gets
+    // to the function. Return false if this is not supported
+    virtual bool computeEdgesLazily()
+    {
+        computeDataFlow();
+
+        slicer.setLazyEdges([this](LLVMDependenceGraph *graph) {
+            auto start = std::chrono::steady_clock::now();
+            DUA->runOnGraph(graph);
+            graph->computeFunctionControlDependencies(CdAlgorithm);
+            graph->DependenceGraph<LLVMNode>::freeze();
+            lazy_edges_time += std::chrono::duration_cast<std::chrono::microseconds>(
+                                    std::chrono::steady_clock::now() - start).count();
+        });
+
+        return true;
+    }
+
+    // like computeEdgesLazily(), but compute lazily only the control
+    // dependencies (the def-use edges are computed by computeEdges()).
+    // Return false if this is not supported
+    virtual bool computeControlDependenciesLazily()
+    {
+        slicer.setLazyEdges([](LLVMDependenceGraph *graph) {
+            graph->computeFunctionControlDependencies(CdAlgorithm);
+            graph->DependenceGraph<LLVMNode>::freeze();
+        });
+
+        lazy_control_deps = true;
+        return true;
+    }
+
+    // the options that change the computed edges,
+    // the cached graph is valid only for the same options
+    static std::string cacheConfig()
+    {
+        return "pta=" + std::to_string(static_cast<int>(pta.getValue()))
+               + ",pta-field-sensitive=" + std::to_string(pta_field_sensitivie)
+               + ",rd-strong-update-unknown=" + std::to_string(rd_strong_update_unknown)
+               + ",undefined-are-pure=" + std::to_string(undefined_are_pure)
+               + ",rd=" + std::to_string(static_cast<int>(rd_alg.getValue()))
+               + ",memory-ssa=" + std::to_string(memory_ssa)
+               + ",cd-alg=" + std::to_string(static_cast<int>(CdAlgorithm.getValue()));
+    }
+
+    static uint32_t slicerOptions()
+    {
+        if (summary_edges)
+            return analysis::SLICER_CONTEXT_SENSITIVE;
+
+        return memoize_slices ? analysis::SLICER_MEMOIZE : 0;
+    }
+
     // for old slicer -- without creating a pointer analysis
     Slicer(llvm::Module *mod, uint32_t o, bool /* no pta */)
-    :M(mod), opts(o) {
+    :M(mod), opts(o), slicer(slicerOptions()) {
         assert(mod && "Need module");
     }
 
@@ -597,7 +845,12 @@ public:
     :M(mod), opts(o),
      PTA(new LLVMPointerAnalysis(mod, pta_field_sensitivie)),
       RD(new LLVMReachingDefinitions(mod, PTA.get(),
-                                     rd_strong_update_unknown, undefined_are_pure)) {
+                                     rd_strong_update_unknown, undefined_are_pure,
+                                     ~((uint32_t) 0), rd_threads,
+                                     // annotations dump the whole maps,
+                                     // so they need the eager algorithm
+                                     (o & ANNOTATE_RD) ? analysis::rd::EAGER : rd_alg)),
+      slicer(slicerOptions()) {
         assert(mod && "Need module");
     }
     const LLVMDependenceGraph& getDG() const { return dg; }
@@ -632,14 +885,43 @@ public:
         // of the graph. Otherwise just slice away the whole graph
         // Also compute the edges when the user wants to annotate
         // the file - due to debugging.
-        if (got_slicing_criterion || (opts & ANNOTATE))
+        // The annotations need all the edges, so we cannot
+        // compute them lazily in that case (and neither when
+        // we store the graph to the cache). The forward walks
+        // need all the edges too, since the walk does not know
+        // the users of a node until their graphs are computed.
+        bool forward = forward_slice || !chop_from.empty();
+        bool lazy = got_slicing_criterion && lazy_dg && !(opts & ANNOTATE)
+                    && dg_cache.empty() && !forward && computeEdgesLazily();
+        bool lazy_cd_only = !lazy && got_slicing_criterion && lazy_cd && !forward
+                            && !(opts & ANNOTATE) && dg_cache.empty()
+                            && !cached_edges && computeControlDependenciesLazily();
+        if (!lazy && !cached_edges
+            && (got_slicing_criterion || (opts & ANNOTATE))) {
             computeEdges();
 
+            if (cache) {
+                tm.start();
+                bool stored = cache->store(&dg, memory_ssa ? nullptr : RD.get(),
+                                           PTA.get());
+                tm.stop();
+                if (stored)
+                    tm.report("INFO: Storing the graph to the cache took");
+                else
+                    errs() << "WARNING: Failed storing the graph to the cache\n";
+            }
+        }
+
+        // the graph is complete now (computed or loaded from the cache),
+        // we will only walk it (slicing thaws the nodes that it modifies)
+        if (!lazy && (cached_edges || got_slicing_criterion || (opts & ANNOTATE)))
+            dg.freeze();
+
         // don't go through the graph when we know the result:
         // only empty main will stay there. Just delete the body
         // of main and keep the return value
         if (!got_slicing_criterion)
-            return createEmptyMain(M);
+            return !slice_info.empty() || createEmptyMain(M);
 
         // we also do not want to remove any assumptions
         // about the code
@@ -653,6 +935,39 @@ public:
             NULL // termination
         };
 
+        // the forward slice or the chop does not keep the assumptions,
+        // it is not a program that would be verified
+        if (forward) {
+            tm.start();
+            std::vector<LLVMNode *> criteria(callsites.begin(), callsites.end());
+            ADT::Bitvector set;
+            if (forward_slice)
+                set = chop.forward(criteria);
+            else {
+                std::set<LLVMNode *> sources;
+                if (!dg.getCallSites(splitList(chop_from), &sources))
+                    errs() << "Did not find the source of the chop: "
+                           << chop_from << "\n";
+
+                set = chop.chop(std::vector<LLVMNode *>(sources.begin(),
+                                                        sources.end()),
+                                criteria);
+            }
+
+            slice_id = 0xdead;
+            chop.markNodes(set, slice_id);
+            tm.stop();
+            tm.report("INFO: Finding dependent nodes took");
+            errs() << "INFO: " << (forward_slice ? "Forward slice" : "Chop")
+                   << " has " << set.count() << " from "
+                   << chop.getNodesNum() << " visited nodes\n";
+
+            if (opts & ANNOTATE)
+                annotate(M, &dg, opts, RD.get());
+
+            return true;
+        }
+
         dg.getCallSites(sc, &callsites);
 
         // do not slice __VERIFIER_assume at all
@@ -662,19 +977,172 @@ public:
         slice_id = 0xdead;
 
         tm.start();
-        for (LLVMNode *start : callsites)
-            slice_id = slicer.mark(start, slice_id);
+        if (batch_slices) {
+            std::vector<std::vector<LLVMNode *>> criteria;
+            for (const auto& c : criterions) {
+                std::set<LLVMNode *> cs;
+                if (c == "ret")
+                    cs.insert(dg.getExit());
+                dg.getCallSites(std::vector<std::string>{c}, &cs);
+                dg.getCallSites(sc, &cs);
+                criteria.emplace_back(cs.begin(), cs.end());
+            }
+
+            batch.mark(criteria);
+        } else {
+            for (LLVMNode *start : callsites)
+                slice_id = slicer.mark(start, slice_id);
+        }
 
         tm.stop();
         tm.report("INFO: Finding dependent nodes took");
 
+        if (!batch_slices) {
+            analysis::MarkStatistics ms = slicer.getMarkStatistics(slice_id);
+            errs() << "INFO: Marked " << ms.nodes << " nodes in " << ms.blocks
+                   << " blocks of " << ms.graphs << " functions\n";
+        }
+
+        if (memoize_slices && !summary_edges)
+            errs() << "INFO: Remembered the slices of " << slicer.getMemoizedNum()
+                   << " nodes\n";
+
+        if (lazy)
+            errs() << "INFO: Computed the edges of " << slicer.getLazyGraphsNum()
+                   << " from " << dg.getConstructedFunctions().size()
+                   << " functions in " << lazy_edges_time / 1000.0 << " ms\n";
+        else if (lazy_cd_only)
+            errs() << "INFO: Computed the control dependencies of "
+                   << slicer.getLazyGraphsNum() << " from "
+                   << dg.getConstructedFunctions().size() << " functions\n";
+
         // print debugging llvm IR if user asked for it
         if (opts & ANNOTATE)
-            annotate(M, opts, RD.get());
+            annotate(M, &dg, opts, RD.get());
 
         return true;
     }
 
+    // print the functions whose control dependencies
+    // took the most time to compute
+    void printControlDependenciesStatistics(unsigned num = 10) const
+    {
+        std::vector<std::pair<uint64_t, const llvm::Value *>> times;
+        for (const auto& F : dg.getConstructedFunctions())
+            times.emplace_back(F.second->getControlDependenciesTime(), F.first);
+
+        std::sort(times.begin(), times.end(),
+                  [](const std::pair<uint64_t, const llvm::Value *>& a,
+                     const std::pair<uint64_t, const llvm::Value *>& b) {
+                      return a.first > b.first;
+                  });
+
+        if (times.size() > num)
+            times.resize(num);
+
+        errs() << "Control dependencies (the slowest functions):\n";
+        for (const auto& t : times)
+            errs() << "  " << t.second->getName() << ": "
+                   << t.first / 1000.0 << " ms\n";
+    }
+
+    // is the node in the k-th slice of -batch (or in the slice)?
+    bool inSlice(LLVMNode *node, unsigned k) const
+    {
+        if (!node)
+            return false;
+
+        if (batch_slices)
+            return batch.inSlice(node, k);
+
+        return node->getSlice() == slice_id;
+    }
+
+    // write the instructions that are in the slice (or in the slices
+    // with -batch) to @file instead of slicing the module
+    bool writeSliceInfo(const std::string& file)
+    {
+        std::ofstream ofs(file);
+        if (!ofs.is_open() || ofs.bad()) {
+            errs() << "ERR: Failed opening " << file << "\n";
+            return false;
+        }
+
+        std::vector<std::string> names;
+        if (batch_slices)
+            names = splitList(slicing_criterion);
+        else
+            names.push_back(slicing_criterion);
+
+        errs() << "INFO: Writing the slice to " << file << "\n";
+        for (unsigned k = 0; k < names.size(); ++k) {
+            ofs << "slice " << k << " " << names[k] << "\n";
+            if (!got_slicing_criterion)
+                continue;
+
+            // file:line, the lines of different files must not mix
+            std::set<std::pair<std::string, unsigned>> lines;
+            for (auto& it : dg.getConstructedFunctions()) {
+                llvm::Function *F = llvm::cast<llvm::Function>(it.first);
+                LLVMDependenceGraph *graph = it.second;
+                // the graph numbers its nodes by the instructions,
+                // so we get them by the number without the index
+                const auto *nodes = graph->getNodes();
+
+                // the bits of four instructions in every digit
+                std::vector<unsigned> digits;
+                unsigned idx = 0;
+                bool any = false;
+                for (llvm::BasicBlock& B : *F) {
+                    for (llvm::Instruction& I : B) {
+                        if (idx % 4 == 0)
+                            digits.push_back(0);
+
+                        auto nit = nodes->at(idx);
+                        LLVMNode *node = (nit != nodes->end() && nit->first == &I)
+                                            ? nit->second : graph->getNode(&I);
+                        if (inSlice(node, k)) {
+                            digits.back() |= 1 << (idx % 4);
+                            any = true;
+
+                            // the same lines as llvm-to-source gives
+                            const llvm::DebugLoc& Loc = I.getDebugLoc();
+#if ((LLVM_VERSION_MAJOR > 3)\
+      || ((LLVM_VERSION_MAJOR == 3) && (LLVM_VERSION_MINOR > 6)))
+                            if (Loc)
+                                lines.emplace(Loc->getFilename().str(),
+                                              Loc.getLine());
+#else
+                            if (Loc.getLine() > 0) {
+                                llvm::DILocation DL(Loc.getAsMDNode(I.getContext()));
+                                lines.emplace(DL.getFilename().str(),
+                                              Loc.getLine());
+                            }
+#endif
+                        }
+
+                        ++idx;
+                    }
+                }
+
+                if (!any)
+                    continue;
+
+                ofs << "function " << F->getName().str() << " " << idx << " ";
+                for (unsigned d : digits)
+                    ofs << "0123456789abcdef"[d];
+                ofs << "\n";
+            }
+
+            ofs << "lines";
+            for (const auto& ln : lines)
+                ofs << " " << ln.first << ":" << ln.second;
+            ofs << "\n";
+        }
+
+        return !ofs.bad();
+    }
+
     bool slice()
     {
         // we created an empty main in this case
@@ -705,6 +1173,30 @@ public:
     {
         debug::TimeMeasure tm;
 
+        // the annotations dump the results of the analyses,
+        // so we must run them anyway
+        if (!dg_cache.empty() && !(opts & ANNOTATE)) {
+            cache = std::unique_ptr<LLVMDGCache>(
+                        new LLVMDGCache(M, dg_cache, cacheConfig()));
+
+            tm.start();
+            cached_edges = cache->load(&dg, dg_threads);
+            tm.stop();
+
+            if (cached_edges) {
+                tm.report("INFO: Building the graph from the cache took");
+                // we have all the edges already, do not store them again
+                cache.reset();
+
+                if (!dg.verify()) {
+                    errs() << "ERR: verifying failed\n";
+                    return false;
+                }
+
+                return true;
+            }
+        }
+
         tm.start();
 
         if (pta == PtaType::fs)
@@ -717,7 +1209,7 @@ public:
         tm.stop();
         tm.report("INFO: Points-to analysis took");
 
-        dg.build(&*M, PTA.get());
+        dg.build(&*M, PTA.get(), nullptr, dg_threads);
 
         // verify if the graph is built correctly
         // FIXME - do it optionally (command line argument)
@@ -739,6 +1231,10 @@ public:
 /// --------------------------------------------------------------------
 class SlicerOld : public Slicer
 {
+    // the old analyses compute the whole program at once
+    virtual bool computeEdgesLazily() { return false; }
+    virtual bool computeControlDependenciesLazily() { return false; }
+
     virtual void computeEdges()
     {
         debug::TimeMeasure tm;
@@ -848,8 +1344,6 @@ static bool remove_unused_from_module(llvm::Module *M)
     std::set<Function *> funs;
     std::set<GlobalVariable *> globals;
     std::set<GlobalAlias *> aliases;
-    auto cf = getConstructedFunctions();
-
     for (auto I = M->begin(), E = M->end(); I != E; ++I) {
         Function *func = &*I;
         if (array_match(func->getName(), keep))
@@ -1093,6 +1587,38 @@ int main(int argc, char *argv[])
     llvm::cl::SetVersionPrinter([](){ printf("%s\n", GIT_VERSION); });
     llvm::cl::ParseCommandLineOptions(argc, argv);
 
+    if (batch_slices && slice_info.empty()) {
+        errs() << "ERR: -batch works only with -slice-info\n";
+        return 1;
+    }
+
+    if (chop_from.empty() != chop_to.empty()) {
+        errs() << "ERR: -chop-from and -chop-to must be given together\n";
+        return 1;
+    }
+
+    if (!chop_from.empty()) {
+        if (!slicing_criterion.empty() || forward_slice) {
+            errs() << "ERR: -chop-to is the slicing criterion of the chop,"
+                      " do not use -c or -forward with it\n";
+            return 1;
+        }
+
+        slicing_criterion = std::string(chop_to);
+    }
+
+    if (slicing_criterion.empty()) {
+        errs() << "ERR: No slicing criterion given (use -c)\n";
+        return 1;
+    }
+
+    if ((forward_slice || !chop_from.empty())
+        && (slice_info.empty() || batch_slices)) {
+        errs() << "ERR: -forward and -chop-from work only with -slice-info"
+                  " (and without -batch)\n";
+        return 1;
+    }
+
     uint32_t opts = parseAnnotationOpt(annot);
     uint32_t dump_opts = debug::PRINT_CFG | debug::PRINT_DD | debug::PRINT_CD;
     // dump_dg_only implies dumg_dg
@@ -1116,8 +1642,10 @@ int main(int argc, char *argv[])
     if (statistics)
         print_statistics(M, "Statistics before ");
 
-    // remove unused from module, we don't need that
-    remove_unused_from_module_rec(M);
+    // remove unused from module, we don't need that. When we only
+    // write the slice, the instructions must be the ones in the file
+    if (slice_info.empty() || remove_unused_only)
+        remove_unused_from_module_rec(M);
 
     if (remove_unused_only) {
         errs() << "INFO: removed unused parts of module, exiting...\n";
@@ -1145,6 +1673,9 @@ int main(int argc, char *argv[])
     // mark nodes that are going to be in the slice
     slicer->mark();
 
+    if (statistics)
+        slicer->printControlDependenciesStatistics();
+
     if (dump_dg) {
         dump_dg_to_dot(slicer->getDG(), bb_only, dump_opts);
 
@@ -1152,6 +1683,10 @@ int main(int argc, char *argv[])
             return 0;
     }
 
+    // the module is left untouched in this case
+    if (!slice_info.empty())
+        return slicer->writeSliceInfo(slice_info) ? 0 : 1;
+
     // slice the graph
     if (!slicer->slice()) {
         errs() << "ERROR: Slicing failed\n";